@@ -0,0 +1,101 @@
+#ifndef _LOGGER_BINARY_HEADER_H_
+#define _LOGGER_BINARY_HEADER_H_
+
+#include "spdlog/formatter.h"
+#include "spdlog/details/os.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <vector>
+
+/*
+* the file sinks write a binary record per message instead of the text of "[%H:%M:%S.%e %t %^%L%$] %v",
+* which leaves the time, thread and level rendering to decode_binary_log:
+*   'S' 'L'     marker
+*   uint8       level
+*   uint8       0
+*   uint32      payload size
+*   int64       nanoseconds since epoch
+*   uint64      thread id
+*   payload     the message text
+* in native byte order, the time is rendered in the local time of where the log is decoded
+*/
+namespace spdlog {
+
+struct binary_record
+{
+    char marker[2];
+    uint8_t level;
+    uint8_t reserved;
+    uint32_t size;
+    int64_t time;
+    uint64_t thread_id;
+};
+
+static_assert(sizeof(binary_record) == 24, "binary record header is not packed");
+
+class binary_formatter final : public formatter
+{
+public:
+    void format(const details::log_msg &msg, memory_buf_t &dest) override
+    {
+        binary_record record;
+        record.marker[0] = 'S';
+        record.marker[1] = 'L';
+        record.level = (uint8_t)msg.level;
+        record.reserved = 0;
+        record.size = (uint32_t)msg.payload.size();
+        record.time = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+        record.thread_id = (uint64_t)msg.thread_id;
+
+        dest.append((const char *)&record, (const char *)&record + sizeof(record));
+        dest.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+    }
+
+    std::unique_ptr<formatter> clone() const override
+    {
+        return details::make_unique<binary_formatter>();
+    }
+};
+
+// renders the records of in to out as the text the file sinks would have written, false once a record is broken
+inline bool decode_binary_log(std::FILE *in, std::FILE *out)
+{
+    binary_record record;
+    std::vector<char> payload;
+    memory_buf_t line;
+
+    while (1 == std::fread(&record, sizeof(record), 1, in))
+    {
+        if ('S' != record.marker[0] || 'L' != record.marker[1] || record.level > level::off)
+        {
+            return false;
+        }
+
+        payload.resize(record.size);
+        if (record.size > 0 && 1 != std::fread(payload.data(), record.size, 1, in))
+        {
+            return false;
+        }
+
+        std::chrono::nanoseconds since_epoch(record.time);
+        std::tm tm_time = details::os::localtime((std::time_t)std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count());
+        long long millis = (long long)(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+
+        line.clear();
+        fmt::format_to(line, "[{:02}:{:02}:{:02}.{:03} {} {}] ", tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, millis, record.thread_id, level::to_short_c_str((level::level_enum)record.level));
+        line.append(payload.data(), payload.data() + payload.size());
+        line.append(details::os::default_eol, details::os::default_eol + std::char_traits<char>::length(details::os::default_eol));
+
+        std::fwrite(line.data(), 1, line.size(), out);
+    }
+
+    // a record cut by a crash ends the log as well
+    return 0 != std::feof(in);
+}
+
+} // namespace spdlog
+
+#endif
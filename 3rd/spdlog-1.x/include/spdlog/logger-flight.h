@@ -0,0 +1,350 @@
+#ifndef _LOGGER_FLIGHT_HEADER_H_
+#define _LOGGER_FLIGHT_HEADER_H_
+
+#include "spdlog/logger-front.h"
+#include "spdlog/logger-binary.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+/*
+* flight_recorder keeps the last messages of every thread in a ring of its own, whatever the level of the files:
+*   record_level    the messages of this level and above are kept, as debug while the files take info
+*   thread_bytes    memory of the ring of a thread, a message longer than max_text is cut
+*   max_threads     rings held at most, the ring of an exited thread is taken over by a new one,
+*                   the threads beyond are not recorded
+* a thread writes its own ring only, with neither lock nor formatting, the memory is thread_bytes * max_threads at most
+*
+* dump merges the rings by time into the records of logger-binary.h with the logger name ahead of the text,
+* which --log.decode renders, it neither locks nor allocates so that it may be called on a crash
+*
+* flight_logger is put in front of a logger, see logger-front.h, it records the messages on the thread which logs them,
+* before an async logger queues them, and passes them on to the logger behind it
+*/
+namespace spdlog {
+
+class flight_recorder final : public std::enable_shared_from_this<flight_recorder>
+{
+public:
+    static const std::size_t max_name = 20;
+    static const std::size_t max_text = 208;
+
+    flight_recorder(level::level_enum record_level, std::size_t thread_bytes, std::size_t max_threads)
+        : record_level_(record_level)
+        , entry_count_(std::max<std::size_t>(thread_bytes / sizeof(entry), 16))
+        , ring_count_(std::max<std::size_t>(max_threads, 1))
+        , rings_(new ring[ring_count_])
+        , fronts_(new entry_record[ring_count_])
+        , cursors_(new uint64_t[ring_count_])
+        , heads_(new uint64_t[ring_count_])
+        , missed_(0)
+        , dumping_(false)
+    {}
+
+    ~flight_recorder()
+    {
+        for (std::size_t i = 0; i < ring_count_; ++i)
+        {
+            delete[] rings_[i].entries.load(std::memory_order_acquire);
+        }
+    }
+
+    level::level_enum record_level() const
+    {
+        return record_level_;
+    }
+
+    bool should_record(level::level_enum msg_level) const
+    {
+        return msg_level >= record_level_;
+    }
+
+    void record(const details::log_msg &msg)
+    {
+        ring *owned = owned_ring();
+        if (!owned)
+        {
+            missed_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // the owner is the only writer, a reader takes an entry whose sequence is the same before and after
+        uint64_t index = owned->head.load(std::memory_order_relaxed);
+        entry &e = owned->entries.load(std::memory_order_relaxed)[index % entry_count_];
+        e.seq.store(index * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        entry_record &r = e.rec;
+        r.time = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+        r.thread_id = (uint64_t)msg.thread_id;
+        r.level = (uint8_t)msg.level;
+        r.name_size = (uint8_t)std::min(msg.logger_name.size(), (std::size_t)max_name);
+        r.size = (uint16_t)std::min(msg.payload.size(), (std::size_t)max_text);
+        if (r.name_size > 0)
+        {
+            std::memcpy(r.name, msg.logger_name.data(), r.name_size);
+        }
+        if (r.size > 0)
+        {
+            std::memcpy(r.text, msg.payload.data(), r.size);
+        }
+
+        e.seq.store(index * 2 + 2, std::memory_order_release);
+        owned->head.store(index + 1, std::memory_order_release);
+    }
+
+    /*
+    * write(const char* data, std::size_t size) returns false to stop, the records written are returned,
+    * a dump called while another runs writes nothing
+    */
+    template<typename writer_t>
+    std::size_t dump(writer_t write)
+    {
+        bool expected = false;
+        if (!dumping_.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        {
+            return 0;
+        }
+
+        for (std::size_t i = 0; i < ring_count_; ++i)
+        {
+            heads_[i] = rings_[i].head.load(std::memory_order_acquire);
+            cursors_[i] = heads_[i] > entry_count_ ? heads_[i] - entry_count_ : 0;
+            peek(i);
+        }
+
+        std::size_t written = 0;
+        while (true)
+        {
+            std::size_t oldest = ring_count_;
+            for (std::size_t i = 0; i < ring_count_; ++i)
+            {
+                if (cursors_[i] < heads_[i] && (oldest == ring_count_ || fronts_[i].time < fronts_[oldest].time))
+                {
+                    oldest = i;
+                }
+            }
+
+            if (oldest == ring_count_ || !write_record(fronts_[oldest], write))
+            {
+                break;
+            }
+            ++written;
+
+            ++cursors_[oldest];
+            peek(oldest);
+        }
+
+        dumping_.store(false, std::memory_order_release);
+        return written;
+    }
+
+    // messages of the threads which got no ring
+    uint64_t missed() const
+    {
+        return missed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct entry_record
+    {
+        int64_t time;
+        uint64_t thread_id;
+        uint16_t size;
+        uint8_t level;
+        uint8_t name_size;
+        char name[max_name];
+        char text[max_text];
+    };
+
+    struct entry
+    {
+        std::atomic<uint64_t> seq;
+        entry_record rec;
+    };
+
+    static_assert(sizeof(entry) == 256, "flight recorder entry is not packed");
+
+    struct ring
+    {
+        ring()
+            : owned(false)
+            , head(0)
+            , entries(nullptr)
+        {}
+
+        std::atomic<bool> owned;
+        std::atomic<uint64_t> head;
+
+        // allocated by the first owner, freed with the recorder
+        std::atomic<entry *> entries;
+    };
+
+    // the ring of the calling thread, handed back once the thread exits
+    struct holder
+    {
+        ~holder()
+        {
+            release();
+        }
+
+        void release()
+        {
+            if (owned)
+            {
+                owned->owned.store(false, std::memory_order_release);
+                owned = nullptr;
+            }
+            recorder.reset();
+        }
+
+        std::shared_ptr<flight_recorder> recorder;
+        ring *owned = nullptr;
+    };
+
+    ring *owned_ring()
+    {
+        static thread_local holder local;
+        if (local.recorder.get() == this)
+        {
+            return local.owned;
+        }
+
+        local.release();
+        local.recorder = shared_from_this();
+
+        for (std::size_t i = 0; i < ring_count_; ++i)
+        {
+            bool expected = false;
+            if (rings_[i].owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                if (!rings_[i].entries.load(std::memory_order_acquire))
+                {
+                    rings_[i].entries.store(new entry[entry_count_](), std::memory_order_release);
+                }
+                local.owned = &rings_[i];
+                break;
+            }
+        }
+        return local.owned;
+    }
+
+    // the oldest entry left of a ring to fronts_, the ones overwritten meanwhile are skipped
+    void peek(std::size_t i)
+    {
+        entry *entries = rings_[i].entries.load(std::memory_order_acquire);
+        for (; entries && cursors_[i] < heads_[i]; ++cursors_[i])
+        {
+            entry &e = entries[cursors_[i] % entry_count_];
+
+            uint64_t seq = e.seq.load(std::memory_order_acquire);
+            if (seq != cursors_[i] * 2 + 2)
+            {
+                continue;
+            }
+
+            std::memcpy(&fronts_[i], &e.rec, sizeof(entry_record));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) == seq)
+            {
+                return;
+            }
+        }
+        cursors_[i] = heads_[i];
+    }
+
+    template<typename writer_t>
+    static bool write_record(const entry_record &r, writer_t &write)
+    {
+        binary_record header;
+        header.marker[0] = 'S';
+        header.marker[1] = 'L';
+        header.level = r.level;
+        header.reserved = 0;
+        header.size = (uint32_t)(r.name_size + 3 + r.size);
+        header.time = r.time;
+        header.thread_id = r.thread_id;
+
+        return write((const char *)&header, sizeof(header)) && write("[", 1) && write(r.name, r.name_size) && write("] ", 2) && write(r.text, r.size);
+    }
+
+private:
+    level::level_enum record_level_;
+
+    std::size_t entry_count_;
+    std::size_t ring_count_;
+    std::unique_ptr<ring[]> rings_;
+
+    // dump only
+    std::unique_ptr<entry_record[]> fronts_;
+    std::unique_ptr<uint64_t[]> cursors_;
+    std::unique_ptr<uint64_t[]> heads_;
+
+    std::atomic<uint64_t> missed_;
+    std::atomic<bool> dumping_;
+};
+
+/*
+* a logger whose level is lowered to the record level of the recorder, the messages under its pass level are recorded only,
+* the others are passed on to the logger behind it
+*/
+class flight_gate
+{
+public:
+    virtual ~flight_gate() = default;
+
+    void set_pass_level(level::level_enum pass_level)
+    {
+        pass_level_.store(pass_level, std::memory_order_relaxed);
+    }
+
+    level::level_enum pass_level() const
+    {
+        return (level::level_enum)pass_level_.load(std::memory_order_relaxed);
+    }
+
+    const std::shared_ptr<flight_recorder> &recorder() const
+    {
+        return recorder_;
+    }
+
+protected:
+    explicit flight_gate(std::shared_ptr<flight_recorder> recorder)
+        : recorder_(std::move(recorder))
+        , pass_level_(level::trace)
+    {}
+
+    std::shared_ptr<flight_recorder> recorder_;
+    std::atomic<int> pass_level_;
+};
+
+class flight_logger final : public front_logger, public flight_gate
+{
+public:
+    flight_logger(std::shared_ptr<flight_recorder> recorder, std::shared_ptr<logger> inner)
+        : front_logger(std::move(inner))
+        , flight_gate(std::move(recorder))
+    {}
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        if (recorder_->should_record(msg.level))
+        {
+            recorder_->record(msg);
+        }
+
+        if (msg.level >= pass_level())
+        {
+            pass(msg);
+        }
+    }
+};
+
+} // namespace spdlog
+
+#endif
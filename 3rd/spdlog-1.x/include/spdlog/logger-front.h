@@ -0,0 +1,47 @@
+#ifndef _LOGGER_FRONT_HEADER_H_
+#define _LOGGER_FRONT_HEADER_H_
+
+#include "spdlog/logger.h"
+
+#include <memory>
+#include <utility>
+
+/*
+* front_logger is put in front of a logger and takes the messages on the thread which logs them, before an async logger
+* queues them, it holds no sinks of its own, so it is the same in front of a logger and of an async_logger,
+* the formatter and sinks of the front loggers are those of the logger at the back of them, see logger-macro.h
+*/
+namespace spdlog {
+
+class front_logger : public logger
+{
+public:
+    // the logger which the messages are passed on to
+    const std::shared_ptr<logger> &inner() const
+    {
+        return inner_;
+    }
+
+protected:
+    explicit front_logger(std::shared_ptr<logger> inner)
+        : logger(inner->name(), sinks_init_list{})
+        , inner_(std::move(inner))
+    {}
+
+    // the payload is formatted already, so it is passed as the text rather than as a format string
+    void pass(const details::log_msg &msg)
+    {
+        inner_->log<string_view_t>(msg.source, msg.level, msg.payload);
+    }
+
+    void flush_() override
+    {
+        inner_->flush();
+    }
+
+    std::shared_ptr<logger> inner_;
+};
+
+} // namespace spdlog
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef _LOGGER_GAUGE_HEADER_H_
+#define _LOGGER_GAUGE_HEADER_H_
+
+#include "spdlog/logger-front.h"
+#include "spdlog/sinks/sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+/*
+* async_gauge tracks the depth of the queue which the async loggers of a thread pool share as the messages are queued,
+* so its high water takes every burst in without a look into the queue:
+*   gauge_logger    is put in front of an async logger, see logger-front.h, it counts the messages and flushes
+*                   which are queued, on the thread which logs them
+*   gauge_sink      is put in front of the sink of the async logger, it counts the ones taken off the queue,
+*                   on the backend thread
+* the message being written counts as queued, a message overrun by drop_oldest is never taken off but the queue is full
+* by then, so the depth is capped by the size of the queue
+*/
+namespace spdlog {
+
+class async_gauge final
+{
+public:
+    explicit async_gauge(std::size_t queue_size)
+        : queue_size_(queue_size)
+        , queued_(0)
+        , taken_(0)
+        , high_water_(0)
+    {}
+
+    void queue()
+    {
+        uint64_t queued = queued_.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t taken = taken_.load(std::memory_order_relaxed);
+
+        std::size_t depth = queued > taken ? (std::size_t)std::min<uint64_t>(queued - taken, queue_size_) : 0;
+        std::size_t high_water = high_water_.load(std::memory_order_relaxed);
+        while (depth > high_water && !high_water_.compare_exchange_weak(high_water, depth, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void take()
+    {
+        taken_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::size_t high_water() const
+    {
+        return high_water_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::size_t queue_size_;
+
+    std::atomic<uint64_t> queued_;
+    std::atomic<uint64_t> taken_;
+    std::atomic<std::size_t> high_water_;
+};
+
+class gauge_logger final : public front_logger
+{
+public:
+    gauge_logger(std::shared_ptr<logger> inner, std::shared_ptr<async_gauge> gauge)
+        : front_logger(std::move(inner))
+        , gauge_(std::move(gauge))
+    {}
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        if (inner_->should_log(msg.level))
+        {
+            gauge_->queue();
+
+            // the flush_on of the async logger queues a flush behind the message
+            if (msg.level >= inner_->flush_level() && level::off != msg.level)
+            {
+                gauge_->queue();
+            }
+        }
+        pass(msg);
+    }
+
+    void flush_() override
+    {
+        gauge_->queue();
+        inner_->flush();
+    }
+
+private:
+    std::shared_ptr<async_gauge> gauge_;
+};
+
+class gauge_sink final : public sinks::sink
+{
+public:
+    gauge_sink(sink_ptr sink, std::shared_ptr<async_gauge> gauge)
+        : sink_(std::move(sink))
+        , gauge_(std::move(gauge))
+    {}
+
+    void log(const details::log_msg &msg) override
+    {
+        gauge_->take();
+        if (sink_->should_log(msg.level))
+        {
+            sink_->log(msg);
+        }
+    }
+
+    void flush() override
+    {
+        gauge_->take();
+        sink_->flush();
+    }
+
+    void set_pattern(const std::string &pattern) override
+    {
+        sink_->set_pattern(pattern);
+    }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override
+    {
+        sink_->set_formatter(std::move(sink_formatter));
+    }
+
+private:
+    sink_ptr sink_;
+    std::shared_ptr<async_gauge> gauge_;
+};
+
+} // namespace spdlog
+
+#endif
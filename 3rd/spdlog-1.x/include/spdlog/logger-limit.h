@@ -0,0 +1,270 @@
+#ifndef _LOGGER_LIMIT_HEADER_H_
+#define _LOGGER_LIMIT_HEADER_H_
+
+#include "spdlog/logger-front.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+* limit_logger is put in front of a logger, see logger-front.h, it passes so many messages of a call site a second
+* on to the logger behind it and suppresses the rest, before an async logger queues them:
+*   limits      messages a second per call site of each level, 0 for no limit
+* a call site is the source_loc of the message, see LOGGING_CALL, or the message text itself when it is logged without one,
+* once a second of a site has passed the suppressed messages are summed up in a message of the site's level,
+* by the next message of the site, the first message of another site in a second or the next flush,
+* a passed message of a site within its second costs one atomic increment
+*/
+namespace spdlog {
+
+class limit_logger final : public front_logger
+{
+public:
+    static const std::size_t slot_count = 1024;
+
+    limit_logger(std::shared_ptr<logger> inner, const std::vector<int> &limits)
+        : front_logger(std::move(inner))
+        , limits_()
+        , slots_(new slot[slot_count])
+        , suppressed_(0)
+        , unsummed_(false)
+        , summed_at_(0)
+    {
+        for (std::size_t i = 0; i < level::off; ++i)
+        {
+            limits_[i] = i < limits.size() ? limits[i] : 0;
+        }
+        limits_[level::off] = 0;
+    }
+
+    ~limit_logger() override
+    {
+        sum_up(INT64_MAX);
+    }
+
+    // messages suppressed since created
+    uint64_t suppressed() const
+    {
+        return suppressed_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        if (!inner_->should_log(msg.level))
+        {
+            return;
+        }
+
+        int limit = limits_[msg.level];
+        if (limit <= 0)
+        {
+            pass(msg);
+            return;
+        }
+
+        uint64_t key = site_of(msg);
+        slot &site = slots_[key % slot_count];
+        int64_t second = second_of(msg.time);
+
+        if (site.key.load(std::memory_order_relaxed) == key && site.second.load(std::memory_order_relaxed) == second)
+        {
+            count_in(site, limit, msg);
+            return;
+        }
+
+        // the first message of a site in a second
+        uint32_t suppressed = 0;
+        level::level_enum site_level = msg.level;
+        std::string where;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (site.key.load(std::memory_order_relaxed) != key)
+            {
+                // another site holds the slot this second, neither is limited rather than both by one count
+                if (0 != site.key.load(std::memory_order_relaxed) && site.second.load(std::memory_order_relaxed) >= second)
+                {
+                    pass(msg);
+                    return;
+                }
+                site.key.store(key, std::memory_order_relaxed);
+            }
+            else if (site.second.load(std::memory_order_relaxed) >= second)
+            {
+                // the second begun by another thread meanwhile, or a message queued before it
+                count_in(site, limit, msg);
+                return;
+            }
+
+            suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+            site_level = site.site_level;
+            where.swap(site.where);
+
+            site.where = where_of(msg);
+            site.site_level = msg.level;
+            site.count.store(1, std::memory_order_relaxed);
+            site.second.store(second, std::memory_order_relaxed);
+        }
+
+        if (suppressed > 0)
+        {
+            summarize(site_level, where, suppressed);
+        }
+        pass(msg);
+
+        sum_up_quiet(second);
+    }
+
+    void flush_() override
+    {
+        sum_up_quiet(second_of(log_clock::now()));
+        inner_->flush();
+    }
+
+private:
+    struct slot
+    {
+        slot()
+            : key(0)
+            , second(0)
+            , count(0)
+            , suppressed(0)
+            , site_level(level::off)
+            , where()
+        {}
+
+        std::atomic<uint64_t> key;
+        std::atomic<int64_t> second;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> suppressed;
+
+        // guarded by lock_
+        level::level_enum site_level;
+        std::string where;
+    };
+
+    void count_in(slot &site, int limit, const details::log_msg &msg)
+    {
+        if (site.count.fetch_add(1, std::memory_order_relaxed) < (uint32_t)limit)
+        {
+            pass(msg);
+            return;
+        }
+
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        unsummed_.store(true, std::memory_order_relaxed);
+    }
+
+    static int64_t second_of(log_clock::time_point time)
+    {
+        return (int64_t)std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+    }
+
+    // never 0, which marks a free slot
+    static uint64_t site_of(const details::log_msg &msg)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        if (!msg.source.empty())
+        {
+            // the file name is a literal of the call site
+            hash = (hash ^ (uint64_t)(uintptr_t)msg.source.filename) * 1099511628211ULL;
+            hash = (hash ^ (uint64_t)msg.source.line) * 1099511628211ULL;
+        }
+        else
+        {
+            for (std::size_t i = 0; i < msg.payload.size(); ++i)
+            {
+                hash = (hash ^ (uint8_t)msg.payload.data()[i]) * 1099511628211ULL;
+            }
+        }
+        hash = (hash ^ (uint64_t)msg.level) * 1099511628211ULL;
+        return 0 == hash ? 1 : hash;
+    }
+
+    static std::string where_of(const details::log_msg &msg)
+    {
+        if (!msg.source.empty())
+        {
+            const char *file = msg.source.filename;
+            for (const char *p = file; *p; ++p)
+            {
+                if ('/' == *p || '\\' == *p)
+                {
+                    file = p + 1;
+                }
+            }
+            return fmt::format("{}:{}", file, msg.source.line);
+        }
+
+        static const std::size_t max_text = 64;
+        if (msg.payload.size() > max_text)
+        {
+            return std::string(msg.payload.data(), max_text) + "...";
+        }
+        return std::string(msg.payload.data(), msg.payload.size());
+    }
+
+    // the sites which went quiet, once a second at most
+    void sum_up_quiet(int64_t second)
+    {
+        if (unsummed_.load(std::memory_order_relaxed) && summed_at_.exchange(second, std::memory_order_relaxed) != second)
+        {
+            sum_up(second);
+        }
+    }
+
+    // the sites whose second ended before the given one
+    void sum_up(int64_t second)
+    {
+        std::vector<std::pair<level::level_enum, std::pair<std::string, uint32_t>>> summaries;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            unsummed_.store(false, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < slot_count; ++i)
+            {
+                slot &site = slots_[i];
+                if (0 == site.suppressed.load(std::memory_order_relaxed))
+                {
+                    continue;
+                }
+
+                if (site.second.load(std::memory_order_relaxed) >= second)
+                {
+                    unsummed_.store(true, std::memory_order_relaxed);
+                    continue;
+                }
+                summaries.emplace_back(site.site_level, std::make_pair(site.where, site.suppressed.exchange(0, std::memory_order_relaxed)));
+            }
+        }
+
+        for (auto &summary : summaries)
+        {
+            summarize(summary.first, summary.second.first, summary.second.second);
+        }
+    }
+
+    void summarize(level::level_enum site_level, const std::string &where, uint32_t suppressed)
+    {
+        inner_->log(site_level, "{} similar messages suppressed: {}", suppressed, where);
+    }
+
+private:
+    int limits_[level::off + 1];
+    std::unique_ptr<slot[]> slots_;
+
+    std::atomic<uint64_t> suppressed_;
+    std::atomic<bool> unsummed_;
+    std::atomic<int64_t> summed_at_;
+
+    std::mutex lock_;
+};
+
+} // namespace spdlog
+
+#endif
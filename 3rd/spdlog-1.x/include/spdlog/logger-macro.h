@@ -2,38 +2,270 @@
 #define _LOGGER_MACRO_HEADER_H_
 
 #include "spdlog/spdlog.h"
+#include "spdlog/async_logger.h"
+#include "spdlog/details/thread_pool.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/sinks/daily_file_sink.h"
+#include "spdlog/logger-binary.h"
+#include "spdlog/logger-gauge.h"
+#include "spdlog/logger-limit.h"
+#include "spdlog/logger-flight.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spdlog {
+
+/*
+* calls callback every interval on a thread of its own until it is destroyed,
+* the periodic_worker of spdlog counts whole seconds, which is too coarse for --log.flush=interval
+*/
+class log_ticker
+{
+public:
+    log_ticker(const std::function<void()> &callback, std::chrono::milliseconds interval)
+        : callback_(callback)
+        , interval_(interval)
+        , active_(true)
+    {
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    log_ticker(const log_ticker &) = delete;
+    log_ticker &operator=(const log_ticker &) = delete;
+
+    ~log_ticker()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            active_ = false;
+        }
+        stopped_.notify_one();
+        thread_.join();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        while (!stopped_.wait_for(guard, interval_, [this]() { return !active_; }))
+        {
+            guard.unlock();
+            callback_();
+            guard.lock();
+        }
+    }
+
+private:
+    std::function<void()> callback_;
+    std::chrono::milliseconds interval_;
+
+    std::mutex lock_;
+    std::condition_variable stopped_;
+    bool active_;
+
+    std::thread thread_;
+};
+
+} // namespace spdlog
+
+/*
+* loggers are synchronous unless initialize_async is called before they are created, then all of them share one
+* backend thread which formats and writes the messages, the caller only queues them:
+*   queue_size      messages held in the queue
+*   drop_oldest     true to overrun the oldest queued message once the queue is full, false to block the caller
+* deinitialize writes out the queued messages before it returns,
+* the depth of the queue is counted by the gauge_logger put in front of each logger for its high water, see logger-gauge.h
+*
+* the loggers flush every message unless initialize_flush is called before they are created:
+*   flush_level     the loggers flush on the messages of this level and above, off for none
+*   interval_ms     all the loggers are flushed so often by a thread of its own, 0 for never
+*
+* make_binary turns a logger created here to write the records of logger-binary.h instead of text
+*
+* the messages of a call site are not limited unless initialize_limit is called before the loggers are created,
+* then a limit_logger is put in front of each logger, see logger-limit.h, so the suppressed ones are never queued:
+*   limits          messages a second per call site of each level
+*
+* nothing under the level of a logger is kept unless initialize_flight is called before the loggers are created,
+* then a flight_logger is put in front of each logger, see logger-flight.h, it records the messages of record_level
+* and above to a flight_recorder and passes those of the level of the logger and above on to it, limited or not
+*/
 #define DECLARE_SPDLOG(name) \
 class name \
 { \
 public: \
-    static void initialize_daily(const std::string& name, int hour, int minite, int maxfiles, spdlog::level::level_enum log_level) \
+    static void initialize_async(std::size_t queue_size, bool drop_oldest) \
     { \
-        auto daily_sink = std::make_shared<spdlog::sinks::daily_file_sink_mt>(name, hour, minite, false, maxfiles); \
-        daily_sink->set_level(log_level); \
-        daily_sink->set_pattern("[%H:%M:%S.%e %t %^%L%$] %v"); \
+        _thread_pool = std::make_shared<spdlog::details::thread_pool>(queue_size, 1); \
+        _overflow_policy = drop_oldest ? spdlog::async_overflow_policy::overrun_oldest : spdlog::async_overflow_policy::block; \
+        _gauge = std::make_shared<spdlog::async_gauge>(queue_size); \
+    } \
  \
-        spdlog::sinks_init_list sink_list{ daily_sink }; \
-        _logger = std::make_shared<spdlog::logger>("multi_sink", sink_list); \
+    static void initialize_flush(spdlog::level::level_enum flush_level, int interval_ms) \
+    { \
+        _flush_level = flush_level; \
+        if (interval_ms > 0) \
+        { \
+            _flusher.reset(new spdlog::log_ticker(&flush_all, std::chrono::milliseconds(interval_ms))); \
+        } \
+    } \
  \
-        _logger->set_level(log_level); \
-        _logger->flush_on(log_level); \
+    static void initialize_limit(const std::vector<int>& limits) \
+    { \
+        if (std::find_if(limits.begin(), limits.end(), [](int limit) { return limit > 0; }) != limits.end()) \
+        { \
+            _limits = limits; \
+        } \
     } \
  \
-    static void initialize_rotate(const std::string& name, std::size_t mb, int maxfiles, spdlog::level::level_enum log_level) \
+    static void initialize_flight(spdlog::level::level_enum record_level, std::size_t thread_bytes, std::size_t max_threads) \
+    { \
+        _recorder = std::make_shared<spdlog::flight_recorder>(record_level, thread_bytes, max_threads); \
+    } \
+ \
+    static std::shared_ptr<spdlog::logger> create_logger(const std::string& logger_name, spdlog::sink_ptr sink) \
+    { \
+        std::shared_ptr<spdlog::logger> log; \
+        if (_thread_pool) \
+        { \
+            log = std::make_shared<spdlog::async_logger>(logger_name, std::make_shared<spdlog::gauge_sink>(sink, _gauge), _thread_pool, _overflow_policy); \
+            log->flush_on(_flush_level); \
+            log = std::make_shared<spdlog::gauge_logger>(log, _gauge); \
+        } \
+        else \
+        { \
+            log = std::make_shared<spdlog::logger>(logger_name, sink); \
+            log->flush_on(_flush_level); \
+        } \
+ \
+        if (!_limits.empty()) \
+        { \
+            std::shared_ptr<spdlog::limit_logger> limited = std::make_shared<spdlog::limit_logger>(log, _limits); \
+            { \
+                std::lock_guard<std::mutex> guard(_flushed_lock); \
+                _limited.push_back(limited); \
+            } \
+            log = limited; \
+        } \
+ \
+        if (_recorder) \
+        { \
+            log = std::make_shared<spdlog::flight_logger>(_recorder, log); \
+        } \
+ \
+        if (_flusher) \
+        { \
+            std::lock_guard<std::mutex> guard(_flushed_lock); \
+            _flushed.push_back(log); \
+        } \
+        return log; \
+    } \
+ \
+    static void flush_all() \
+    { \
+        std::lock_guard<std::mutex> guard(_flushed_lock); \
+        for (std::vector<std::weak_ptr<spdlog::logger>>::iterator it = _flushed.begin(); it != _flushed.end();) \
+        { \
+            std::shared_ptr<spdlog::logger> log = it->lock(); \
+            if (log) \
+            { \
+                log->flush(); \
+                ++it; \
+            } \
+            else \
+            { \
+                it = _flushed.erase(it); \
+            } \
+        } \
+    } \
+ \
+    static std::shared_ptr<spdlog::logger> create_sink(const std::string& logger_name, spdlog::sink_ptr sink, spdlog::level::level_enum log_level) \
+    { \
+        sink->set_level(log_level); \
+        sink->set_pattern("[%H:%M:%S.%e %t %^%L%$] %v"); \
+ \
+        auto log = create_logger(logger_name, sink); \
+ \
+        set_level(log, log_level); \
+        return log; \
+    } \
+ \
+    /* the loggers behind a front logger take the level too, a flight logger takes the messages under it to record them */ \
+    static void set_level(const std::shared_ptr<spdlog::logger>& log, spdlog::level::level_enum log_level) \
+    { \
+        spdlog::flight_gate* gate = dynamic_cast<spdlog::flight_gate*>(log.get()); \
+        if (gate) \
+        { \
+            gate->set_pass_level(log_level); \
+            log->set_level(std::min(log_level, gate->recorder()->record_level())); \
+        } \
+        else \
+        { \
+            log->set_level(log_level); \
+        } \
+ \
+        spdlog::front_logger* front = dynamic_cast<spdlog::front_logger*>(log.get()); \
+        if (front) \
+        { \
+            set_level(front->inner(), log_level); \
+        } \
+    } \
+ \
+    static spdlog::level::level_enum get_level(const std::shared_ptr<spdlog::logger>& log) \
+    { \
+        spdlog::flight_gate* gate = dynamic_cast<spdlog::flight_gate*>(log.get()); \
+        return gate ? gate->pass_level() : log->level(); \
+    } \
+ \
+    static std::shared_ptr<spdlog::logger> create_daily(const std::string& logger_name, const std::string& name, int hour, int minite, int maxfiles, spdlog::level::level_enum log_level) \
+    { \
+        auto daily_sink = std::make_shared<spdlog::sinks::daily_file_sink_mt>(name, hour, minite, false, maxfiles); \
+        return create_sink(logger_name, daily_sink, log_level); \
+    } \
+ \
+    static std::shared_ptr<spdlog::logger> create_rotate(const std::string& logger_name, const std::string& name, std::size_t mb, int maxfiles, spdlog::level::level_enum log_level) \
     { \
         auto rotate_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(name, mb << 20, maxfiles); \
-        rotate_sink->set_level(log_level); \
-        rotate_sink->set_pattern("[%H:%M:%S.%e %t %^%L%$] %v"); \
+        return create_sink(logger_name, rotate_sink, log_level); \
+    } \
  \
-        spdlog::sinks_init_list sink_list{ rotate_sink }; \
-        _logger = std::make_shared<spdlog::logger>("multi_sink", sink_list); \
+    /* the logger which holds the sinks, behind the front loggers */ \
+    static std::shared_ptr<spdlog::logger> back_of(std::shared_ptr<spdlog::logger> log) \
+    { \
+        spdlog::front_logger* front = nullptr; \
+        while ((front = dynamic_cast<spdlog::front_logger*>(log.get())) != nullptr) \
+        { \
+            log = front->inner(); \
+        } \
+        return log; \
+    } \
+ \
+    static void make_binary(const std::shared_ptr<spdlog::logger>& log) \
+    { \
+        back_of(log)->set_formatter(spdlog::details::make_unique<spdlog::binary_formatter>()); \
+    } \
+ \
+    static void initialize(const std::shared_ptr<spdlog::logger>& log) \
+    { \
+        _logger = log; \
+    } \
  \
-        _logger->set_level(log_level); \
-        _logger->flush_on(log_level); \
+    static void initialize_daily(const std::string& name, int hour, int minite, int maxfiles, spdlog::level::level_enum log_level) \
+    { \
+        _logger = create_daily("multi_sink", name, hour, minite, maxfiles, log_level); \
+    } \
+ \
+    static void initialize_rotate(const std::string& name, std::size_t mb, int maxfiles, spdlog::level::level_enum log_level) \
+    { \
+        _logger = create_rotate("multi_sink", name, mb, maxfiles, log_level); \
     } \
  \
     static std::shared_ptr<spdlog::logger> logger() \
@@ -47,9 +279,9 @@ public: \
         if (level >= spdlog::level::trace && level <= spdlog::level::off) \
         { \
             spdlog::level::level_enum to = (spdlog::level::level_enum)level; \
-            spdlog::level::level_enum from = _logger->level(); \
+            spdlog::level::level_enum from = get_level(_logger); \
             _logger->info("change log level from {} to {} success", level_name[from], level_name[to]); \
-            _logger->set_level(to); \
+            set_level(_logger, to); \
             return 0; \
         }  \
         else \
@@ -58,14 +290,87 @@ public: \
             return -400; \
         } \
     } \
+ \
+    static bool async() \
+    { \
+        return _thread_pool != nullptr; \
+    } \
+ \
+    static std::size_t async_high_water() \
+    { \
+        return _gauge ? _gauge->high_water() : 0; \
+    } \
+ \
+    static std::size_t async_dropped() \
+    { \
+        return _thread_pool ? _thread_pool->overrun_counter() : 0; \
+    } \
+ \
+    static std::shared_ptr<spdlog::flight_recorder> recorder() \
+    { \
+        return _recorder; \
+    } \
+ \
+    static unsigned long long limit_suppressed() \
+    { \
+        unsigned long long suppressed = 0; \
+        std::lock_guard<std::mutex> guard(_flushed_lock); \
+        for (std::vector<std::weak_ptr<spdlog::limit_logger>>::iterator it = _limited.begin(); it != _limited.end();) \
+        { \
+            std::shared_ptr<spdlog::limit_logger> limited = it->lock(); \
+            if (limited) \
+            { \
+                suppressed += limited->suppressed(); \
+                ++it; \
+            } \
+            else \
+            { \
+                it = _limited.erase(it); \
+            } \
+        } \
+        return suppressed; \
+    } \
  \
     static void deinitialize() \
     { \
+        _flusher.reset(); \
+        { \
+            std::lock_guard<std::mutex> guard(_flushed_lock); \
+            _flushed.clear(); \
+        } \
+ \
+        if (_thread_pool && _logger) \
+        { \
+            _logger->info("async log queue high water {}, {} messages dropped", async_high_water(), _thread_pool->overrun_counter()); \
+        } \
+        if (!_limits.empty() && _logger) \
+        { \
+            _logger->info("{} messages suppressed by the log limits", limit_suppressed()); \
+        } \
         _logger = nullptr; \
+        _recorder = nullptr; \
+ \
+        /* the backend thread writes out the queued messages before it is joined */ \
+        _thread_pool = nullptr; \
+        _gauge = nullptr; \
     } \
  \
 private: \
     static std::shared_ptr<spdlog::logger> _logger; \
+ \
+    static std::shared_ptr<spdlog::details::thread_pool> _thread_pool; \
+    static spdlog::async_overflow_policy _overflow_policy; \
+    static std::shared_ptr<spdlog::async_gauge> _gauge; \
+ \
+    static spdlog::level::level_enum _flush_level; \
+    static std::unique_ptr<spdlog::log_ticker> _flusher; \
+    static std::vector<std::weak_ptr<spdlog::logger>> _flushed; \
+    static std::mutex _flushed_lock; \
+ \
+    static std::vector<int> _limits; \
+    static std::vector<std::weak_ptr<spdlog::limit_logger>> _limited; \
+ \
+    static std::shared_ptr<spdlog::flight_recorder> _recorder; \
  \
 private: \
     name(); \
@@ -73,11 +378,31 @@ private: \
     name& operator=(const name&); \
 }
 
-#define IMPLEMENT_SPDLOG(name) std::shared_ptr<spdlog::logger> name::_logger
+#define IMPLEMENT_SPDLOG(name) \
+std::shared_ptr<spdlog::details::thread_pool> name::_thread_pool; \
+spdlog::async_overflow_policy name::_overflow_policy = spdlog::async_overflow_policy::block; \
+std::shared_ptr<spdlog::async_gauge> name::_gauge; \
+spdlog::level::level_enum name::_flush_level = spdlog::level::trace; \
+std::unique_ptr<spdlog::log_ticker> name::_flusher; \
+std::vector<std::weak_ptr<spdlog::logger>> name::_flushed; \
+std::mutex name::_flushed_lock; \
+std::vector<int> name::_limits; \
+std::vector<std::weak_ptr<spdlog::limit_logger>> name::_limited; \
+std::shared_ptr<spdlog::flight_recorder> name::_recorder; \
+std::shared_ptr<spdlog::logger> name::_logger
 
-/********************************************************************************************************************************************/
-/* logging::logger()->log(spdlog::source_loc{ __FILE__, __LINE__, __FUNCTION__ }, spdlog::level::info, "BusinessServer startup success");   */
-/********************************************************************************************************************************************/
+/*
+* log with the call site, which the limits count the messages of rather than their text, see logger-limit.h:
+*   LOGGING_INFO(logging::logger(), "BusinessServer startup success, {} workers", workers);
+* unlike SPDLOG_LOGGER_INFO none of them is compiled out by SPDLOG_ACTIVE_LEVEL, the level of the logger decides
+*/
+#define LOGGING_CALL(log_ptr, log_level, ...) (log_ptr)->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, log_level, __VA_ARGS__)
+#define LOGGING_TRACE(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::trace, __VA_ARGS__)
+#define LOGGING_DEBUG(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::debug, __VA_ARGS__)
+#define LOGGING_INFO(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::info, __VA_ARGS__)
+#define LOGGING_WARN(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::warn, __VA_ARGS__)
+#define LOGGING_ERROR(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::err, __VA_ARGS__)
+#define LOGGING_CRITICAL(log_ptr, ...) LOGGING_CALL(log_ptr, spdlog::level::critical, __VA_ARGS__)
 
 #endif
 
@@ -4,17 +4,76 @@
 
 #include "spdlog/logging.h"
 
+#include <stddef.h>
+
+// the export of the module functions, and the calling convention the loader and the modules call each other by
+#ifdef _WIN32
 #define SERVICE_MODULE_C_API extern "C" __declspec(dllexport)
+#define SERVICE_CALL __cdecl
+#else
+#define SERVICE_MODULE_C_API extern "C" __attribute__((visibility("default")))
+#define SERVICE_CALL
+#endif
 
 #define Service_Module_Failed -1
 #define Service_Module_Success 0
 
-typedef int(__cdecl *IsServiceRunning)();
+// user-defined SCM control code, the loader reloads the services whose library or configuration is replaced
+#define Service_Control_Reload 128
+
+// user-defined SCM control code, the loader dumps its flight recorder, see --log.flight
+#define Service_Control_Flight 129
+
+typedef int(SERVICE_CALL *IsServiceRunning)();
+
+typedef void(SERVICE_CALL *ServiceStopCallback)(void* context);
+
+typedef void(SERVICE_CALL *ServiceHeartbeat)();
+
+#ifdef _WIN32
+// manual-reset event HANDLE, signaled once the service is asked to stop
+typedef void* ServiceStopHandle;
+#else
+// file descriptor which turns readable once the service is asked to stop, poll it but never read it
+typedef int ServiceStopHandle;
+#endif
+
+/*
+* handed to Service_RunEx, lets the service block on its own handles and the stop request together
+*/
+struct ServiceStopToken
+{
+    // sizeof(ServiceStopToken) of the loader, fields may only be appended
+    size_t size;
+
+    ServiceStopHandle handle;
+
+    // same as the parameter of Service_Run
+    IsServiceRunning is_running;
+
+    // callback is invoked on the control thread when the stop is requested, at once if it is requested already
+    int(SERVICE_CALL *register_callback)(ServiceStopCallback callback, void* context);
+
+    // tells the watchdog of the loader that the service is alive, is_running does so as well
+    ServiceHeartbeat heartbeat;
+};
+
+// for the loops which block without asking is_running, a no-op with the loaders which hand no heartbeat
+inline void Service_Heartbeat(const ServiceStopToken* token)
+{
+    if (token->size >= offsetof(ServiceStopToken, heartbeat) + sizeof(token->heartbeat) && token->heartbeat)
+    {
+        token->heartbeat();
+    }
+}
+
+SERVICE_MODULE_C_API int SERVICE_CALL Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path);
 
-SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path);
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Run(IsServiceRunning Is_Service_Running);
 
-SERVICE_MODULE_C_API void __cdecl Service_Run(IsServiceRunning Is_Service_Running);
+// optional, preferred by the loader over Service_Run when exported
+SERVICE_MODULE_C_API void SERVICE_CALL Service_RunEx(const ServiceStopToken* token);
 
-SERVICE_MODULE_C_API void __cdecl Service_Destroy();
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Destroy();
 
 #endif
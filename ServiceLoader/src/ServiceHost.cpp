@@ -0,0 +1,634 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+#include "ServiceHost.h"
+#include "ServiceLogRing.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+
+#include <string.h>
+
+static std::unordered_map<std::string, int> Log_Level_Name_To_Enum = {
+    { "trace", spdlog::level::trace },
+    { "debug", spdlog::level::debug },
+    { "info", spdlog::level::info },
+    { "warn", spdlog::level::warn },
+    { "error", spdlog::level::err },
+    { "fatal", spdlog::level::critical },
+    { "off", spdlog::level::off }
+};
+
+static bool MakeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    return _access(path.c_str(), 00) == 0 || _mkdir(path.c_str()) == 0;
+#else
+    return access(path.c_str(), F_OK) == 0 || mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+static spdlog::level::level_enum GetLogLevel(const std::string& name, spdlog::level::level_enum default_level = spdlog::level::info)
+{
+    std::unordered_map<std::string, int>::iterator lfound = Log_Level_Name_To_Enum.find(name);
+    if (lfound != Log_Level_Name_To_Enum.end())
+    {
+        return (spdlog::level::level_enum)lfound->second;
+    }
+    return default_level;
+}
+
+static std::string NormalizeLogName(std::string log_name)
+{
+    // replace invalid char
+    std::for_each(log_name.begin(), log_name.end(), [](char& ch) {
+        if (!std::isdigit(ch) && !std::isalpha(ch) && '-' != ch && '_' != ch && '.' != ch)
+        {
+            ch = '-';
+        }
+    });
+
+    // process log suffix
+    std::string::size_type pos = log_name.find_last_of('.');
+    if (std::string::npos != pos)
+    {
+        std::string ext = log_name.substr(pos);
+        std::for_each(ext.begin(), ext.end(), [](char& ch) {
+            if (ch >= 'A' && ch <= 'Z')
+            {
+                ch = ch + ('a' - 'A');
+            }
+        });
+
+        if (".txt" != ext && ".log" != ext)
+        {
+            log_name = log_name.substr(0, pos) + ".log";
+        }
+    }
+    else
+    {
+        log_name = log_name + ".log";
+    }
+    return log_name;
+}
+
+// a binary log is named .blog, as it is no text to read but to decode by --log.decode
+static std::string GetLogFile(const std::string& log_name, const std::string& format)
+{
+    if ("binary" != format)
+    {
+        return log_name;
+    }
+    return log_name.substr(0, log_name.find_last_of('.')) + ".blog";
+}
+
+/*
+* the flight recorder of --log.flight and where it is dumped, kept to the end of the process for the crash handlers,
+* which neither allocate nor lock
+*/
+static struct
+{
+    std::shared_ptr<spdlog::flight_recorder> recorder;
+    char file[1024] = { 0 };
+    std::atomic<bool> crashed;
+} Flight;
+
+// the records dumped, -1 if the file can not be written
+static long long WriteFlightFile(const char* file)
+{
+#ifdef _WIN32
+    HANDLE out = CreateFileA(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == out)
+    {
+        return -1;
+    }
+
+    long long dumped = (long long)Flight.recorder->dump([out](const char* data, size_t size) {
+        DWORD written = 0;
+        return WriteFile(out, data, (DWORD)size, &written, NULL) && written == (DWORD)size;
+    });
+    CloseHandle(out);
+#else
+    int out = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0)
+    {
+        return -1;
+    }
+
+    long long dumped = (long long)Flight.recorder->dump([out](const char* data, size_t size) {
+        while (size > 0)
+        {
+            ssize_t written = write(out, data, size);
+            if (written < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return false;
+            }
+            data += written;
+            size -= (size_t)written;
+        }
+        return true;
+    });
+    close(out);
+#endif
+    return dumped;
+}
+
+// once per process, the file is left as it is for the manager to fetch after the restart
+static void DumpFlightOnCrash()
+{
+    if (Flight.recorder && !Flight.crashed.exchange(true))
+    {
+        WriteFlightFile(Flight.file);
+    }
+}
+
+static void FlightTerminateHandler()
+{
+    DumpFlightOnCrash();
+    abort();
+}
+
+#ifdef _WIN32
+static LONG WINAPI FlightExceptionFilter(EXCEPTION_POINTERS*)
+{
+    DumpFlightOnCrash();
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void InstallFlightHandlers()
+{
+    SetUnhandledExceptionFilter(FlightExceptionFilter);
+    std::set_terminate(FlightTerminateHandler);
+}
+#else
+// the default action is taken once dumped, the signal is raised again when the handler returns
+static void FlightSignalHandler(int)
+{
+    DumpFlightOnCrash();
+}
+
+static void InstallFlightHandlers()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = FlightSignalHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    const int fatal_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    for (int fatal_signal : fatal_signals)
+    {
+        sigaction(fatal_signal, &action, NULL);
+    }
+    std::set_terminate(FlightTerminateHandler);
+}
+#endif
+
+// bytes of the ring a logger writes to rather than its file, 0 unless --log.aggregate=on
+static size_t GetLogRingSize(const ServiceParameters& params)
+{
+    if ("on" != ServiceHost::GetParameter(params, "log.aggregate", "off") || "on" == ServiceHost::GetParameter(params, "log.aggregator", "off"))
+    {
+        return 0;
+    }
+
+    int ring_size = atoi(ServiceHost::GetParameter(params, "log.ring_size", "1024").c_str());
+    return (size_t)(ring_size > 0 ? ring_size : 1024) << 10;
+}
+
+// the logger of logs/<file>
+static std::shared_ptr<spdlog::logger> CreateLogger(const std::string& path, const std::string& name, const std::string& file, const std::string& type, const std::string& format, spdlog::level::level_enum level, int size, int keep, size_t ring_size)
+{
+    if (spdlog::level::off == level)
+    {
+        std::shared_ptr<spdlog::logger> log = std::make_shared<spdlog::logger>(name, spdlog::sinks_init_list{});
+        log->set_level(level);
+        return log;
+    }
+
+    std::string log_file = GetLogFile(file, format);
+
+    std::shared_ptr<spdlog::logger> log;
+    bool ring_failed = false;
+    if (ring_size > 0)
+    {
+        std::shared_ptr<ServiceLogRing> ring = std::make_shared<ServiceLogRing>(path, log_file);
+        if (ring->Create(type, size, keep, ring_size))
+        {
+            log = logging::create_sink(name, std::make_shared<ServiceLogRingSink>(ring), level);
+        }
+        ring_failed = !log;
+    }
+
+    if (!log)
+    {
+        std::string log_path = path + "logs" SERVICE_PATH_SEPARATOR;
+        if ("daily" == type)
+        {
+            log = logging::create_daily(name, log_path + log_file, 0, 0, keep, level);
+        }
+        else
+        {
+            log = logging::create_rotate(name, log_path + log_file, (size_t)size, keep, level);
+        }
+    }
+
+    if ("binary" == format)
+    {
+        logging::make_binary(log);
+    }
+
+    if (ring_failed)
+    {
+        log->warn("log ring of {} can not be created, the file is written instead", log_file.c_str());
+    }
+    return log;
+}
+
+void ServiceHost::ParseCommand(int argc, char* argv[], int first, std::string& path, std::string& exec, ServiceParameters& params)
+{
+    // parse the command
+    {
+        char* command = argv[0];
+        int pos = (int)strlen(command) - 1;
+        while (pos >= 0)
+        {
+            if (command[pos] == '\\' || command[pos] == '/')
+            {
+                break;
+            }
+            --pos;
+        }
+        path = std::string(command, command + pos + 1);
+        exec = std::string(command + pos + 1);
+    }
+
+    // parse the parameter
+    for (int i = first; i < argc; ++i)
+    {
+        char* dict = argv[i];
+        int spos = 0;
+        while (dict[spos] == '-')
+        {
+            ++spos;
+        }
+
+        // split at the first '=', the value may hold more, as --log.flush=interval=1000
+        char* equal = strchr(dict + spos, '=');
+        if (NULL != equal && equal > dict + spos)
+        {
+            params[std::string(dict + spos, equal)] = std::string(equal + 1);
+        }
+    }
+}
+
+std::string ServiceHost::GetParameter(const ServiceParameters& params, const std::string& key, const std::string& default_value)
+{
+    ServiceParameters::const_iterator found = params.find(key);
+    if (found != params.end() && !found->second.empty())
+    {
+        return found->second;
+    }
+    return default_value;
+}
+
+bool ServiceHost::InitializeLog(const std::string& path, const std::string& command, const ServiceParameters& params)
+{
+    spdlog::level::level_enum log_level = GetLogLevel(GetParameter(params, "log.level", "info"));
+    if (log_level == spdlog::level::off)
+    {
+        return true;
+    }
+
+    std::string log_path = path + "logs" SERVICE_PATH_SEPARATOR;
+    if (!MakeDirectory(log_path))
+    {
+        return false;
+    }
+
+    std::string log_name = GetLogName(command, params);
+
+    std::string log_type = GetParameter(params, "log.type", "daily");
+    std::string log_format = GetParameter(params, "log.format", "text");
+
+    int log_size = atoi(GetParameter(params, "log.size", "80").c_str());
+    if (log_size <= 0)
+    {
+        log_size = 80;
+    }
+
+    int log_keep = atoi(GetParameter(params, "log.keep", "7").c_str());
+    if (log_keep <= 0)
+    {
+        log_keep = 7;
+    }
+
+    // always by default, interval=<ms> flushes periodically, level=<lvl> flushes on the messages of lvl and above
+    std::string log_flush = GetParameter(params, "log.flush", "always");
+    if (0 == log_flush.compare(0, 9, "interval="))
+    {
+        int log_interval = atoi(log_flush.c_str() + 9);
+        logging::initialize_flush(spdlog::level::off, log_interval > 0 ? log_interval : 1000);
+    }
+    else if (0 == log_flush.compare(0, 6, "level="))
+    {
+        logging::initialize_flush(GetLogLevel(log_flush.substr(6), spdlog::level::warn), 0);
+    }
+
+    // a service flooding its log with one message is cut to so many a second, the rest is summed up
+    int log_limit = atoi(GetParameter(params, "log.limit", "0").c_str());
+    std::vector<int> log_limits(spdlog::level::off, log_limit > 0 ? log_limit : 0);
+    for (const std::unordered_map<std::string, int>::value_type& level : Log_Level_Name_To_Enum)
+    {
+        if (spdlog::level::off != level.second)
+        {
+            int level_limit = atoi(GetParameter(params, "log.limit." + level.first, std::to_string(log_limits[level.second])).c_str());
+            log_limits[level.second] = level_limit > 0 ? level_limit : 0;
+        }
+    }
+    logging::initialize_limit(log_limits);
+
+    // the loggers created later record the messages of this level and above, whatever their own level
+    spdlog::level::level_enum flight_level = GetLogLevel(GetParameter(params, "log.flight", "off"), spdlog::level::off);
+    if (spdlog::level::off != flight_level)
+    {
+        int flight_size = atoi(GetParameter(params, "log.flight_size", "64").c_str());
+        int flight_threads = atoi(GetParameter(params, "log.flight_threads", "64").c_str());
+        logging::initialize_flight(flight_level, (size_t)(flight_size > 0 ? flight_size : 64) << 10, (size_t)(flight_threads > 0 ? flight_threads : 64));
+
+        std::string flight_file = log_path + log_name.substr(0, log_name.find_last_of('.')) + ".flight.blog";
+        if (flight_file.size() < sizeof(Flight.file))
+        {
+            memcpy(Flight.file, flight_file.c_str(), flight_file.size() + 1);
+            Flight.recorder = logging::recorder();
+            InstallFlightHandlers();
+        }
+    }
+
+    // the module loggers created later share the queue
+    if ("on" == GetParameter(params, "log.async", "off"))
+    {
+        int log_queue = atoi(GetParameter(params, "log.async_queue", "8192").c_str());
+        if (log_queue <= 0)
+        {
+            log_queue = 8192;
+        }
+
+        logging::initialize_async((size_t)log_queue, "drop_oldest" == GetParameter(params, "log.async_overflow", "block"));
+    }
+
+    logging::initialize(CreateLogger(path, "multi_sink", log_name, log_type, log_format, log_level, log_size, log_keep, GetLogRingSize(params)));
+    return true;
+}
+
+int ServiceHost::DecodeLog(const std::string& file)
+{
+    FILE* in = fopen(file.c_str(), "rb");
+    if (NULL == in)
+    {
+        fprintf(stderr, "binary log(%s) can not be opened\n", file.c_str());
+        return -1;
+    }
+
+#ifdef _WIN32
+    // the records hold the line ends already
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    bool decoded = spdlog::decode_binary_log(in, stdout);
+    fclose(in);
+
+    if (!decoded)
+    {
+        fprintf(stderr, "binary log(%s) is broken\n", file.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+bool ServiceHost::DumpFlightRecorder()
+{
+    if (!Flight.recorder)
+    {
+        return false;
+    }
+
+    // replaced as a whole, as the manager may be reading the last one
+    std::string tmp_file = std::string(Flight.file) + ".tmp";
+    long long dumped = WriteFlightFile(tmp_file.c_str());
+    if (dumped < 0)
+    {
+        logging::logger()->error("flight recorder can not be dumped to {}", tmp_file.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    bool replaced = MoveFileEx(tmp_file.c_str(), Flight.file, MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    bool replaced = rename(tmp_file.c_str(), Flight.file) == 0;
+#endif
+    if (!replaced)
+    {
+        logging::logger()->error("flight recorder can not be dumped to {}", Flight.file);
+        return false;
+    }
+
+    logging::logger()->info("flight recorder dumped {} messages to {}, {} messages of the threads beyond missed", dumped, Flight.file, Flight.recorder->missed());
+    return true;
+}
+
+bool ServiceHost::WriteStatusFile(const std::string& file, const std::string& content)
+{
+    std::string tmp_file = file + ".tmp";
+    {
+        std::ofstream ofs(tmp_file, std::ios::trunc);
+        if (!ofs.is_open())
+        {
+            return false;
+        }
+        ofs << content;
+    }
+
+#ifdef _WIN32
+    return MoveFileEx(tmp_file.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    return rename(tmp_file.c_str(), file.c_str()) == 0;
+#endif
+}
+
+std::string ServiceHost::GetLogName(const std::string& command, const ServiceParameters& params)
+{
+    std::string log_name = command;
+    std::string::size_type pos = log_name.find_last_of('/');
+    if (std::string::npos == pos)
+    {
+        pos = log_name.find_last_of('\\');
+    }
+    if (std::string::npos != pos)
+    {
+        log_name = log_name.substr(pos + 1);
+    }
+    return NormalizeLogName(GetParameter(params, "log.name", log_name));
+}
+
+/*
+* the modules listed by --service.host each log to a file of their own, for example
+* {
+*     "modules": [
+*         { "name": "sample", "lib": "services\\ServiceSample\\ServiceSample.dll", "config": "conf\\sample.json", "log": { "level": "info", "format": "binary" } }
+*     ]
+* }
+* log.name defaults to the module name, the other log options default to the loader's
+*/
+bool ServiceHost::CreateModules(const std::string& path, const ServiceParameters& params, ServiceModules& modules)
+{
+    std::string host_file = GetParameter(params, "service.host", "");
+    if (host_file.empty())
+    {
+        std::string service_lib = GetParameter(params, "service.lib", "");
+        if (service_lib.empty())
+        {
+            logging::logger()->error("module parameter(--service.lib) is not provided");
+            return false;
+        }
+
+        std::string service_config = GetParameter(params, "service.config", "");
+        if (!service_config.empty())
+        {
+            service_config = path + service_config;
+        }
+
+        modules.emplace_back(new ServiceModule(service_lib, path + service_lib, service_config, logging::logger()));
+        return true;
+    }
+
+    std::ifstream ifs(path + host_file);
+    if (!ifs.is_open())
+    {
+        logging::logger()->error("service host file({}) does not exist", host_file.c_str());
+        return false;
+    }
+
+    std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    rapidjson::Document doc;
+    doc.Parse(content.c_str());
+    if (!doc.IsObject() || !doc.HasMember("modules") || !doc["modules"].IsArray())
+    {
+        logging::logger()->error("service host file({}) is invalid: modules is not provided", host_file.c_str());
+        return false;
+    }
+
+    const rapidjson::Value& modules_json = doc["modules"];
+    if (modules_json.Size() > ServiceModule::Max_Modules)
+    {
+        logging::logger()->error("service host file({}) is invalid: more than {} modules", host_file.c_str(), ServiceModule::Max_Modules);
+        return false;
+    }
+
+    std::string log_path = path + "logs" SERVICE_PATH_SEPARATOR;
+    if (!MakeDirectory(log_path))
+    {
+        logging::logger()->error("log path(logs) does not exist");
+        return false;
+    }
+
+    for (rapidjson::SizeType i = 0; i < modules_json.Size(); ++i)
+    {
+        const rapidjson::Value& module_json = modules_json[i];
+        if (!module_json.IsObject() || !module_json.HasMember("name") || !module_json["name"].IsString() || !module_json.HasMember("lib") || !module_json["lib"].IsString())
+        {
+            logging::logger()->error("service host file({}) is invalid: name or lib of module({}) is not string", host_file.c_str(), i);
+            return false;
+        }
+
+        std::string name = module_json["name"].GetString();
+        std::string lib = module_json["lib"].GetString();
+
+        std::string config;
+        if (module_json.HasMember("config") && module_json["config"].IsString())
+        {
+            config = path + module_json["config"].GetString();
+        }
+
+        std::string log_name = name;
+        std::string log_type = GetParameter(params, "log.type", "daily");
+        std::string log_level = GetParameter(params, "log.level", "info");
+        std::string log_format = GetParameter(params, "log.format", "text");
+        int log_size = atoi(GetParameter(params, "log.size", "80").c_str());
+        int log_keep = atoi(GetParameter(params, "log.keep", "7").c_str());
+        if (module_json.HasMember("log") && module_json["log"].IsObject())
+        {
+            const rapidjson::Value& log_json = module_json["log"];
+            if (log_json.HasMember("name") && log_json["name"].IsString())
+            {
+                log_name = log_json["name"].GetString();
+            }
+            if (log_json.HasMember("type") && log_json["type"].IsString())
+            {
+                log_type = log_json["type"].GetString();
+            }
+            if (log_json.HasMember("level") && log_json["level"].IsString())
+            {
+                log_level = log_json["level"].GetString();
+            }
+            if (log_json.HasMember("format") && log_json["format"].IsString())
+            {
+                log_format = log_json["format"].GetString();
+            }
+            if (log_json.HasMember("size") && log_json["size"].IsInt())
+            {
+                log_size = log_json["size"].GetInt();
+            }
+            if (log_json.HasMember("keep") && log_json["keep"].IsInt())
+            {
+                log_keep = log_json["keep"].GetInt();
+            }
+        }
+
+        std::shared_ptr<spdlog::logger> module_logger = CreateLogger(path, name, NormalizeLogName(log_name), log_type, log_format, GetLogLevel(log_level), log_size > 0 ? log_size : 80, log_keep > 0 ? log_keep : 7, GetLogRingSize(params));
+
+        modules.emplace_back(new ServiceModule(name, path + lib, config, module_logger));
+    }
+
+    return !modules.empty();
+}
+
+int ServiceHost::ReloadModules(ServiceModules& modules)
+{
+    int reloaded = 0;
+    for (std::unique_ptr<ServiceModule>& module : modules)
+    {
+        if (!module->Changed())
+        {
+            continue;
+        }
+
+        if (module->Reload())
+        {
+            ++reloaded;
+        }
+    }
+    logging::logger()->info("{} of {} service modules reloaded", reloaded, modules.size());
+    return reloaded;
+}
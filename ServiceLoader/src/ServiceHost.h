@@ -0,0 +1,69 @@
+#ifndef _SERVICE_HOST_HEADER_H_
+#define _SERVICE_HOST_HEADER_H_
+
+#include "ServiceModule.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define SERVICE_PATH_SEPARATOR "\\"
+#else
+#define SERVICE_PATH_SEPARATOR "/"
+#endif
+
+typedef std::unordered_map<std::string, std::string> ServiceParameters;
+typedef std::vector<std::unique_ptr<ServiceModule>> ServiceModules;
+
+/*
+* what the loader backends share: the command line, the loader log and the modules to host
+*/
+class ServiceHost
+{
+public:
+    // path and exec are split from argv[0], --key=value pairs are taken from argv[first] on
+    static void ParseCommand(int argc, char* argv[], int first, std::string& path, std::string& exec, ServiceParameters& params);
+
+    static std::string GetParameter(const ServiceParameters& params, const std::string& key, const std::string& default_value);
+
+    // by --log.*, the log is named after the command unless --log.name is given,
+    // --log.async=on queues the messages of all the loggers to one writer thread:
+    //   --log.async_queue=8192                  messages held in the queue
+    //   --log.async_overflow=block|drop_oldest  what a full queue does to the caller
+    // --log.flush=always|interval=<ms>|level=<lvl> flushes every message, periodically or on lvl and above
+    // --log.format=text|binary, a binary log is written to <name>.blog, much cheaper than the text but to decode
+    // --log.aggregate=on writes to a shared memory ring which an aggregator drains to the file, see ServiceLogRing
+    // --log.limit=<n> passes n messages a second of a call site, --log.limit.<lvl>=<n> of the level, 0 for no limit
+    // --log.flight=<lvl> records the messages of lvl and above in memory whatever --log.level is, see logger-flight.h:
+    //   --log.flight_size=64      KB of the ring of a thread
+    //   --log.flight_threads=64   threads recorded at most
+    // dumped to logs/<name>.flight.blog on a crash or by DumpFlightRecorder
+    static bool InitializeLog(const std::string& path, const std::string& command, const ServiceParameters& params);
+
+    // --log.decode=<file>, renders a binary log to stdout as text
+    static int DecodeLog(const std::string& file);
+
+    // the messages recorded by --log.flight, false if it is off
+    static bool DumpFlightRecorder();
+
+    // replaces the file as a whole, the readers never see it half written
+    static bool WriteStatusFile(const std::string& file, const std::string& content);
+
+    // file name of the log under logs/ which InitializeLog opens
+    static std::string GetLogName(const std::string& command, const ServiceParameters& params);
+
+    // the module of --service.lib, or the modules listed by --service.host
+    static bool CreateModules(const std::string& path, const ServiceParameters& params, ServiceModules& modules);
+
+    // reload the modules whose library or configuration is replaced, the others keep running
+    static int ReloadModules(ServiceModules& modules);
+
+private:
+    ServiceHost();
+    ServiceHost(const ServiceHost&);
+    ServiceHost& operator=(const ServiceHost&);
+};
+
+#endif
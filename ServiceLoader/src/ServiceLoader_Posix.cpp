@@ -0,0 +1,363 @@
+
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "spdlog/logging.h"
+
+#include "ServiceHost.h"
+#include "ServiceSupervisor.h"
+#include "ServiceWatchdog.h"
+#include "ServiceLogAggregator.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+IMPLEMENT_SPDLOG(logging);
+
+static struct
+{
+    std::string        path;
+    std::string        exec;
+    ServiceParameters  params;
+
+    std::mutex              lock;
+    std::condition_variable wakeup;
+    bool                    stopping = false;
+    bool                    reloading = false;
+    int                     running = 0;
+
+    // set in supervisor mode, the signals are forwarded to it
+    ServiceSupervisor*      supervisor = nullptr;
+
+    // set in aggregator mode, stopped by the stop signals
+    ServiceLogAggregator*   aggregator = nullptr;
+} service;
+
+/*
+* sd_notify protocol: newline separated KEY=VALUE datagrams sent to the unix socket named by --service.notify,
+* or by NOTIFY_SOCKET when run by systemd, a leading '@' stands for the abstract namespace
+*/
+static void NotifyServiceState(const std::string& state)
+{
+    // the supervisor notifies for its worker
+    if (!ServiceHost::GetParameter(service.params, "service.worker", "").empty())
+    {
+        return;
+    }
+
+    std::string socket_path = ServiceHost::GetParameter(service.params, "service.notify", "");
+    if (socket_path.empty())
+    {
+        const char* notify_socket = getenv("NOTIFY_SOCKET");
+        if (notify_socket)
+        {
+            socket_path = notify_socket;
+        }
+    }
+
+    struct sockaddr_un addr;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path))
+    {
+        return;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+    if ('@' == addr.sun_path[0])
+    {
+        addr.sun_path[0] = 0;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        logging::logger()->warn("notify service state({}) failed: {}", state.c_str(), strerror(errno));
+        return;
+    }
+
+    socklen_t addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + socket_path.size());
+    if (sendto(fd, state.c_str(), state.size(), MSG_NOSIGNAL, (struct sockaddr*)&addr, addr_len) < 0)
+    {
+        logging::logger()->warn("notify service state({}) failed: {}", state.c_str(), strerror(errno));
+    }
+    close(fd);
+}
+
+static void ServiceSignalRoutine(sigset_t signals)
+{
+    int signal_number = 0;
+    while (sigwait(&signals, &signal_number) == 0)
+    {
+        // SIGUSR1 dumps the flight recorder, of the worker in supervisor mode
+        if (SIGUSR1 == signal_number)
+        {
+            {
+                std::lock_guard<std::mutex> guard(service.lock);
+                if (service.supervisor)
+                {
+                    service.supervisor->DumpFlightRecorder();
+                    continue;
+                }
+            }
+            ServiceHost::DumpFlightRecorder();
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(service.lock);
+            if (service.supervisor)
+            {
+                logging::logger()->info("{} worker({}) ...", SIGHUP == signal_number ? "reloading" : "stopping", strsignal(signal_number));
+
+                if (SIGHUP == signal_number)
+                {
+                    service.supervisor->Reload();
+                }
+                else
+                {
+                    service.supervisor->Stop();
+                }
+                continue;
+            }
+
+            if (service.aggregator)
+            {
+                if (SIGHUP != signal_number)
+                {
+                    logging::logger()->info("stopping log aggregator({}) ...", strsignal(signal_number));
+                    service.aggregator->Stop();
+                }
+                continue;
+            }
+        }
+
+        if (SIGHUP == signal_number)
+        {
+            logging::logger()->info("reloading service({}) ...", strsignal(signal_number));
+
+            std::lock_guard<std::mutex> guard(service.lock);
+            service.reloading = true;
+        }
+        else
+        {
+            /*
+            * Perform tasks necessary to stop the service here
+            */
+            logging::logger()->info("stopping service({}) ...", strsignal(signal_number));
+
+            std::lock_guard<std::mutex> guard(service.lock);
+            service.stopping = true;
+        }
+        service.wakeup.notify_all();
+    }
+}
+
+// run the modules in a worker process and restart it once crashed, see ServiceSupervisor
+static int RunServiceSupervisor(const sigset_t& signals)
+{
+    std::string name = ServiceHost::GetLogName(service.exec, service.params);
+    name = name.substr(0, name.find_last_of('.'));
+
+    ServiceSupervisor supervisor(service.path, service.exec, name, service.params);
+    {
+        std::lock_guard<std::mutex> guard(service.lock);
+        service.supervisor = &supervisor;
+    }
+
+    std::thread(ServiceSignalRoutine, signals).detach();
+
+    NotifyServiceState("READY=1\nMAINPID=" + std::to_string(getpid()));
+
+    int code = 0;
+    if (!supervisor.Run())
+    {
+        NotifyServiceState("STATUS=crash loop, " + std::to_string(supervisor.Crashes()) + " crashes");
+        code = -1;
+    }
+    else
+    {
+        NotifyServiceState("STOPPING=1");
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(service.lock);
+        service.supervisor = nullptr;
+    }
+    return code;
+}
+
+// drain the log rings of the other loaders, see ServiceLogAggregator
+static void RunLogAggregator(const sigset_t& signals)
+{
+    ServiceLogAggregator aggregator(service.path, service.params);
+    {
+        std::lock_guard<std::mutex> guard(service.lock);
+        service.aggregator = &aggregator;
+    }
+
+    std::thread(ServiceSignalRoutine, signals).detach();
+
+    NotifyServiceState("READY=1\nMAINPID=" + std::to_string(getpid()));
+
+    aggregator.Run();
+
+    NotifyServiceState("STOPPING=1");
+
+    {
+        std::lock_guard<std::mutex> guard(service.lock);
+        service.aggregator = nullptr;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ServiceHost::ParseCommand(argc, argv, 1, service.path, service.exec, service.params);
+
+    std::string decode = ServiceHost::GetParameter(service.params, "log.decode", "");
+    if (!decode.empty())
+    {
+        return ServiceHost::DecodeLog(decode);
+    }
+
+    // block the stop signals before any thread is started, they are taken by the signal thread only
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    int code = 0;
+    do
+    {
+        if (!ServiceHost::InitializeLog(service.path, service.exec, service.params))
+        {
+            fprintf(stderr, "log path(logs/) does not exist\n");
+            code = -1;
+            break;
+        }
+
+        logging::logger()->info("**************** parameters ******************");
+        ServiceParameters::iterator found = service.params.begin();
+        while (found != service.params.end())
+        {
+            logging::logger()->info("{}={}", found->first.c_str(), found->second.c_str());
+            ++found;
+        }
+        logging::logger()->info("***********************************************");
+
+        if ("on" == ServiceHost::GetParameter(service.params, "service.supervise", "off") && ServiceHost::GetParameter(service.params, "service.worker", "").empty())
+        {
+            code = RunServiceSupervisor(signals);
+            logging::logger()->info("service stopped");
+            break;
+        }
+
+        if ("on" == ServiceHost::GetParameter(service.params, "log.aggregator", "off"))
+        {
+            RunLogAggregator(signals);
+            logging::logger()->info("service stopped");
+            break;
+        }
+
+        ServiceModules modules;
+        if (!ServiceHost::CreateModules(service.path, service.params, modules))
+        {
+            code = -1;
+            break;
+        }
+
+        std::thread(ServiceSignalRoutine, signals).detach();
+
+        logging::logger()->info("starting service ...");
+
+        for (std::unique_ptr<ServiceModule>& module : modules)
+        {
+            if (!module->Load())
+            {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(service.lock);
+                ++service.running;
+            }
+
+            if (!module->Start(service.path, [](ServiceModule* quit) {
+                quit->Logger()->info("service module({}) quit", quit->Name().c_str());
+                {
+                    std::lock_guard<std::mutex> guard(service.lock);
+                    --service.running;
+                }
+                service.wakeup.notify_all();
+            }))
+            {
+                std::lock_guard<std::mutex> guard(service.lock);
+                --service.running;
+            }
+        }
+
+        ServiceWatchdog watchdog(service.params);
+        watchdog.Start(modules, [](ServiceModule* module, bool healthy) {
+            NotifyServiceState(healthy ? "STATUS=" : "STATUS=service module(" + module->Name() + ") is unhealthy");
+        });
+
+        {
+            std::unique_lock<std::mutex> guard(service.lock);
+            logging::logger()->info("{} of {} service modules started", service.running, modules.size());
+
+            NotifyServiceState("READY=1\nMAINPID=" + std::to_string(getpid()));
+
+            while (true)
+            {
+                // Wait until a stop signal comes or all the modules quit, reload on SIGHUP meanwhile
+                service.wakeup.wait(guard, []() { return service.stopping || service.reloading || service.running <= 0; });
+                if (service.stopping || service.running <= 0)
+                {
+                    break;
+                }
+
+                service.reloading = false;
+
+                guard.unlock();
+
+                NotifyServiceState("RELOADING=1");
+                ServiceHost::ReloadModules(modules);
+                NotifyServiceState("READY=1");
+
+                guard.lock();
+            }
+        }
+
+        NotifyServiceState("STOPPING=1");
+
+        watchdog.Stop();
+
+        for (std::unique_ptr<ServiceModule>& module : modules)
+        {
+            module->Stop();
+        }
+
+        for (std::unique_ptr<ServiceModule>& module : modules)
+        {
+            module->Join();
+            module->Unload();
+        }
+
+        logging::logger()->info("service stopped");
+    } while (false);
+
+    logging::deinitialize();
+
+    return code;
+}
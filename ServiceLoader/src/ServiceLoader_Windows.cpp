@@ -3,14 +3,18 @@
 
 #include "spdlog/logging.h"
 
+#include "ServiceHost.h"
+#include "ServiceSupervisor.h"
+#include "ServiceWatchdog.h"
+#include "ServiceLogAggregator.h"
+
 #include <algorithm>
+#include <atomic>
 
 #include <unordered_map>
 
 IMPLEMENT_SPDLOG(logging);
 
-typedef std::unordered_map<std::string, std::string> ServiceParameters;
-
 static struct  
 {
     std::string        path;
@@ -20,6 +24,16 @@ static struct
     SERVICE_STATUS        status = { 0 };
     SERVICE_STATUS_HANDLE handle = NULL;
     HANDLE                event = INVALID_HANDLE_VALUE;
+    HANDLE                reload = NULL;
+
+    // set in worker mode, the supervisor asks for the flight recorder by it
+    HANDLE                flight = NULL;
+
+    // set by --service.supervise=on, the modules run in its worker then
+    std::unique_ptr<ServiceSupervisor> supervisor;
+
+    // set by --log.aggregator=on, no module is run then
+    std::unique_ptr<ServiceLogAggregator> aggregator;
 } service;
 
 #define SERVICE_NAME  ("WindowsServiceLoader")  
@@ -75,219 +89,210 @@ VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
         // This will signal the worker thread to start shutting down
         SetEvent(service.event);
 
+        if (service.supervisor)
+        {
+            service.supervisor->Stop();
+        }
+
+        if (service.aggregator)
+        {
+            service.aggregator->Stop();
+        }
+
         break;
 
-    default:
+    case Service_Control_Reload:
+
+        if (service.status.dwCurrentState != SERVICE_RUNNING)
+            break;
+
+        logging::logger()->info("reloading service ...");
+
+        // This will signal the worker thread to reload the replaced modules
+        SetEvent(service.reload);
+
+        if (service.supervisor)
+        {
+            service.supervisor->Reload();
+        }
+
         break;
-    }
-}
 
-typedef int(__cdecl *IsServiceRunning)();
-typedef int(__cdecl *Service_Create)(std::shared_ptr<spdlog::logger>&, const std::string&, const std::string&);
-typedef void(__cdecl *Service_Run)(IsServiceRunning);
-typedef void(__cdecl *Service_Destroy)();
+    case Service_Control_Flight:
 
-int __cdecl IsServiceRunning_Impl()
-{
-    return WaitForSingleObject(service.event, 0) != WAIT_OBJECT_0 ? 1 : 0;
+        if (service.status.dwCurrentState != SERVICE_RUNNING)
+            break;
+
+        if (service.supervisor)
+        {
+            service.supervisor->DumpFlightRecorder();
+        }
+        else
+        {
+            ServiceHost::DumpFlightRecorder();
+        }
+
+        break;
+
+    default:
+        break;
+    }
 }
 
 DWORD WINAPI ServiceWorkerThread(LPVOID)
 {
+    DWORD code = ERROR_SUCCESS;
+    ServiceModules modules;
+
     do
     {
-        ServiceParameters::iterator found = service.params.find("service.lib");
-        if (found == service.params.end())
+        if (!ServiceHost::CreateModules(service.path, service.params, modules))
         {
-            logging::logger()->error("module parameter(--service.lib) is not provided");
+            code = ERROR_SERVICE_SPECIFIC_ERROR;
             break;
         }
 
-        std::string service_lib = service.path + found->second;
-        if (_access(service_lib.c_str(), 00) != 0)
+        // set once a module quits, the loader stops when all of them have quit
+        HANDLE exited = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (NULL == exited)
         {
-            logging::logger()->error("service({}) does not exist", found->second.c_str());
+            logging::logger()->error("create module event failed: {}", GetLastErrorString().c_str());
+            code = ERROR_SERVICE_SPECIFIC_ERROR;
             break;
         }
 
-        std::string service_config;
-        found = service.params.find("service.config");
-        if (found != service.params.end())
+        std::atomic<int> running(0);
+        for (std::unique_ptr<ServiceModule>& module : modules)
         {
-            service_config = service.path + found->second;
-        }
+            if (!module->Load())
+            {
+                continue;
+            }
 
-        if (!service_config.empty() && _access(service_config.c_str(), 00) != 0)
-        {
-            logging::logger()->error("service configuration({}) does not exist", found->second.c_str());
-            break;
+            ++running;
+            if (!module->Start(service.path, [&running, exited](ServiceModule* quit) {
+                quit->Logger()->info("service module({}) quit", quit->Name().c_str());
+                --running;
+                SetEvent(exited);
+            }))
+            {
+                --running;
+            }
         }
+        logging::logger()->info("{} of {} service modules started", running.load(), modules.size());
 
-        HMODULE module = LoadLibrary(service_lib.c_str());
-        if (NULL == module)
-        {
-            logging::logger()->error("load service({}) failed: {}", service_lib.c_str(), GetLastErrorString().c_str());
-            break;
-        }
+        ServiceWatchdog watchdog(service.params);
+        watchdog.Start(modules, nullptr);
 
-        do
+        HANDLE handles[4] = { service.event, exited, service.reload, service.flight };
+        while (running > 0)
         {
-            Service_Create Create = (Service_Create)GetProcAddress(module, "Service_Create");
-            Service_Run Run = (Service_Run)GetProcAddress(module, "Service_Run");
-            Service_Destroy Destroy = (Service_Destroy)GetProcAddress(module, "Service_Destroy");
-
-            if (!Create || !Run || !Destroy)
+            DWORD signaled = WaitForMultipleObjects(service.flight ? 4 : 3, handles, FALSE, INFINITE);
+            if (WAIT_OBJECT_0 == signaled)
             {
-                logging::logger()->error("service({}) interface is not compelete", service_lib.c_str());
                 break;
             }
 
-            if (Create(logging::logger(), service.path, service_config) != 0)
+            if (WAIT_OBJECT_0 + 2 == signaled)
             {
-                logging::logger()->info("stopping service ...");
-                break;
+                ServiceHost::ReloadModules(modules);
+            }
+
+            if (WAIT_OBJECT_0 + 3 == signaled)
+            {
+                ServiceHost::DumpFlightRecorder();
             }
+        }
 
-            /*
-            * Perform main service function here
-            */
-            Run(IsServiceRunning_Impl);
+        watchdog.Stop();
 
-            Destroy();
-        } while (false);
+        for (std::unique_ptr<ServiceModule>& module : modules)
+        {
+            module->Stop();
+        }
 
-        FreeLibrary(module);
+        for (std::unique_ptr<ServiceModule>& module : modules)
+        {
+            module->Join();
+            module->Unload();
+        }
+
+        CloseHandle(exited);
     } while (false);
 
+    return code;
+}
+
+DWORD WINAPI ServiceSupervisorThread(LPVOID)
+{
+    return service.supervisor->Run() ? ERROR_SUCCESS : ERROR_SERVICE_SPECIFIC_ERROR;
+}
+
+DWORD WINAPI ServiceAggregatorThread(LPVOID)
+{
+    service.aggregator->Run();
     return ERROR_SUCCESS;
 }
 
-VOID WINAPI ServiceMain (DWORD argc, LPTSTR *argv)
+static void LogServiceParameters()
 {
-    do
+    logging::logger()->info("**************** parameters ******************");
+    ServiceParameters::iterator found = service.params.begin();
+    while (found != service.params.end())
     {
-        spdlog::level::level_enum log_level = spdlog::level::info;
-        static std::unordered_map<std::string, int> log_level_name_to_enum = {
-            { "trace", spdlog::level::trace },
-            { "debug", spdlog::level::debug },
-            { "info", spdlog::level::info },
-            { "warn", spdlog::level::warn },
-            { "error", spdlog::level::err },
-            { "fatal", spdlog::level::critical },
-            { "off", spdlog::level::off }
-        };
-        ServiceParameters::iterator found = service.params.find("log.level");
-        if (found != service.params.end())
-        {
-            std::unordered_map<std::string, int>::iterator lfound = log_level_name_to_enum.find(found->second);
-            if (lfound != log_level_name_to_enum.end())
-            {
-                log_level = (spdlog::level::level_enum)lfound->second;
-            }
-        }
+        logging::logger()->info("{}={}", found->first.c_str(), found->second.c_str());
+        ++found;
+    }
+    logging::logger()->info("***********************************************");
+}
 
-        if (log_level != spdlog::level::off)
-        {
-            std::string log_path = service.path + "logs\\";
-            if (_access(log_path.c_str(), 00) != 0 && _mkdir(log_path.c_str()) != 0)
-            {
-                logging::logger()->error("log path(logs\\) does not exist");
-                break;
-            }
+// --service.worker=<stop event>,<reload event>,<flight event>, run as the worker of a supervisor which owns the events
+static int RunServiceWorker(const std::string& worker)
+{
+    unsigned long long stop_event = 0, reload_event = 0, flight_event = 0;
+    if (sscanf(worker.c_str(), "%llu,%llu,%llu", &stop_event, &reload_event, &flight_event) != 3)
+    {
+        return -1;
+    }
+    service.event = (HANDLE)(uintptr_t)stop_event;
+    service.reload = (HANDLE)(uintptr_t)reload_event;
+    service.flight = (HANDLE)(uintptr_t)flight_event;
 
-            std::string log_name = argv[0];
-            std::string::size_type pos = log_name.find_last_of('/');
-            if (std::string::npos == pos)
-            {
-                pos = log_name.find_last_of('\\');
-            }
-            if (std::string::npos != pos)
-            {
-                log_name = log_name.substr(pos + 1);
-            }
+    if (!ServiceHost::InitializeLog(service.path, service.exec, service.params))
+    {
+        return -1;
+    }
+    LogServiceParameters();
 
-            found = service.params.find("log.name");
-            if (found != service.params.end())
-            {
-                log_name = found->second;
-            }
-            // replace invalid char
-            std::for_each(log_name.begin(), log_name.end(), [](char& ch) {
-                if (!std::isdigit(ch) && !std::isalpha(ch) && '-' != ch && '_' != ch && '.' != ch)
-                {
-                    ch = '-';
-                }
-            });
-
-            // process log suffix
-            pos = log_name.find_last_of('.');
-            if (std::string::npos != pos)
-            {
-                std::string ext = log_name.substr(pos);
-                std::for_each(ext.begin(), ext.end(), [](char& ch) {
-                    if (ch >= 'A' && ch <= 'Z')
-                    {
-                        ch = ch + ('a' - 'A');
-                    }
-                });
-
-                if (".txt" != ext && ".log" != ext)
-                {
-                    log_name = log_name.substr(0, pos) + ".log";
-                }
-            }
-            else
-            {
-                log_name = log_name + ".log";
-            }
+    logging::logger()->info("starting worker ...");
 
-            std::string log_type = "daily";
-            found = service.params.find("log.type");
-            if (found != service.params.end())
-            {
-                log_type = found->second;
-            }
+    int code = (int)ServiceWorkerThread(NULL);
 
-            int log_size = 80;
-            found = service.params.find("log.size");
-            if (found != service.params.end() && !found->second.empty())
-            {
-                log_size = atoi(found->second.c_str());
-                if (log_size <= 0)
-                {
-                    log_size = 80;
-                }
-            }
+    logging::logger()->info("worker stopped");
+    logging::deinitialize();
 
-            int log_keep = 7;
-            found = service.params.find("log.keep");
-            if (found != service.params.end() && !found->second.empty())
-            {
-                log_keep = atoi(found->second.c_str());
-                if (log_keep <= 0)
-                {
-                    log_keep = 7;
-                }
-            }
+    return code;
+}
 
-            if ("daily" == log_type)
-            {
-                logging::initialize_daily(log_path + log_name, 0, 0, log_keep, log_level);
-            } 
-            else
-            {
-                logging::initialize_rotate(log_path + log_name, (size_t)log_size, log_keep, log_level);
-            }
+VOID WINAPI ServiceMain (DWORD argc, LPTSTR *argv)
+{
+    do
+    {
+        if (!ServiceHost::InitializeLog(service.path, argv[0], service.params))
+        {
+            logging::logger()->error("log path(logs\\) does not exist");
+            break;
         }
+        LogServiceParameters();
 
-        logging::logger()->info("**************** parameters ******************");
-        found = service.params.begin();
-        while (found != service.params.end())
+        if ("on" == ServiceHost::GetParameter(service.params, "service.supervise", "off"))
         {
-            logging::logger()->info("{}={}", found->first.c_str(), found->second.c_str());
-            ++found;
+            service.supervisor.reset(new ServiceSupervisor(service.path, service.exec, argv[0], service.params));
+        }
+        else if ("on" == ServiceHost::GetParameter(service.params, "log.aggregator", "off"))
+        {
+            service.aggregator.reset(new ServiceLogAggregator(service.path, service.params));
         }
-        logging::logger()->info("***********************************************");
 
         // Register our service control handler with the SCM
         service.handle = RegisterServiceCtrlHandler(argv[0], ServiceCtrlHandler);
@@ -317,9 +322,10 @@ VOID WINAPI ServiceMain (DWORD argc, LPTSTR *argv)
         * Perform tasks necessary to start the service here
         */
 
-        // Create a service stop event to wait on later
+        // Create a service stop event and a reload event to wait on later
         service.event = CreateEvent(NULL, TRUE, FALSE, NULL);
-        if (service.event == NULL)
+        service.reload = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (service.event == NULL || service.reload == NULL)
         {
             // Error creating event
             // Tell service controller we are stopped and exit
@@ -351,21 +357,41 @@ VOID WINAPI ServiceMain (DWORD argc, LPTSTR *argv)
         logging::logger()->info("starting service ...");
 
         // Start a thread that will perform the main task of the service
-        HANDLE hThread = CreateThread(NULL, 0, ServiceWorkerThread, NULL, 0, NULL);
+        LPTHREAD_START_ROUTINE routine = ServiceWorkerThread;
+        if (service.supervisor)
+        {
+            routine = ServiceSupervisorThread;
+        }
+        else if (service.aggregator)
+        {
+            routine = ServiceAggregatorThread;
+        }
+        HANDLE hThread = CreateThread(NULL, 0, routine, NULL, 0, NULL);
 
         // Wait until our worker thread exits signaling that the service needs to stop
         WaitForSingleObject(hThread, INFINITE);
 
+        DWORD exit_code = ERROR_SUCCESS;
+        GetExitCodeThread(hThread, &exit_code);
+
         /*
         * Perform any cleanup tasks
         */
         CloseHandle(service.event);
+        CloseHandle(service.reload);
 
-        // Tell the service controller we are stopped
+        // Tell the service controller we are stopped, with the crashes in the window when the supervisor gives up
         service.status.dwControlsAccepted = 0;
         service.status.dwCurrentState = SERVICE_STOPPED;
         service.status.dwWin32ExitCode = 0;
         service.status.dwCheckPoint = 3;
+        if (service.supervisor && ERROR_SUCCESS != exit_code)
+        {
+            service.status.dwWin32ExitCode = ERROR_SERVICE_SPECIFIC_ERROR;
+            service.status.dwServiceSpecificExitCode = (DWORD)service.supervisor->Crashes();
+        }
+        service.supervisor.reset();
+        service.aggregator.reset();
 
         if (SetServiceStatus(service.handle, &service.status) == FALSE)
         {
@@ -379,45 +405,18 @@ VOID WINAPI ServiceMain (DWORD argc, LPTSTR *argv)
 
 int main(int argc, TCHAR *argv[])
 {
-    // parse the command
+    ServiceHost::ParseCommand(argc, argv, 1, service.path, service.exec, service.params);
+
+    std::string decode = ServiceHost::GetParameter(service.params, "log.decode", "");
+    if (!decode.empty())
     {
-        char* command = argv[0];
-        int pos = (int)strlen(command) - 1;
-        while (pos >= 0)
-        {
-            if (command[pos] == '\\' || command[pos] == '/')
-            {
-                break;
-            }
-            --pos;
-        }
-        service.path = std::string(command, command + pos + 1);
-        service.exec = std::string(command + pos + 1);
+        return ServiceHost::DecodeLog(decode);
     }
 
-    // parse the parameter
-    for (int i = 1; i < argc; ++i)
+    std::string worker = ServiceHost::GetParameter(service.params, "service.worker", "");
+    if (!worker.empty())
     {
-        char* dict = argv[i];
-        int spos = 0;
-        int epos = (int)strlen(dict);
-        while (epos >= spos)
-        {
-            if (dict[epos] == '=')
-            {
-                break;
-            }
-            --epos;
-        }
-        while (spos <= epos && dict[spos] == '-')
-        {
-            ++spos;
-        }
-
-        if (spos < epos)
-        {
-            service.params[std::string(dict + spos, dict + epos)] = std::string(dict + epos + 1);
-        }
+        return RunServiceWorker(worker);
     }
 
     SERVICE_TABLE_ENTRY ServiceTable[] =
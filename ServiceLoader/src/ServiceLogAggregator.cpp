@@ -0,0 +1,263 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "ServiceLogAggregator.h"
+
+#include "spdlog/sinks/rotating_file_sink.h"
+#include "spdlog/sinks/daily_file_sink.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <vector>
+#include <chrono>
+
+// the messages in the rings are formatted by their loaders already
+class RawFormatter : public spdlog::formatter
+{
+public:
+    void format(const spdlog::details::log_msg& msg, spdlog::memory_buf_t& dest) override
+    {
+        dest.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+    }
+
+    std::unique_ptr<spdlog::formatter> clone() const override
+    {
+        return spdlog::details::make_unique<RawFormatter>();
+    }
+};
+
+static int GetIntParameter(const ServiceParameters& params, const std::string& key, int default_value, int min_value)
+{
+    int value = atoi(ServiceHost::GetParameter(params, key, std::to_string(default_value)).c_str());
+    return value < min_value ? default_value : value;
+}
+
+static std::vector<std::string> ListRings(const std::string& ring_path)
+{
+    std::vector<std::string> names;
+
+#ifdef _WIN32
+    WIN32_FIND_DATA ffd;
+
+    std::string pattern_all = ring_path + "*.*";
+    HANDLE hFind = FindFirstFile(pattern_all.c_str(), &ffd);
+    if (INVALID_HANDLE_VALUE == hFind)
+    {
+        return names;
+    }
+
+    do
+    {
+        if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            names.push_back(ffd.cFileName);
+        }
+    } while (FindNextFile(hFind, &ffd) != 0);
+
+    FindClose(hFind);
+#else
+    DIR* dir = opendir(ring_path.c_str());
+    if (NULL == dir)
+    {
+        return names;
+    }
+
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if ('.' != entry->d_name[0])
+        {
+            names.push_back(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+#endif
+
+    return names;
+}
+
+ServiceLogAggregator::ServiceLogAggregator(const std::string& path, const ServiceParameters& params)
+    : _path(path)
+    , _status_file(path + "logs" SERVICE_PATH_SEPARATOR "aggregator.json")
+    , _interval_ms(GetIntParameter(params, "aggregator.interval", 10, 1))
+    , _batch(GetIntParameter(params, "aggregator.batch", 1024, 1))
+    , _rings()
+    , _lock(), _wakeup(), _stopping(false)
+{
+}
+
+ServiceLogAggregator::~ServiceLogAggregator()
+{
+}
+
+void ServiceLogAggregator::Run()
+{
+    logging::logger()->info("log aggregator started, rings under {}", ServiceLogRing::GetRingPath(_path).c_str());
+
+    std::chrono::steady_clock::time_point scanned;
+    while (true)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (_rings.empty() || now - scanned >= std::chrono::seconds(1))
+        {
+            scan_rings();
+            write_status();
+            scanned = now;
+        }
+
+        int drained = 0;
+        for (std::map<std::string, Ring_t>::value_type& ring : _rings)
+        {
+            drained += drain_ring(ring.second);
+        }
+
+        std::unique_lock<std::mutex> guard(_lock);
+        if (_stopping)
+        {
+            break;
+        }
+
+        if (0 == drained)
+        {
+            _wakeup.wait_for(guard, std::chrono::milliseconds(_interval_ms), [this]() { return _stopping; });
+        }
+    }
+
+    // what the loaders put before the stop
+    for (std::map<std::string, Ring_t>::value_type& ring : _rings)
+    {
+        while (drain_ring(ring.second) > 0)
+        {
+        }
+    }
+    write_status();
+
+    logging::logger()->info("log aggregator stopped");
+}
+
+void ServiceLogAggregator::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+}
+
+void ServiceLogAggregator::scan_rings()
+{
+    std::string log_path = _path + "logs" SERVICE_PATH_SEPARATOR;
+
+    std::vector<std::string> names = ListRings(ServiceLogRing::GetRingPath(_path));
+    for (const std::string& name : names)
+    {
+        if (_rings.find(name) != _rings.end())
+        {
+            continue;
+        }
+
+        // not created yet or gone with a reboot, found again at the next scan
+        std::unique_ptr<ServiceLogRing> ring(new ServiceLogRing(_path, name));
+        if (!ring->Open())
+        {
+            continue;
+        }
+
+        Ring_t& opened = _rings[name];
+        try
+        {
+            if ("daily" == ring->Type())
+            {
+                opened.sink = std::make_shared<spdlog::sinks::daily_file_sink_st>(log_path + name, 0, 0, false, (uint16_t)(ring->Keep() > 0 ? ring->Keep() : 7));
+            }
+            else
+            {
+                opened.sink = std::make_shared<spdlog::sinks::rotating_file_sink_st>(log_path + name, (size_t)(ring->Size() > 0 ? ring->Size() : 80) << 20, (size_t)(ring->Keep() > 0 ? ring->Keep() : 7));
+            }
+        }
+        catch (const spdlog::spdlog_ex& ex)
+        {
+            logging::logger()->error("open log file({}) of ring failed: {}", name.c_str(), ex.what());
+            _rings.erase(name);
+            continue;
+        }
+        opened.sink->set_formatter(spdlog::details::make_unique<RawFormatter>());
+        opened.ring = std::move(ring);
+
+        logging::logger()->info("log ring({}) found, {} messages written, {} dropped", name.c_str(), opened.ring->Written(), opened.ring->Dropped());
+    }
+}
+
+int ServiceLogAggregator::drain_ring(Ring_t& ring)
+{
+    std::string data;
+    long long time = 0;
+
+    int drained = 0;
+    while (drained < _batch && ring.ring->Read(data, time))
+    {
+        spdlog::details::log_msg msg(spdlog::string_view_t(ring.ring->File()), spdlog::level::info, spdlog::string_view_t(data));
+        msg.time = spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(time)));
+
+        ring.sink->log(msg);
+        ++drained;
+    }
+
+    // once for the batch rather than per message
+    if (drained > 0)
+    {
+        ring.sink->flush();
+    }
+    return drained;
+}
+
+void ServiceLogAggregator::write_status()
+{
+    rapidjson::Document doc(rapidjson::kObjectType);
+    rapidjson::Value str_json(rapidjson::kStringType);
+    rapidjson::Value num_json(rapidjson::kNumberType);
+    rapidjson::Value rings_json(rapidjson::kArrayType);
+
+    for (const std::map<std::string, Ring_t>::value_type& ring : _rings)
+    {
+        rapidjson::Value ring_json(rapidjson::kObjectType);
+
+        str_json.SetString(ring.first.c_str(), doc.GetAllocator());
+        ring_json.AddMember("file", str_json, doc.GetAllocator());
+
+        num_json.SetUint64(ring.second.ring->Written());
+        ring_json.AddMember("written", num_json, doc.GetAllocator());
+
+        num_json.SetUint64(ring.second.ring->Dropped());
+        ring_json.AddMember("dropped", num_json, doc.GetAllocator());
+
+        num_json.SetUint64(ring.second.ring->Pending());
+        ring_json.AddMember("pending_bytes", num_json, doc.GetAllocator());
+
+        rings_json.PushBack(ring_json, doc.GetAllocator());
+    }
+    doc.AddMember("rings", rings_json, doc.GetAllocator());
+
+    num_json.SetInt64((long long)time(NULL));
+    doc.AddMember("updated", num_json, doc.GetAllocator());
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    if (!ServiceHost::WriteStatusFile(_status_file, buffer.GetString()))
+    {
+        logging::logger()->warn("write aggregator status({}) failed", _status_file.c_str());
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef _SERVICE_LOG_AGGREGATOR_HEADER_H_
+#define _SERVICE_LOG_AGGREGATOR_HEADER_H_
+
+#include "ServiceHost.h"
+#include "ServiceLogRing.h"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+/*
+* --log.aggregator=on, the loader hosts no module but drains the rings of the loaders run with --log.aggregate=on
+* one after another to their log files, which are rotated and kept as the loaders are configured:
+*   --aggregator.interval=10    sleep(ms) once all the rings are empty
+*   --aggregator.batch=1024     messages drained from a ring before the next one
+* the rings are found under logs/rings/ once a second, their messages and drops are written to logs/aggregator.json
+*/
+class ServiceLogAggregator
+{
+public:
+    ServiceLogAggregator(const std::string& path, const ServiceParameters& params);
+    ~ServiceLogAggregator();
+
+    // drain the rings until Stop
+    void Run();
+
+    void Stop();
+
+private:
+    struct Ring_t
+    {
+        std::unique_ptr<ServiceLogRing> ring;
+        spdlog::sink_ptr sink;
+    };
+
+    void scan_rings();
+
+    // messages drained
+    int drain_ring(Ring_t& ring);
+
+    void write_status();
+
+private:
+    std::string _path;
+    std::string _status_file;
+
+    int _interval_ms;
+    int _batch;
+
+    std::map<std::string, Ring_t> _rings;
+
+private:
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+    bool _stopping;
+
+private:
+    ServiceLogAggregator();
+    ServiceLogAggregator(const ServiceLogAggregator&);
+    ServiceLogAggregator& operator=(const ServiceLogAggregator&);
+};
+
+#endif
@@ -0,0 +1,411 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ServiceLogRing.h"
+#include "ServiceHost.h"
+
+#include <functional>
+#include <chrono>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring is shared by processes, its atomics must be lock free");
+
+static const uint32_t Ring_Magic = 0x524C4653; // SFLR
+static const uint32_t Ring_Version = 1;
+
+// a record which does not fit the end of the ring skips it with a padding
+static const uint32_t Padding_Size = 0xFFFFFFFF;
+
+struct ServiceLogRing::Header_t
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t capacity;
+
+    // the log file under logs/ and its rotation
+    char file[256];
+    char type[16];
+    int32_t size;
+    int32_t keep;
+
+    // byte offsets which only grow, the head is moved by the loader and the tail by the aggregator
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> dropped;
+};
+
+struct Record_t
+{
+    uint32_t size;
+    uint32_t reserved;
+    int64_t time;
+};
+
+static uint64_t GetRecordSize(uint64_t size)
+{
+    return (sizeof(Record_t) + size + 15) & ~(uint64_t)15;
+}
+
+static bool MakeRingDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    return _access(path.c_str(), 00) == 0 || _mkdir(path.c_str()) == 0;
+#else
+    return access(path.c_str(), F_OK) == 0 || mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+ServiceLogRing::ServiceLogRing(const std::string& root, const std::string& file)
+    : _root(root), _file(file), _name()
+    , _header(nullptr), _data(nullptr), _mapped_size(0)
+#ifdef _WIN32
+    , _mapping(NULL)
+#endif
+{
+    // loaders of different roots do not share their rings
+    char root_hash[32] = { 0 };
+    snprintf(root_hash, sizeof(root_hash), "%llx", (unsigned long long)std::hash<std::string>()(root));
+
+#ifdef _WIN32
+    _name = std::string("Local\\ServiceFramework.") + root_hash + "." + file;
+#else
+    _name = std::string("/ServiceFramework.") + root_hash + "." + file;
+#endif
+}
+
+ServiceLogRing::~ServiceLogRing()
+{
+    unmap_ring();
+}
+
+std::string ServiceLogRing::GetRingPath(const std::string& root)
+{
+    return root + "logs" SERVICE_PATH_SEPARATOR "rings" SERVICE_PATH_SEPARATOR;
+}
+
+bool ServiceLogRing::Create(const std::string& type, int size, int keep, size_t ring_size)
+{
+    uint64_t capacity = (uint64_t)ring_size & ~(uint64_t)15;
+    if (capacity < 4096 || _file.size() >= sizeof(_header->file) || type.size() >= sizeof(_header->type))
+    {
+        return false;
+    }
+
+    bool created = false;
+    if (!map_ring(sizeof(Header_t) + (size_t)capacity, created))
+    {
+        return false;
+    }
+
+    // an existing ring keeps its size
+    if (capacity + sizeof(Header_t) > _mapped_size)
+    {
+        capacity = (uint64_t)(_mapped_size - sizeof(Header_t)) & ~(uint64_t)15;
+    }
+
+    // a ring left by a crashed loader is taken over as it is, a broken one is set up again
+    if (created || Ring_Magic != _header->magic.load(std::memory_order_acquire) || Ring_Version != _header->version || _header->capacity + sizeof(Header_t) > _mapped_size)
+    {
+        _header->magic.store(0, std::memory_order_relaxed);
+        _header->version = Ring_Version;
+        _header->capacity = capacity;
+        _header->head.store(0, std::memory_order_relaxed);
+        _header->tail.store(0, std::memory_order_relaxed);
+        _header->written.store(0, std::memory_order_relaxed);
+        _header->dropped.store(0, std::memory_order_relaxed);
+    }
+
+    memset(_header->file, 0, sizeof(_header->file));
+    memcpy(_header->file, _file.c_str(), _file.size());
+    memset(_header->type, 0, sizeof(_header->type));
+    memcpy(_header->type, type.c_str(), type.size());
+    _header->size = size;
+    _header->keep = keep;
+
+    _header->magic.store(Ring_Magic, std::memory_order_release);
+
+    // listed for the aggregator
+    std::string ring_path = GetRingPath(_root);
+    if (!MakeRingDirectory(ring_path))
+    {
+        unmap_ring();
+        return false;
+    }
+
+    FILE* marker = fopen((ring_path + _file).c_str(), "a");
+    if (NULL == marker)
+    {
+        unmap_ring();
+        return false;
+    }
+    fclose(marker);
+
+    return true;
+}
+
+bool ServiceLogRing::Open()
+{
+    bool created = false;
+    if (!map_ring(0, created))
+    {
+        return false;
+    }
+
+    if (Ring_Magic != _header->magic.load(std::memory_order_acquire) || Ring_Version != _header->version || _header->capacity + sizeof(Header_t) > _mapped_size)
+    {
+        unmap_ring();
+        return false;
+    }
+    return true;
+}
+
+bool ServiceLogRing::Write(const char* data, size_t size, long long time)
+{
+    uint64_t capacity = _header->capacity;
+    uint64_t need = GetRecordSize(size);
+
+    uint64_t head = _header->head.load(std::memory_order_relaxed);
+    uint64_t tail = _header->tail.load(std::memory_order_acquire);
+
+    uint64_t pos = head % capacity;
+    uint64_t skip = (capacity - pos < need) ? capacity - pos : 0;
+
+    if (need > capacity / 2 || capacity - (head - tail) < skip + need)
+    {
+        _header->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (skip > 0)
+    {
+        ((Record_t*)(_data + pos))->size = Padding_Size;
+        head += skip;
+        pos = 0;
+    }
+
+    Record_t* record = (Record_t*)(_data + pos);
+    record->size = (uint32_t)size;
+    record->reserved = 0;
+    record->time = (int64_t)time;
+    memcpy(record + 1, data, size);
+
+    _header->head.store(head + need, std::memory_order_release);
+    _header->written.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ServiceLogRing::Read(std::string& data, long long& time)
+{
+    uint64_t capacity = _header->capacity;
+
+    uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+    uint64_t head = _header->head.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        uint64_t pos = tail % capacity;
+        const Record_t* record = (const Record_t*)(_data + pos);
+        if (Padding_Size == record->size)
+        {
+            tail += capacity - pos;
+            continue;
+        }
+
+        // the messages of a ring broken by its writer are given up
+        if (record->size > capacity - pos - sizeof(Record_t))
+        {
+            tail = head;
+            break;
+        }
+
+        data.assign((const char*)(record + 1), record->size);
+        time = (long long)record->time;
+
+        _header->tail.store(tail + GetRecordSize(record->size), std::memory_order_release);
+        return true;
+    }
+
+    _header->tail.store(tail, std::memory_order_release);
+    return false;
+}
+
+std::string ServiceLogRing::Type() const
+{
+    return std::string(_header->type, strnlen(_header->type, sizeof(_header->type)));
+}
+
+int ServiceLogRing::Size() const
+{
+    return (int)_header->size;
+}
+
+int ServiceLogRing::Keep() const
+{
+    return (int)_header->keep;
+}
+
+unsigned long long ServiceLogRing::Written() const
+{
+    return (unsigned long long)_header->written.load(std::memory_order_relaxed);
+}
+
+unsigned long long ServiceLogRing::Dropped() const
+{
+    return (unsigned long long)_header->dropped.load(std::memory_order_relaxed);
+}
+
+unsigned long long ServiceLogRing::Pending() const
+{
+    return (unsigned long long)(_header->head.load(std::memory_order_acquire) - _header->tail.load(std::memory_order_acquire));
+}
+
+bool ServiceLogRing::map_ring(size_t size, bool& created)
+{
+    void* mapped = nullptr;
+    size_t mapped_size = 0;
+
+#ifdef _WIN32
+    if (size > 0)
+    {
+        _mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)size, _name.c_str());
+        created = (NULL != _mapping && GetLastError() != ERROR_ALREADY_EXISTS);
+    }
+    else
+    {
+        _mapping = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, _name.c_str());
+    }
+
+    if (NULL == _mapping)
+    {
+        return false;
+    }
+
+    mapped = MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (NULL == mapped)
+    {
+        CloseHandle(_mapping);
+        _mapping = NULL;
+        return false;
+    }
+
+    // an existing mapping keeps the size it was created with
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(mapped, &info, sizeof(info)) == 0)
+    {
+        UnmapViewOfFile(mapped);
+        CloseHandle(_mapping);
+        _mapping = NULL;
+        return false;
+    }
+    mapped_size = (size_t)info.RegionSize;
+#else
+    int fd = -1;
+    if (size > 0)
+    {
+        fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        created = (fd >= 0);
+        if (fd < 0 && EEXIST == errno)
+        {
+            fd = shm_open(_name.c_str(), O_RDWR, 0600);
+        }
+    }
+    else
+    {
+        fd = shm_open(_name.c_str(), O_RDWR, 0600);
+    }
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    mapped_size = (size_t)st.st_size;
+
+    // one left half created by a crashed loader is sized again
+    if (size > 0 && mapped_size < sizeof(Header_t))
+    {
+        if (ftruncate(fd, (off_t)size) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        created = true;
+        mapped_size = size;
+    }
+
+    if (mapped_size < sizeof(Header_t))
+    {
+        close(fd);
+        return false;
+    }
+
+    mapped = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == mapped)
+    {
+        return false;
+    }
+#endif
+
+    _header = (Header_t*)mapped;
+    _data = (char*)mapped + sizeof(Header_t);
+    _mapped_size = mapped_size;
+    return true;
+}
+
+void ServiceLogRing::unmap_ring()
+{
+    if (nullptr == _header)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(_header);
+    CloseHandle(_mapping);
+    _mapping = NULL;
+#else
+    munmap(_header, _mapped_size);
+#endif
+
+    _header = nullptr;
+    _data = nullptr;
+    _mapped_size = 0;
+}
+
+ServiceLogRingSink::ServiceLogRingSink(const std::shared_ptr<ServiceLogRing>& ring)
+    : _ring(ring)
+{
+}
+
+void ServiceLogRingSink::sink_it_(const spdlog::details::log_msg& msg)
+{
+    spdlog::memory_buf_t formatted;
+    formatter_->format(msg, formatted);
+
+    _ring->Write(formatted.data(), formatted.size(), (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count());
+}
+
+void ServiceLogRingSink::flush_()
+{
+    // the aggregator flushes the files
+}
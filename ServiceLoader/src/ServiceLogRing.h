@@ -0,0 +1,96 @@
+#ifndef _SERVICE_LOG_RING_HEADER_H_
+#define _SERVICE_LOG_RING_HEADER_H_
+
+#include "spdlog/sinks/base_sink.h"
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <memory>
+
+#include <stdint.h>
+
+/*
+* --log.aggregate=on, the loggers put their formatted messages to a shared memory ring of the log file instead of
+* writing the file, a loader run with --log.aggregator=on drains the rings of all the loaders to the files, see ServiceLogAggregator:
+*   --log.ring_size=1024    size of a ring(KB)
+* a ring is named after the log file and listed as logs/rings/<log file name>, the rotation of the file is kept in
+* the ring for the aggregator, the loader is the only writer of a ring and the aggregator the only reader,
+* a full ring drops the message rather than block the service, the drops are counted in the ring
+*/
+class ServiceLogRing
+{
+public:
+    // the ring of logs/<file>, named after the root the loader runs in as well
+    ServiceLogRing(const std::string& root, const std::string& file);
+    ~ServiceLogRing();
+
+    // by the loader, the ring left by the loader run before is taken over with the messages in it
+    bool Create(const std::string& type, int size, int keep, size_t ring_size);
+
+    // by the aggregator
+    bool Open();
+
+    // false when the message is dropped
+    bool Write(const char* data, size_t size, long long time);
+
+    // false when the ring is empty
+    bool Read(std::string& data, long long& time);
+
+    inline const std::string& File() const
+    {
+        return _file;
+    }
+
+    std::string Type() const;
+    int Size() const;
+    int Keep() const;
+
+    unsigned long long Written() const;
+    unsigned long long Dropped() const;
+    unsigned long long Pending() const;
+
+    // marker files of the rings under logs/rings/
+    static std::string GetRingPath(const std::string& root);
+
+private:
+    struct Header_t;
+
+    // creates the ring of so many bytes unless it exists, opens the existing one only when size is 0
+    bool map_ring(size_t size, bool& created);
+    void unmap_ring();
+
+private:
+    std::string _root;
+    std::string _file;
+    std::string _name;
+
+    Header_t* _header;
+    char* _data;
+    size_t _mapped_size;
+
+#ifdef _WIN32
+    void* _mapping;
+#endif
+
+private:
+    ServiceLogRing();
+    ServiceLogRing(const ServiceLogRing&);
+    ServiceLogRing& operator=(const ServiceLogRing&);
+};
+
+// the sink of the loggers of --log.aggregate=on, formats as the file sinks do and writes to the ring
+class ServiceLogRingSink : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+    explicit ServiceLogRingSink(const std::shared_ptr<ServiceLogRing>& ring);
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override;
+    void flush_() override;
+
+private:
+    std::shared_ptr<ServiceLogRing> _ring;
+};
+
+#endif
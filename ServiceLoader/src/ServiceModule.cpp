@@ -0,0 +1,796 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <dlfcn.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ServiceModule.h"
+
+#include <atomic>
+#include <fstream>
+
+#ifdef _WIN32
+static std::string GetLastErrorString()
+{
+    std::string err_str;
+    DWORD code = GetLastError();
+    LPVOID lpMsgBuf = NULL;
+    DWORD bufLen = FormatMessage(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER |
+        FORMAT_MESSAGE_FROM_SYSTEM |
+        FORMAT_MESSAGE_IGNORE_INSERTS,
+        NULL,
+        code,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+        (LPTSTR)&lpMsgBuf,
+        0, NULL);
+
+    if (lpMsgBuf)
+    {
+        err_str = (LPCSTR)lpMsgBuf;
+        LocalFree(lpMsgBuf);
+    }
+    return err_str;
+}
+
+static bool FileExists(const std::string& path)
+{
+    return _access(path.c_str(), 00) == 0;
+}
+
+static std::string GetFileStamp(const std::string& path)
+{
+    struct _stat64 st;
+    if (path.empty() || _stat64(path.c_str(), &st) != 0)
+    {
+        return "";
+    }
+    return std::to_string((long long)st.st_size) + ":" + std::to_string((long long)st.st_mtime);
+}
+
+static bool CopyLibrary(const std::string& from, const std::string& to, std::string& err)
+{
+    if (!CopyFile(from.c_str(), to.c_str(), FALSE))
+    {
+        err = GetLastErrorString();
+        return false;
+    }
+    return true;
+}
+
+static unsigned long GetProcessNumber()
+{
+    return (unsigned long)GetCurrentProcessId();
+}
+
+// a process which can not be opened for a reason but its absence is taken as alive
+static bool IsProcessAlive(unsigned long pid)
+{
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+    if (NULL == process)
+    {
+        return GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+
+    DWORD code = 0;
+    bool alive = !GetExitCodeProcess(process, &code) || STILL_ACTIVE == code;
+    CloseHandle(process);
+    return alive;
+}
+
+// the names in dir of <stem>.*<ext>
+static std::vector<std::string> ListLibraryFiles(const std::string& dir, const std::string& stem, const std::string& ext)
+{
+    std::vector<std::string> names;
+
+    WIN32_FIND_DATA data;
+    HANDLE find = FindFirstFile((dir + stem + ".*" + ext).c_str(), &data);
+    if (INVALID_HANDLE_VALUE == find)
+    {
+        return names;
+    }
+
+    do
+    {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            names.push_back(data.cFileName);
+        }
+    } while (FindNextFile(find, &data));
+
+    FindClose(find);
+    return names;
+}
+
+static void* OpenLibrary(const std::string& path, std::string& err)
+{
+    HMODULE module = LoadLibrary(path.c_str());
+    if (NULL == module)
+    {
+        err = GetLastErrorString();
+    }
+    return module;
+}
+
+static void* GetLibrarySymbol(void* library, const char* name)
+{
+    return (void*)GetProcAddress((HMODULE)library, name);
+}
+
+static void CloseLibrary(void* library)
+{
+    FreeLibrary((HMODULE)library);
+}
+
+static const ServiceStopHandle Invalid_Stop_Handle = NULL;
+
+static ServiceStopHandle CreateStopHandle()
+{
+    return CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+static void SignalStopHandle(ServiceStopHandle handle)
+{
+    SetEvent((HANDLE)handle);
+}
+
+static void ResetStopHandle(ServiceStopHandle handle)
+{
+    ResetEvent((HANDLE)handle);
+}
+
+static bool IsStopHandleSignaled(ServiceStopHandle handle)
+{
+    return WaitForSingleObject((HANDLE)handle, 0) == WAIT_OBJECT_0;
+}
+
+static void CloseStopHandle(ServiceStopHandle handle)
+{
+    CloseHandle((HANDLE)handle);
+}
+#else
+static bool FileExists(const std::string& path)
+{
+    return access(path.c_str(), F_OK) == 0;
+}
+
+static std::string GetFileStamp(const std::string& path)
+{
+    struct stat st;
+    if (path.empty() || stat(path.c_str(), &st) != 0)
+    {
+        return "";
+    }
+    return std::to_string((long long)st.st_size) + ":" + std::to_string((long long)st.st_mtim.tv_sec) + "." + std::to_string((long long)st.st_mtim.tv_nsec);
+}
+
+static bool CopyLibrary(const std::string& from, const std::string& to, std::string& err)
+{
+    std::ifstream ifs(from, std::ios::binary);
+    std::ofstream ofs(to, std::ios::binary | std::ios::trunc);
+    if (!ifs.is_open() || !ofs.is_open())
+    {
+        err = strerror(errno);
+        return false;
+    }
+
+    ofs << ifs.rdbuf();
+    ofs.close();
+    if (ofs.fail())
+    {
+        err = "write failed";
+        return false;
+    }
+    return true;
+}
+
+static unsigned long GetProcessNumber()
+{
+    return (unsigned long)getpid();
+}
+
+static bool IsProcessAlive(unsigned long pid)
+{
+    return kill((pid_t)pid, 0) == 0 || EPERM == errno;
+}
+
+// the names in dir of <stem>.*<ext>
+static std::vector<std::string> ListLibraryFiles(const std::string& dir, const std::string& stem, const std::string& ext)
+{
+    std::vector<std::string> names;
+
+    DIR* entries = opendir(dir.empty() ? "." : dir.c_str());
+    if (!entries)
+    {
+        return names;
+    }
+
+    std::string prefix = stem + ".";
+    while (struct dirent* entry = readdir(entries))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > prefix.size() + ext.size()
+            && 0 == name.compare(0, prefix.size(), prefix)
+            && 0 == name.compare(name.size() - ext.size(), ext.size(), ext))
+        {
+            names.push_back(name);
+        }
+    }
+
+    closedir(entries);
+    return names;
+}
+
+static void* OpenLibrary(const std::string& path, std::string& err)
+{
+    void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library)
+    {
+        err = dlerror();
+    }
+    return library;
+}
+
+static void* GetLibrarySymbol(void* library, const char* name)
+{
+    return dlsym(library, name);
+}
+
+static void CloseLibrary(void* library)
+{
+    dlclose(library);
+}
+
+static const ServiceStopHandle Invalid_Stop_Handle = -1;
+
+// the counter is never read, so the descriptor stays readable once signaled
+static ServiceStopHandle CreateStopHandle()
+{
+    return eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+static void SignalStopHandle(ServiceStopHandle handle)
+{
+    eventfd_write(handle, 1);
+}
+
+static void ResetStopHandle(ServiceStopHandle handle)
+{
+    eventfd_t value;
+    eventfd_read(handle, &value);
+}
+
+static bool IsStopHandleSignaled(ServiceStopHandle handle)
+{
+    struct pollfd pfd;
+    pfd.fd = handle;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+static void CloseStopHandle(ServiceStopHandle handle)
+{
+    close(handle);
+}
+#endif
+
+/*
+* IsServiceRunning and register_callback carry no context, every module gets a pair of its own
+*/
+static std::atomic<ServiceModule*> Module_Slots[ServiceModule::Max_Modules];
+static std::mutex Module_Slots_Lock;
+
+template <int Slot>
+static int SERVICE_CALL IsModuleRunning()
+{
+    ServiceModule* module = Module_Slots[Slot].load(std::memory_order_acquire);
+    if (!module)
+    {
+        return 0;
+    }
+
+    module->Heartbeat();
+    return module->Running() ? 1 : 0;
+}
+
+template <int Slot>
+static int SERVICE_CALL RegisterModuleStopCallback(ServiceStopCallback callback, void* context)
+{
+    ServiceModule* module = Module_Slots[Slot].load(std::memory_order_acquire);
+    return module ? module->RegisterStopCallback(callback, context) : -1;
+}
+
+template <int Slot>
+static void SERVICE_CALL ModuleHeartbeat()
+{
+    ServiceModule* module = Module_Slots[Slot].load(std::memory_order_acquire);
+    if (module)
+    {
+        module->Heartbeat();
+    }
+}
+
+struct ModuleSlot_t
+{
+    IsServiceRunning is_running;
+    int(SERVICE_CALL *register_callback)(ServiceStopCallback, void*);
+    ServiceHeartbeat heartbeat;
+};
+
+template <int N>
+struct ModuleSlots
+{
+    static void Fill(ModuleSlot_t* slots)
+    {
+        ModuleSlots<N - 1>::Fill(slots);
+        slots[N - 1].is_running = &IsModuleRunning<N - 1>;
+        slots[N - 1].register_callback = &RegisterModuleStopCallback<N - 1>;
+        slots[N - 1].heartbeat = &ModuleHeartbeat<N - 1>;
+    }
+};
+
+template <>
+struct ModuleSlots<0>
+{
+    static void Fill(ModuleSlot_t*)
+    {
+    }
+};
+
+static const ModuleSlot_t* GetModuleSlots()
+{
+    static ModuleSlot_t slots[ServiceModule::Max_Modules];
+    static bool filled = (ModuleSlots<ServiceModule::Max_Modules>::Fill(slots), true);
+    (void)filled;
+    return slots;
+}
+
+/*
+* <library dir>/<library name>.<pid>-<generation><library ext>, the generation is counted by the process
+* so that the modules hosting one library do not share the copy
+*/
+static std::atomic<unsigned int> Shadow_Generation(0);
+
+// <dir><stem><ext>, dir keeps its separator
+static void SplitLibraryPath(const std::string& library, std::string& dir, std::string& stem, std::string& ext)
+{
+    std::string::size_type sep = library.find_last_of("\\/");
+    std::string::size_type begin = std::string::npos == sep ? 0 : sep + 1;
+    std::string::size_type dot = library.find_last_of('.');
+    if (std::string::npos == dot || dot < begin)
+    {
+        dot = library.size();
+    }
+
+    dir = library.substr(0, begin);
+    stem = library.substr(begin, dot - begin);
+    ext = library.substr(dot);
+}
+
+static std::string GetShadowPath(const std::string& library)
+{
+    std::string dir, stem, ext;
+    SplitLibraryPath(library, dir, stem, ext);
+    return dir + stem + "." + std::to_string(GetProcessNumber()) + "-" + std::to_string(++Shadow_Generation) + ext;
+}
+
+// the process of <pid>-<generation>, 0 if it is not of a shadow copy
+static unsigned long GetShadowProcess(const std::string& mark)
+{
+    std::string::size_type dash = mark.find('-');
+    if (std::string::npos == dash || 0 == dash || mark.size() == dash + 1
+        || mark.find_first_not_of("0123456789") != dash || mark.find_first_not_of("0123456789", dash + 1) != std::string::npos)
+    {
+        return 0;
+    }
+    return strtoul(mark.substr(0, dash).c_str(), nullptr, 10);
+}
+
+const int ServiceModule::Max_Modules;
+
+ServiceModule::ServiceModule(const std::string& name, const std::string& library, const std::string& config, const std::shared_ptr<spdlog::logger>& log)
+    : _name(name), _library_path(library), _config_path(config)
+    , _logger(log)
+    , _library()
+    , _root(), _exited()
+    , _slot(-1)
+    , _worker()
+    , _heartbeats(0)
+    , _event(CreateStopHandle())
+    , _stop_lock(), _stop_callbacks(), _stop_requested(false), _stop_time()
+    , _started(false), _reloading(false), _reloaded(false), _reload_time()
+{
+}
+
+ServiceModule::~ServiceModule()
+{
+    Stop();
+    Join();
+    Unload();
+
+    if (Invalid_Stop_Handle != _event)
+    {
+        CloseStopHandle(_event);
+    }
+}
+
+bool ServiceModule::Load()
+{
+    if (_library.handle)
+    {
+        return true;
+    }
+
+    sweep_shadows();
+    return open_library(_library);
+}
+
+void ServiceModule::Unload()
+{
+    close_library(_library);
+}
+
+bool ServiceModule::Start(const std::string& root, const Exited& exited)
+{
+    if (!_library.handle || Invalid_Stop_Handle == _event)
+    {
+        return false;
+    }
+
+    _root = root;
+    _exited = exited;
+
+    {
+        std::lock_guard<std::mutex> guard(Module_Slots_Lock);
+        for (int i = 0; i < Max_Modules; ++i)
+        {
+            if (!Module_Slots[i])
+            {
+                _slot = i;
+                Module_Slots[i] = this;
+                break;
+            }
+        }
+    }
+    if (_slot < 0)
+    {
+        _logger->error("service({}) is not started: more than {} modules are hosted", _name.c_str(), Max_Modules);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        _stop_requested = false;
+        _started = true;
+        ResetStopHandle(_event);
+    }
+
+    _worker = std::thread(&ServiceModule::run_routine, this, root, exited);
+    return true;
+}
+
+bool ServiceModule::Changed() const
+{
+    return _library.handle && get_stamp() != _library.stamp;
+}
+
+bool ServiceModule::Reload()
+{
+    ServiceLibrary_t library;
+    if (!open_library(library))
+    {
+        _logger->error("service({}) is not reloaded, the running one is kept", _name.c_str());
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point reload_time = std::chrono::steady_clock::now();
+
+    bool running = false;
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        running = _started && !_stop_requested;
+        _reloading = running;
+    }
+    if (!running)
+    {
+        _logger->warn("service({}) is not reloaded: it is not running", _name.c_str());
+
+        close_library(library);
+        return false;
+    }
+
+    _logger->info("reloading service({}) from {} ...", _name.c_str(), library.path.c_str());
+
+    Stop();
+    Join();
+
+    _logger->info("service({}) drained in {}ms", _name.c_str(), (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - reload_time).count());
+
+    close_library(_library);
+    _library = library;
+
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        _reloading = false;
+        _reloaded = true;
+        _reload_time = reload_time;
+    }
+
+    if (!Start(_root, _exited))
+    {
+        _logger->error("service({}) is not started after reloaded", _name.c_str());
+        if (_exited)
+        {
+            _exited(this);
+        }
+        return false;
+    }
+    return true;
+}
+
+void ServiceModule::Stop()
+{
+    std::vector<std::pair<ServiceStopCallback, void*>> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        if (_stop_requested)
+        {
+            return;
+        }
+        _stop_requested = true;
+        _stop_time = std::chrono::steady_clock::now();
+
+        callbacks.swap(_stop_callbacks);
+    }
+
+    // This will signal the module to start shutting down
+    SignalStopHandle(_event);
+
+    for (auto& callback : callbacks)
+    {
+        callback.first(callback.second);
+    }
+}
+
+void ServiceModule::Join()
+{
+    if (_worker.joinable())
+    {
+        _worker.join();
+    }
+
+    if (_slot >= 0)
+    {
+        std::lock_guard<std::mutex> guard(Module_Slots_Lock);
+        Module_Slots[_slot] = nullptr;
+        _slot = -1;
+    }
+}
+
+bool ServiceModule::Running() const
+{
+    return !IsStopHandleSignaled(_event);
+}
+
+bool ServiceModule::Active() const
+{
+    std::lock_guard<std::mutex> guard(_stop_lock);
+    return _started && !_stop_requested;
+}
+
+int ServiceModule::RegisterStopCallback(ServiceStopCallback callback, void* context)
+{
+    if (!callback)
+    {
+        return -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        if (!_stop_requested)
+        {
+            _stop_callbacks.emplace_back(callback, context);
+            return 0;
+        }
+    }
+
+    callback(context);
+    return 0;
+}
+
+bool ServiceModule::open_library(ServiceLibrary_t& library)
+{
+    if (!FileExists(_library_path))
+    {
+        _logger->error("service({}) does not exist", _library_path.c_str());
+        return false;
+    }
+
+    if (!_config_path.empty() && !FileExists(_config_path))
+    {
+        _logger->error("service configuration({}) does not exist", _config_path.c_str());
+        return false;
+    }
+
+    // stamped before copied, a library replaced while being copied is taken as changed
+    library.stamp = get_stamp();
+
+    std::string err;
+    library.path = GetShadowPath(_library_path);
+    if (!CopyLibrary(_library_path, library.path, err))
+    {
+        _logger->warn("copy service({}) to {} failed: {}, load it in place", _library_path.c_str(), library.path.c_str(), err.c_str());
+
+        remove(library.path.c_str());
+        library.path = _library_path;
+    }
+
+    void* module = OpenLibrary(library.path, err);
+    if (!module)
+    {
+        _logger->error("load service({}) failed: {}", library.path.c_str(), err.c_str());
+
+        close_library(library);
+        return false;
+    }
+
+    library.create = (Service_Create_t)GetLibrarySymbol(module, "Service_Create");
+    library.run = (Service_Run_t)GetLibrarySymbol(module, "Service_Run");
+    library.run_ex = (Service_RunEx_t)GetLibrarySymbol(module, "Service_RunEx");
+    library.destroy = (Service_Destroy_t)GetLibrarySymbol(module, "Service_Destroy");
+
+    if (!library.create || (!library.run && !library.run_ex) || !library.destroy)
+    {
+        _logger->error("service({}) interface is not compelete", _library_path.c_str());
+
+        CloseLibrary(module);
+        close_library(library);
+        return false;
+    }
+
+    library.handle = module;
+    return true;
+}
+
+void ServiceModule::close_library(ServiceLibrary_t& library)
+{
+    if (library.handle)
+    {
+        CloseLibrary(library.handle);
+    }
+
+    if (!library.path.empty() && library.path != _library_path && remove(library.path.c_str()) != 0)
+    {
+        _logger->warn("remove service copy({}) failed", library.path.c_str());
+    }
+
+    library = ServiceLibrary_t();
+}
+
+void ServiceModule::sweep_shadows()
+{
+    std::string dir, stem, ext;
+    SplitLibraryPath(_library_path, dir, stem, ext);
+
+    // the copies of a living process, this one included, may be loaded, a crashed one unloaded none of its own
+    unsigned long self = GetProcessNumber();
+    for (const std::string& name : ListLibraryFiles(dir, stem, ext))
+    {
+        unsigned long pid = GetShadowProcess(name.substr(stem.size() + 1, name.size() - stem.size() - 1 - ext.size()));
+        if (0 == pid || self == pid || IsProcessAlive(pid))
+        {
+            continue;
+        }
+
+        std::string path = dir + name;
+        if (remove(path.c_str()) == 0)
+        {
+            _logger->info("removed service copy({}) left by process {}", path.c_str(), pid);
+        }
+        else
+        {
+            _logger->warn("remove service copy({}) left by process {} failed", path.c_str(), pid);
+        }
+    }
+}
+
+std::string ServiceModule::get_stamp() const
+{
+    return GetFileStamp(_library_path) + "|" + GetFileStamp(_config_path);
+}
+
+void ServiceModule::run_routine(std::string root, Exited exited)
+{
+    const ModuleSlot_t& slot = GetModuleSlots()[_slot];
+
+    do
+    {
+        if (_library.create(_logger, root, _config_path) != 0)
+        {
+            _logger->info("stopping service ...");
+            break;
+        }
+
+        long long reload_gap = elapsed_since_reloaded();
+        if (reload_gap >= 0)
+        {
+            _logger->info("service({}) reloaded, out of service for {}ms", _name.c_str(), reload_gap);
+        }
+
+        /*
+        * Perform main service function here
+        */
+        if (_library.run_ex)
+        {
+            ServiceStopToken token;
+            token.size = sizeof(token);
+            token.handle = _event;
+            token.is_running = slot.is_running;
+            token.register_callback = slot.register_callback;
+            token.heartbeat = slot.heartbeat;
+
+            _library.run_ex(&token);
+        }
+        else
+        {
+            _library.run(slot.is_running);
+        }
+        long long run_latency = elapsed_since_stop_requested();
+
+        _library.destroy();
+
+        if (run_latency >= 0)
+        {
+            _logger->info("service({}) returned {}ms and destroyed {}ms after stop requested", _library.run_ex ? "Service_RunEx" : "Service_Run", run_latency, elapsed_since_stop_requested());
+        }
+    } while (false);
+
+    bool reloading = false;
+    {
+        std::lock_guard<std::mutex> guard(_stop_lock);
+        reloading = _reloading;
+        _started = reloading;
+        _reloaded = false;
+    }
+
+    if (exited && !reloading)
+    {
+        exited(this);
+    }
+}
+
+long long ServiceModule::elapsed_since_stop_requested()
+{
+    std::lock_guard<std::mutex> guard(_stop_lock);
+    if (!_stop_requested)
+    {
+        return -1;
+    }
+    return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _stop_time).count();
+}
+
+long long ServiceModule::elapsed_since_reloaded()
+{
+    std::lock_guard<std::mutex> guard(_stop_lock);
+    if (!_reloaded)
+    {
+        return -1;
+    }
+    _reloaded = false;
+    return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _reload_time).count();
+}
@@ -0,0 +1,153 @@
+#ifndef _SERVICE_MODULE_HEADER_H_
+#define _SERVICE_MODULE_HEADER_H_
+
+#include "ServiceInterface.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+
+// the entries of a service library, as ServiceInterface.h declares them
+typedef decltype(&::Service_Create) Service_Create_t;
+typedef decltype(&::Service_Run) Service_Run_t;
+typedef decltype(&::Service_RunEx) Service_RunEx_t;
+typedef decltype(&::Service_Destroy) Service_Destroy_t;
+
+// a loaded copy of the service library
+struct ServiceLibrary_t
+{
+    // the shadow copy, the library itself is never loaded so that it can be replaced while running
+    std::string path;
+
+    // size and write time of the library and the configuration when copied
+    std::string stamp;
+
+    void* handle = nullptr;
+
+    Service_Create_t create = nullptr;
+    Service_Run_t run = nullptr;
+    Service_RunEx_t run_ex = nullptr;
+    Service_Destroy_t destroy = nullptr;
+};
+
+/*
+* one hosted service library, Create/Run/Destroy run on a thread of its own and the stop token belongs to the module,
+* so that modules of a host process are stopped one by one
+*/
+class ServiceModule
+{
+public:
+    typedef std::function<void(ServiceModule*)> Exited;
+
+    // at most so many modules are hosted by one process
+    static const int Max_Modules = 32;
+
+public:
+    ServiceModule(const std::string& name, const std::string& library, const std::string& config, const std::shared_ptr<spdlog::logger>& log);
+    ~ServiceModule();
+
+    // load a shadow copy of the library and resolve the interface
+    bool Load();
+    void Unload();
+
+    // exited is called on the module thread after Service_Destroy, but not when the module is reloaded
+    bool Start(const std::string& root, const Exited& exited);
+
+    // whether the library or the configuration is replaced since loaded
+    bool Changed() const;
+
+    // the replaced library is loaded before the running one is stopped, destroyed and unloaded,
+    // so the running one is kept when the new one fails to load
+    bool Reload();
+
+    void Stop();
+    void Join();
+
+    bool Running() const;
+    int RegisterStopCallback(ServiceStopCallback callback, void* context);
+
+    // started and not asked to stop
+    bool Active() const;
+
+    // bumped by is_running and the heartbeat of the stop token, which the service calls from its hot loops
+    inline void Heartbeat()
+    {
+        _heartbeats.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline unsigned long long Heartbeats() const
+    {
+        return _heartbeats.load(std::memory_order_relaxed);
+    }
+
+    inline const std::string& Name() const
+    {
+        return _name;
+    }
+
+    inline std::shared_ptr<spdlog::logger>& Logger()
+    {
+        return _logger;
+    }
+
+private:
+    bool open_library(ServiceLibrary_t& library);
+    void close_library(ServiceLibrary_t& library);
+
+    // removes the shadow copies of the library left by the processes which are gone
+    void sweep_shadows();
+
+    std::string get_stamp() const;
+
+    void run_routine(std::string root, Exited exited);
+
+    long long elapsed_since_stop_requested();
+    long long elapsed_since_reloaded();
+
+private:
+    std::string _name;
+    std::string _library_path;
+    std::string _config_path;
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+private:
+    ServiceLibrary_t _library;
+
+    // kept by Start for Reload
+    std::string _root;
+    Exited _exited;
+
+    // index of the is_running/register_callback trampolines handed to the module
+    int _slot;
+
+    std::thread _worker;
+
+    std::atomic<unsigned long long> _heartbeats;
+
+private:
+    // manual-reset event or eventfd, signaled once on stop
+    ServiceStopHandle _event;
+
+    mutable std::mutex _stop_lock;
+    std::vector<std::pair<ServiceStopCallback, void*>> _stop_callbacks;
+    bool _stop_requested;
+    std::chrono::steady_clock::time_point _stop_time;
+
+    // from Start until the module quits by itself or is stopped, a reload keeps it
+    bool _started;
+    bool _reloading;
+    bool _reloaded;
+    std::chrono::steady_clock::time_point _reload_time;
+
+private:
+    ServiceModule();
+    ServiceModule(const ServiceModule&);
+    ServiceModule& operator=(const ServiceModule&);
+};
+
+#endif
@@ -0,0 +1,632 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ServiceSupervisor.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include <vector>
+
+static int GetIntParameter(const ServiceParameters& params, const std::string& key, int default_value, int min_value)
+{
+    int value = atoi(ServiceHost::GetParameter(params, key, std::to_string(default_value)).c_str());
+    return value < min_value ? default_value : value;
+}
+
+// the worker logs to <log name>-worker.log next to the supervisor
+static std::string GetWorkerLogName(const std::string& name, const ServiceParameters& params)
+{
+    std::string log_name = ServiceHost::GetLogName(name, params);
+    std::string::size_type pos = log_name.find_last_of('.');
+    if (std::string::npos == pos)
+    {
+        pos = log_name.size();
+    }
+    return log_name.insert(pos, "-worker");
+}
+
+// the parameters of the supervisor but its own, the worker takes the rest as they are
+static std::vector<std::string> GetWorkerArguments(const std::string& name, const ServiceParameters& params)
+{
+    std::vector<std::string> args;
+    for (const ServiceParameters::value_type& param : params)
+    {
+        if ("service.supervise" == param.first || "service.worker" == param.first || "log.name" == param.first)
+        {
+            continue;
+        }
+        args.push_back("--" + param.first + "=" + param.second);
+    }
+    args.push_back("--log.name=" + GetWorkerLogName(name, params));
+    return args;
+}
+
+#ifdef _WIN32
+static std::string GetLastErrorString()
+{
+    std::string err_str;
+    DWORD code = GetLastError();
+    LPVOID lpMsgBuf = NULL;
+    DWORD bufLen = FormatMessage(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER |
+        FORMAT_MESSAGE_FROM_SYSTEM |
+        FORMAT_MESSAGE_IGNORE_INSERTS,
+        NULL,
+        code,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+        (LPTSTR)&lpMsgBuf,
+        0, NULL);
+
+    if (lpMsgBuf)
+    {
+        err_str = (LPCSTR)lpMsgBuf;
+        LocalFree(lpMsgBuf);
+    }
+    return err_str;
+}
+
+// quoted the way CommandLineToArgvW and the c runtime split the command line
+static std::string QuoteArgument(const std::string& arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+    {
+        return arg;
+    }
+
+    std::string quoted("\"");
+    size_t backslashes = 0;
+    for (char ch : arg)
+    {
+        if ('\\' == ch)
+        {
+            ++backslashes;
+            continue;
+        }
+
+        quoted.append('"' == ch ? backslashes * 2 + 1 : backslashes, '\\');
+        quoted.push_back(ch);
+        backslashes = 0;
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted.push_back('"');
+    return quoted;
+}
+#endif
+
+ServiceSupervisor::ServiceSupervisor(const std::string& path, const std::string& exec, const std::string& name, const ServiceParameters& params)
+    : _path(path), _exec(exec), _name(name), _params(params)
+    , _status_file(path + "logs" SERVICE_PATH_SEPARATOR + name + ".supervisor.json")
+    , _backoff_ms(GetIntParameter(params, "supervisor.backoff", 1000, 1))
+    , _backoff_max_ms(GetIntParameter(params, "supervisor.backoff_max", 60000, 1))
+    , _jitter_percent(GetIntParameter(params, "supervisor.jitter", 20, 0))
+    , _crash_limit(GetIntParameter(params, "supervisor.crashes", 5, 1))
+    , _crash_window_s(GetIntParameter(params, "supervisor.window", 300, 1))
+    , _stop_timeout_ms(GetIntParameter(params, "supervisor.stop_timeout", 30000, 1))
+    , _lock(), _wakeup(), _stopping(false)
+    , _pid(0), _exited(true), _exit_code(0), _waiter()
+#ifdef _WIN32
+    , _process(NULL), _worker_stop(NULL), _worker_reload(NULL), _worker_flight(NULL), _job(NULL)
+#endif
+    , _random(std::random_device()())
+    , _crash_times()
+    , _starts(0), _crashes(0), _last_crash_time(0), _last_backoff_ms(0), _last_restart_ms(0), _max_restart_ms(0)
+{
+#ifdef _WIN32
+    // inheritable, the worker gets their values by --service.worker
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = NULL;
+    sa.bInheritHandle = TRUE;
+
+    _worker_stop = CreateEvent(&sa, TRUE, FALSE, NULL);
+    _worker_reload = CreateEvent(&sa, FALSE, FALSE, NULL);
+    _worker_flight = CreateEvent(&sa, FALSE, FALSE, NULL);
+
+    _job = CreateJobObject(NULL, NULL);
+    if (_job)
+    {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
+        ZeroMemory(&limit, sizeof(limit));
+        limit.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        if (!SetInformationJobObject(_job, JobObjectExtendedLimitInformation, &limit, sizeof(limit)))
+        {
+            logging::logger()->warn("limit worker job failed: {}", GetLastErrorString().c_str());
+        }
+    }
+#endif
+}
+
+ServiceSupervisor::~ServiceSupervisor()
+{
+    Stop();
+    stop_worker();
+
+#ifdef _WIN32
+    if (_worker_stop)
+    {
+        CloseHandle(_worker_stop);
+    }
+    if (_worker_reload)
+    {
+        CloseHandle(_worker_reload);
+    }
+    if (_worker_flight)
+    {
+        CloseHandle(_worker_flight);
+    }
+    if (_job)
+    {
+        CloseHandle(_job);
+    }
+#endif
+}
+
+bool ServiceSupervisor::Run()
+{
+    bool restarting = false;
+    std::chrono::steady_clock::time_point crash_time;
+
+    while (true)
+    {
+        bool spawned = spawn_worker();
+        if (spawned)
+        {
+            ++_starts;
+            if (restarting)
+            {
+                _last_restart_ms = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - crash_time).count();
+                if (_last_restart_ms > _max_restart_ms)
+                {
+                    _max_restart_ms = _last_restart_ms;
+                }
+                logging::logger()->info("worker({}) restarted {}ms after crashed", _pid, _last_restart_ms);
+            }
+            else
+            {
+                logging::logger()->info("worker({}) started", _pid);
+            }
+            write_status("running");
+        }
+
+        long long exit_code = -1;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _wakeup.wait(guard, [this]() { return _stopping || _exited; });
+            if (_stopping)
+            {
+                guard.unlock();
+
+                stop_worker();
+                write_status("stopped");
+                return true;
+            }
+
+            if (spawned)
+            {
+                exit_code = _exit_code;
+            }
+        }
+        wait_worker();
+
+        if (0 == exit_code)
+        {
+            logging::logger()->info("worker exited, all the service modules quit");
+            write_status("exited");
+            return true;
+        }
+
+        crash_time = std::chrono::steady_clock::now();
+        ++_crashes;
+        _last_crash_time = (long long)time(NULL);
+
+        int crashes = 0;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _crash_times.push_back(crash_time);
+            while (crash_time - _crash_times.front() > std::chrono::seconds(_crash_window_s))
+            {
+                _crash_times.pop_front();
+            }
+            crashes = (int)_crash_times.size();
+        }
+        logging::logger()->error("worker crashed with exit code {}, {} crashes in {}s", exit_code, crashes, _crash_window_s);
+
+        if (crashes >= _crash_limit)
+        {
+            logging::logger()->critical("worker is not restarted any more: {} crashes in {}s", crashes, _crash_window_s);
+            write_status("crash-loop");
+            return false;
+        }
+
+        std::chrono::milliseconds backoff = next_backoff();
+        _last_backoff_ms = (long long)backoff.count();
+        logging::logger()->info("restarting worker in {}ms ...", _last_backoff_ms);
+        write_status("backoff");
+
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            if (_wakeup.wait_for(guard, backoff, [this]() { return _stopping; }))
+            {
+                guard.unlock();
+
+                write_status("stopped");
+                return true;
+            }
+        }
+        restarting = true;
+    }
+}
+
+void ServiceSupervisor::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+}
+
+void ServiceSupervisor::Reload()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_exited)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    SetEvent(_worker_reload);
+#else
+    kill((pid_t)_pid, SIGHUP);
+#endif
+}
+
+void ServiceSupervisor::DumpFlightRecorder()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_exited)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    SetEvent(_worker_flight);
+#else
+    kill((pid_t)_pid, SIGUSR1);
+#endif
+}
+
+int ServiceSupervisor::Crashes()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return (int)_crash_times.size();
+}
+
+#ifdef _WIN32
+bool ServiceSupervisor::spawn_worker()
+{
+    if (!_worker_stop || !_worker_reload || !_worker_flight)
+    {
+        logging::logger()->error("create worker events failed");
+        return false;
+    }
+    ResetEvent(_worker_stop);
+    ResetEvent(_worker_reload);
+    ResetEvent(_worker_flight);
+
+    std::string command = QuoteArgument(_path + _exec);
+    for (const std::string& arg : GetWorkerArguments(_name, _params))
+    {
+        command += " " + QuoteArgument(arg);
+    }
+    command += " --service.worker=" + std::to_string((unsigned long long)(uintptr_t)_worker_stop) + "," + std::to_string((unsigned long long)(uintptr_t)_worker_reload) + "," + std::to_string((unsigned long long)(uintptr_t)_worker_flight);
+
+    // the worker inherits the events only, not the log files of the supervisor
+    HANDLE inherited[3] = { _worker_stop, _worker_reload, _worker_flight };
+
+    SIZE_T size = 0;
+    InitializeProcThreadAttributeList(NULL, 1, 0, &size);
+    std::vector<char> attributes(size);
+    LPPROC_THREAD_ATTRIBUTE_LIST attribute_list = (LPPROC_THREAD_ATTRIBUTE_LIST)attributes.data();
+    if (!InitializeProcThreadAttributeList(attribute_list, 1, 0, &size))
+    {
+        logging::logger()->error("start worker failed: {}", GetLastErrorString().c_str());
+        return false;
+    }
+
+    STARTUPINFOEX si;
+    ZeroMemory(&si, sizeof(si));
+    si.StartupInfo.cb = sizeof(si);
+    si.lpAttributeList = attribute_list;
+
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&pi, sizeof(pi));
+
+    std::vector<char> command_line(command.begin(), command.end());
+    command_line.push_back(0);
+
+    BOOL created = UpdateProcThreadAttribute(attribute_list, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, sizeof(inherited), NULL, NULL) &&
+        CreateProcess(NULL, command_line.data(), NULL, NULL, TRUE, EXTENDED_STARTUPINFO_PRESENT | CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si.StartupInfo, &pi);
+    DeleteProcThreadAttributeList(attribute_list);
+
+    if (!created)
+    {
+        logging::logger()->error("start worker({}) failed: {}", command.c_str(), GetLastErrorString().c_str());
+        return false;
+    }
+
+    if (_job && !AssignProcessToJobObject(_job, pi.hProcess))
+    {
+        logging::logger()->warn("assign worker({}) to job failed: {}", pi.dwProcessId, GetLastErrorString().c_str());
+    }
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+
+    HANDLE process = pi.hProcess;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _process = process;
+        _pid = (long long)pi.dwProcessId;
+        _exited = false;
+        _exit_code = 0;
+    }
+
+    _waiter = std::thread([this, process]() {
+        WaitForSingleObject(process, INFINITE);
+
+        DWORD code = 0;
+        GetExitCodeProcess(process, &code);
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _exited = true;
+            _exit_code = (long long)code;
+        }
+        _wakeup.notify_all();
+    });
+    return true;
+}
+
+void ServiceSupervisor::wait_worker()
+{
+    if (_waiter.joinable())
+    {
+        _waiter.join();
+    }
+
+    if (_process)
+    {
+        CloseHandle(_process);
+        _process = NULL;
+    }
+}
+
+void ServiceSupervisor::stop_worker()
+{
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        if (!_exited)
+        {
+            // This will signal the worker to start shutting down
+            SetEvent(_worker_stop);
+
+            if (!_wakeup.wait_for(guard, std::chrono::milliseconds(_stop_timeout_ms), [this]() { return _exited; }))
+            {
+                logging::logger()->warn("worker({}) does not exit in {}ms, kill it", _pid, _stop_timeout_ms);
+
+                TerminateProcess(_process, ERROR_PROCESS_ABORTED);
+                _wakeup.wait(guard, [this]() { return _exited; });
+            }
+        }
+    }
+    wait_worker();
+}
+#else
+bool ServiceSupervisor::spawn_worker()
+{
+    // everything the child needs is prepared before fork, it calls async-signal-safe functions only
+    std::vector<std::string> args = GetWorkerArguments(_name, _params);
+    args.insert(args.begin(), _path + _exec);
+    args.push_back("--service.worker=" + std::to_string(getpid()));
+
+    std::vector<char*> argv;
+    for (std::string& arg : args)
+    {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(NULL);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+
+    pid_t parent = getpid();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        logging::logger()->error("start worker failed: {}", strerror(errno));
+        return false;
+    }
+
+    if (0 == pid)
+    {
+#ifdef __linux__
+        // the worker stops with the supervisor
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent)
+        {
+            _exit(127);
+        }
+#endif
+        pthread_sigmask(SIG_SETMASK, &signals, NULL);
+
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _pid = (long long)pid;
+        _exited = false;
+        _exit_code = 0;
+    }
+
+    // WNOWAIT keeps the zombie, so the pid is not reused before wait_worker reaps it
+    _waiter = std::thread([this, pid]() {
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        while (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOWAIT) < 0 && EINTR == errno)
+        {
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _exited = true;
+            _exit_code = (CLD_EXITED == info.si_code) ? (long long)info.si_status : 128 + (long long)info.si_status;
+        }
+        _wakeup.notify_all();
+    });
+    return true;
+}
+
+void ServiceSupervisor::wait_worker()
+{
+    if (_waiter.joinable())
+    {
+        _waiter.join();
+
+        waitpid((pid_t)_pid, NULL, 0);
+    }
+}
+
+void ServiceSupervisor::stop_worker()
+{
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        if (!_exited)
+        {
+            kill((pid_t)_pid, SIGTERM);
+
+            if (!_wakeup.wait_for(guard, std::chrono::milliseconds(_stop_timeout_ms), [this]() { return _exited; }))
+            {
+                logging::logger()->warn("worker({}) does not exit in {}ms, kill it", _pid, _stop_timeout_ms);
+
+                kill((pid_t)_pid, SIGKILL);
+                _wakeup.wait(guard, [this]() { return _exited; });
+            }
+        }
+    }
+    wait_worker();
+}
+#endif
+
+std::chrono::milliseconds ServiceSupervisor::next_backoff()
+{
+    int doublings = 0;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        doublings = (int)_crash_times.size() - 1;
+    }
+
+    long long delay = _backoff_ms;
+    while (doublings-- > 0 && delay < _backoff_max_ms)
+    {
+        delay *= 2;
+    }
+    if (delay > _backoff_max_ms)
+    {
+        delay = _backoff_max_ms;
+    }
+
+    if (_jitter_percent > 0)
+    {
+        long long spread = delay * _jitter_percent / 100;
+        std::uniform_int_distribution<long long> jitter(-spread, spread);
+        delay += jitter(_random);
+    }
+    return std::chrono::milliseconds(delay > 0 ? delay : 0);
+}
+
+/*
+* {"name":"...","state":"running|backoff|exited|stopped|crash-loop","pid":0,"starts":0,"crashes":0,"window_crashes":0,
+*  "last_exit_code":0,"last_crash_time":0,"last_backoff_ms":0,"last_restart_ms":0,"max_restart_ms":0,"updated":0}
+* written aside and renamed, so the manager never reads half of it
+*/
+void ServiceSupervisor::write_status(const char* state)
+{
+    rapidjson::Document doc(rapidjson::kObjectType);
+    rapidjson::Value str_json(rapidjson::kStringType);
+    rapidjson::Value num_json(rapidjson::kNumberType);
+
+    long long pid = 0, exit_code = 0;
+    int window_crashes = 0;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        pid = _exited ? 0 : _pid;
+        exit_code = _exit_code;
+        window_crashes = (int)_crash_times.size();
+    }
+
+    str_json.SetString(_name.c_str(), doc.GetAllocator());
+    doc.AddMember("name", str_json, doc.GetAllocator());
+
+    str_json.SetString(state, doc.GetAllocator());
+    doc.AddMember("state", str_json, doc.GetAllocator());
+
+    num_json.SetInt64(pid);
+    doc.AddMember("pid", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_starts);
+    doc.AddMember("starts", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_crashes);
+    doc.AddMember("crashes", num_json, doc.GetAllocator());
+
+    num_json.SetInt(window_crashes);
+    doc.AddMember("window_crashes", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(exit_code);
+    doc.AddMember("last_exit_code", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_last_crash_time);
+    doc.AddMember("last_crash_time", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_last_backoff_ms);
+    doc.AddMember("last_backoff_ms", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_last_restart_ms);
+    doc.AddMember("last_restart_ms", num_json, doc.GetAllocator());
+
+    num_json.SetInt64(_max_restart_ms);
+    doc.AddMember("max_restart_ms", num_json, doc.GetAllocator());
+
+    num_json.SetInt64((long long)time(NULL));
+    doc.AddMember("updated", num_json, doc.GetAllocator());
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    if (!ServiceHost::WriteStatusFile(_status_file, buffer.GetString()))
+    {
+        logging::logger()->warn("write supervisor status({}) failed", _status_file.c_str());
+    }
+}
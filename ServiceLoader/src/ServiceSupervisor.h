@@ -0,0 +1,110 @@
+#ifndef _SERVICE_SUPERVISOR_HEADER_H_
+#define _SERVICE_SUPERVISOR_HEADER_H_
+
+#include "ServiceHost.h"
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+
+/*
+* --service.supervise=on, the loader hosts no module itself but runs a worker, which is the loader started again
+* with --service.worker, and restarts the worker once it exits abnormally:
+*   --supervisor.backoff=1000       first restart delay(ms), doubled by every crash in the window
+*   --supervisor.backoff_max=60000  limit of the restart delay(ms)
+*   --supervisor.jitter=20          the delay is spread by so many percents
+*   --supervisor.crashes=5          the supervisor gives up once so many crashes happen in the window
+*   --supervisor.window=300         crash window(s)
+*   --supervisor.stop_timeout=30000 the worker is killed if it does not exit in time(ms) after asked to stop
+* the metrics are written to logs/<name>.supervisor.json
+*/
+class ServiceSupervisor
+{
+public:
+    // the worker is path + exec, name is the service name which the status file is named after
+    ServiceSupervisor(const std::string& path, const std::string& exec, const std::string& name, const ServiceParameters& params);
+    ~ServiceSupervisor();
+
+    // run the worker until Stop, false when the crash-loop breaker trips
+    bool Run();
+
+    void Stop();
+
+    // forwarded to the worker
+    void Reload();
+    void DumpFlightRecorder();
+
+    // crashes in the window
+    int Crashes();
+
+private:
+    // the worker exits with 0 once all the modules quit, anything else unexpected is a crash
+    bool spawn_worker();
+    void wait_worker();
+    void stop_worker();
+
+    std::chrono::milliseconds next_backoff();
+
+    void write_status(const char* state);
+
+private:
+    std::string _path;
+    std::string _exec;
+    std::string _name;
+    ServiceParameters _params;
+
+    std::string _status_file;
+
+private:
+    int _backoff_ms;
+    int _backoff_max_ms;
+    int _jitter_percent;
+    int _crash_limit;
+    int _crash_window_s;
+    int _stop_timeout_ms;
+
+private:
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+    bool _stopping;
+
+    long long _pid;
+    bool _exited;
+    long long _exit_code;
+
+    // waits for the worker to exit
+    std::thread _waiter;
+
+#ifdef _WIN32
+    void* _process;
+
+    // inherited by the worker as its stop, reload and flight dump events, a job kills the worker with the supervisor
+    void* _worker_stop;
+    void* _worker_reload;
+    void* _worker_flight;
+    void* _job;
+#endif
+
+private:
+    std::mt19937 _random;
+
+    std::deque<std::chrono::steady_clock::time_point> _crash_times;
+
+    long long _starts;
+    long long _crashes;
+    long long _last_crash_time;
+    long long _last_backoff_ms;
+    long long _last_restart_ms;
+    long long _max_restart_ms;
+
+private:
+    ServiceSupervisor();
+    ServiceSupervisor(const ServiceSupervisor&);
+    ServiceSupervisor& operator=(const ServiceSupervisor&);
+};
+
+#endif
@@ -0,0 +1,151 @@
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+
+#include "ServiceWatchdog.h"
+
+#include <algorithm>
+
+const int ServiceWatchdog::Hung_Exit_Code;
+
+ServiceWatchdog::ServiceWatchdog(const ServiceParameters& params)
+    : _deadline_ms(atoi(ServiceHost::GetParameter(params, "watchdog.deadline", "0").c_str()))
+    , _exit_on_hang("exit" == ServiceHost::GetParameter(params, "watchdog.action", "log"))
+    , _watched(), _changed()
+    , _lock(), _wakeup(), _stopping(false)
+    , _watcher()
+{
+}
+
+ServiceWatchdog::~ServiceWatchdog()
+{
+    Stop();
+}
+
+bool ServiceWatchdog::Start(const ServiceModules& modules, const Changed& changed)
+{
+    if (_deadline_ms <= 0 || _watcher.joinable())
+    {
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (const std::unique_ptr<ServiceModule>& module : modules)
+    {
+        Watched_t watched;
+        watched.module = module.get();
+        watched.heartbeats = module->Heartbeats();
+        watched.last_beat = now;
+        watched.active = false;
+        watched.healthy = true;
+
+        _watched.push_back(watched);
+    }
+    _changed = changed;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = false;
+    }
+    _watcher = std::thread(&ServiceWatchdog::watch_routine, this);
+
+    logging::logger()->info("watchdog started, deadline {}ms, {} on hang", _deadline_ms, _exit_on_hang ? "exit" : "log");
+    return true;
+}
+
+void ServiceWatchdog::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+
+    if (_watcher.joinable())
+    {
+        _watcher.join();
+    }
+}
+
+void ServiceWatchdog::watch_routine()
+{
+    // a stall is caught within a quarter of the deadline
+    std::chrono::milliseconds interval(std::min(std::max(_deadline_ms / 4, 10), 1000));
+
+    std::unique_lock<std::mutex> guard(_lock);
+    while (!_wakeup.wait_for(guard, interval, [this]() { return _stopping; }))
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (Watched_t& watched : _watched)
+        {
+            unsigned long long heartbeats = watched.module->Heartbeats();
+
+            // a module which is stopping, quit or being reloaded is watched again once it runs
+            if (!watched.module->Active())
+            {
+                watched.active = false;
+                continue;
+            }
+
+            if (!watched.active || heartbeats != watched.heartbeats)
+            {
+                if (!watched.healthy)
+                {
+                    watched.module->Logger()->info("service module({}) heartbeats again after {}ms", watched.module->Name().c_str(), (long long)std::chrono::duration_cast<std::chrono::milliseconds>(now - watched.last_beat).count());
+
+                    watched.healthy = true;
+                    if (_changed)
+                    {
+                        _changed(watched.module, true);
+                    }
+                }
+
+                watched.active = true;
+                watched.heartbeats = heartbeats;
+                watched.last_beat = now;
+                continue;
+            }
+
+            long long silence = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(now - watched.last_beat).count();
+            if (!watched.healthy || silence < _deadline_ms)
+            {
+                continue;
+            }
+
+            watched.healthy = false;
+
+            LOGGING_ERROR(logging::logger(), "service module({}) is unhealthy: no heartbeat for {}ms, deadline {}ms, {} heartbeats in total", watched.module->Name().c_str(), silence, _deadline_ms, heartbeats);
+            if (watched.module->Logger() != logging::logger())
+            {
+                watched.module->Logger()->error("service module({}) is unhealthy: no heartbeat for {}ms, deadline {}ms, {} heartbeats in total", watched.module->Name().c_str(), silence, _deadline_ms, heartbeats);
+            }
+
+            if (_changed)
+            {
+                _changed(watched.module, false);
+            }
+
+            if (_exit_on_hang)
+            {
+                logging::logger()->critical("service module({}) hangs, exit({}) to be restarted", watched.module->Name().c_str(), Hung_Exit_Code);
+
+                // the last messages of the hung module, as a crash would leave
+                ServiceHost::DumpFlightRecorder();
+
+                watched.module->Logger()->flush();
+                logging::logger()->flush();
+
+                // an async logger only queues the flush, the queue is written out once the logging is shut down
+                logging::deinitialize();
+
+                // the hung module would block any orderly shutdown
+                _exit(Hung_Exit_Code);
+            }
+        }
+    }
+}
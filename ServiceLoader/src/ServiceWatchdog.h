@@ -0,0 +1,70 @@
+#ifndef _SERVICE_WATCHDOG_HEADER_H_
+#define _SERVICE_WATCHDOG_HEADER_H_
+
+#include "ServiceHost.h"
+
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/*
+* watches the heartbeats of the running modules, the watchdog is off unless --watchdog.deadline is given:
+*   --watchdog.deadline=<ms>    a running module which has not heartbeated for so long is flagged unhealthy
+*   --watchdog.action=log|exit  exit terminates the loader so that the supervisor or the SCM recovery restarts it,
+*                               as a hung module can not be stopped in place
+* the heartbeats are only read here, the modules bump them without any lock
+*/
+class ServiceWatchdog
+{
+public:
+    typedef std::function<void(ServiceModule*, bool)> Changed;
+
+    // exit code of the loader terminated for a hung module
+    static const int Hung_Exit_Code = 3;
+
+public:
+    explicit ServiceWatchdog(const ServiceParameters& params);
+    ~ServiceWatchdog();
+
+    // changed is called on the watchdog thread when a module turns unhealthy or healthy again, false when it is off
+    bool Start(const ServiceModules& modules, const Changed& changed);
+    void Stop();
+
+private:
+    struct Watched_t
+    {
+        ServiceModule* module;
+
+        unsigned long long heartbeats;
+        std::chrono::steady_clock::time_point last_beat;
+
+        bool active;
+        bool healthy;
+    };
+
+    void watch_routine();
+
+private:
+    int _deadline_ms;
+    bool _exit_on_hang;
+
+    std::vector<Watched_t> _watched;
+    Changed _changed;
+
+private:
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+    bool _stopping;
+
+    std::thread _watcher;
+
+private:
+    ServiceWatchdog();
+    ServiceWatchdog(const ServiceWatchdog&);
+    ServiceWatchdog& operator=(const ServiceWatchdog&);
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "Executor/RequestExecutor.h"
+
+static void ev_complete(struct mg_connection *nc, int ev, void *ev_data)
+{
+    // mg_broadcast calls back on every connection, the listening one is always there and unique
+    if (MG_EV_POLL == ev && (nc->flags & MG_F_LISTENING))
+    {
+        RequestExecutor* executor = *(RequestExecutor**)ev_data;
+        executor->Deliver();
+    }
+}
+
+RequestExecutor::RequestExecutor()
+    : _mgr(nullptr)
+    , _pools()
+    , _running(false)
+    , _pending(), _ticket(0), _abandoned(0)
+    , _lock(), _results()
+{
+}
+
+RequestExecutor::~RequestExecutor()
+{
+}
+
+void RequestExecutor::AddPool(const std::string& name, size_t threads, size_t capacity)
+{
+    _pools[name].reset(new WorkerPool(name, threads, capacity));
+}
+
+void RequestExecutor::Start(struct mg_mgr* mgr)
+{
+    _mgr = mgr;
+    for (auto& pool : _pools)
+    {
+        pool.second->Start();
+    }
+    _running = true;
+}
+
+void RequestExecutor::Stop()
+{
+    if (!_running)
+    {
+        return;
+    }
+    _running = false;
+
+    for (auto& pool : _pools)
+    {
+        pool.second->Cancel();
+    }
+
+    // a finishing worker blocks in mg_broadcast until the poll thread reads the control socket
+    bool busy = true;
+    while (busy)
+    {
+        busy = false;
+        for (auto& pool : _pools)
+        {
+            busy = busy || pool.second->Busy();
+        }
+
+        if (busy)
+        {
+            mg_mgr_poll(_mgr, 100);
+        }
+    }
+
+    for (auto& pool : _pools)
+    {
+        pool.second->Stop();
+    }
+
+    Deliver();
+    _pending.clear();
+}
+
+bool RequestExecutor::Submit(const std::string& pool, struct mg_connection* nc, const Work& work)
+{
+    return submit(pool, nc, work, Reply_Json);
+}
+
+bool RequestExecutor::SubmitResponse(const std::string& pool, struct mg_connection* nc, const Work& work)
+{
+    return submit(pool, nc, work, Reply_Response);
+}
+
+bool RequestExecutor::SubmitFrame(const std::string& pool, struct mg_connection* nc, const Work& work)
+{
+    return submit(pool, nc, work, Reply_Frame);
+}
+
+bool RequestExecutor::Pending(struct mg_connection* nc) const
+{
+    return _pending.end() != _pending.find(nc);
+}
+
+bool RequestExecutor::submit(const std::string& pool, struct mg_connection* nc, const Work& work, Reply_Kind kind)
+{
+    if (!_running)
+    {
+        return false;
+    }
+
+    auto found = _pools.find(pool);
+    if (_pools.end() == found)
+    {
+        return false;
+    }
+
+    unsigned long long ticket = ++_ticket;
+    if (!found->second->Post([this, nc, ticket, work]() { complete(nc, ticket, work()); }))
+    {
+        return false;
+    }
+
+    Reply_t pending = { ticket, false, std::string(), kind, false };
+    _pending[nc].push_back(pending);
+    return true;
+}
+
+void RequestExecutor::Sequence(struct mg_connection* nc, size_t written)
+{
+    auto pending = _pending.find(nc);
+    if (_pending.end() == pending || nc->send_mbuf.len <= written)
+    {
+        return;
+    }
+
+    // take the reply back out of the send buffer, and the close it asks for
+    Reply_t held = { 0, true, std::string(nc->send_mbuf.buf + written, nc->send_mbuf.len - written), Reply_Response, 0 != (nc->flags & MG_F_SEND_AND_CLOSE) };
+    nc->send_mbuf.len = written;
+    nc->flags &= ~MG_F_SEND_AND_CLOSE;
+
+    pending->second.push_back(held);
+}
+
+void RequestExecutor::Deliver()
+{
+    std::unordered_map<unsigned long long, Result_t> results;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        results.swap(_results);
+    }
+
+    for (auto& result : results)
+    {
+        struct mg_connection* nc = result.second.nc;
+
+        // the connection may be closed and its address reused, the ticket tells
+        auto pending = _pending.find(nc);
+        if (_pending.end() == pending)
+        {
+            continue;
+        }
+
+        for (Reply_t& waiting : pending->second)
+        {
+            if (waiting.ticket == result.first)
+            {
+                waiting.done = true;
+                waiting.json.swap(result.second.json);
+                reply(nc);
+                break;
+            }
+        }
+    }
+}
+
+void RequestExecutor::Detach(struct mg_connection* nc)
+{
+    auto pending = _pending.find(nc);
+    if (_pending.end() == pending)
+    {
+        return;
+    }
+
+    for (const Reply_t& waiting : pending->second)
+    {
+        if (!waiting.done)
+        {
+            ++_abandoned;
+        }
+    }
+    _pending.erase(pending);
+}
+
+std::vector<WorkerPoolStats_t> RequestExecutor::Stats() const
+{
+    std::vector<WorkerPoolStats_t> stats;
+    for (auto& pool : _pools)
+    {
+        stats.push_back(pool.second->Stats());
+    }
+    return stats;
+}
+
+void RequestExecutor::complete(struct mg_connection* nc, unsigned long long ticket, const std::string& json)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        Result_t& result = _results[ticket];
+        result.nc = nc;
+        result.json = json;
+    }
+
+    RequestExecutor* executor = this;
+    mg_broadcast(_mgr, ev_complete, &executor, sizeof(executor));
+}
+
+// sends the finished replies at the front of the connection, the ones behind an unfinished reply wait for it
+void RequestExecutor::reply(struct mg_connection* nc)
+{
+    auto pending = _pending.find(nc);
+    while (!pending->second.empty() && pending->second.front().done)
+    {
+        const Reply_t& front = pending->second.front();
+        if (Reply_Response == front.kind)
+        {
+            mg_send(nc, front.json.data(), (int)front.json.size());
+        }
+        else if (Reply_Frame == front.kind)
+        {
+            if (!front.json.empty())
+            {
+                mg_send_websocket_frame(nc, WEBSOCKET_OP_TEXT, front.json.data(), front.json.size());
+            }
+        }
+        else
+        {
+            mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+            mg_send_http_chunk(nc, front.json.c_str(), front.json.size());
+            mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+        }
+
+        if (front.close)
+        {
+            nc->flags |= MG_F_SEND_AND_CLOSE;
+        }
+        pending->second.pop_front();
+    }
+
+    if (pending->second.empty())
+    {
+        _pending.erase(pending);
+    }
+}
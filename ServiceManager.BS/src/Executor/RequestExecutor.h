@@ -0,0 +1,130 @@
+#ifndef _REQUEST_EXECUTOR_HEADER_H_
+#define _REQUEST_EXECUTOR_HEADER_H_
+
+extern "C" {
+#include "mongoose/mongoose.h"
+}
+
+#include "Executor/WorkerPool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+/*
+* runs blocking request handlers on worker pools and completes the connections on the poll thread,
+* results are handed back by mg_broadcast which wakes up mg_mgr_poll
+*
+* the replies of a keep-alive connection are sent in the order of its requests, a pipelined request which is
+* replied at once waits behind the pending work of its connection, see Sequence
+*
+* Submit, Sequence, Deliver and Detach must be called on the poll thread
+*/
+class RequestExecutor
+{
+public:
+    // returns the json replied to the client
+    typedef std::function<std::string()> Work;
+
+public:
+    RequestExecutor();
+    ~RequestExecutor();
+
+    void AddPool(const std::string& name, size_t threads, size_t capacity);
+
+    void Start(struct mg_mgr* mgr);
+
+    // queued work is dropped, running work is waited while polling so that its completion gets through
+    void Stop();
+
+    // false if the pool is unknown, full or stopping, the caller replies by itself then
+    bool Submit(const std::string& pool, struct mg_connection* nc, const Work& work);
+
+    // as Submit, but the work returns the whole http response, status line and headers included
+    bool SubmitResponse(const std::string& pool, struct mg_connection* nc, const Work& work);
+
+    // as Submit, but the text the work returns is sent as a websocket text frame, nothing if it is empty
+    bool SubmitFrame(const std::string& pool, struct mg_connection* nc, const Work& work);
+
+    // work of the connection is not replied yet
+    bool Pending(struct mg_connection* nc) const;
+
+    // called once a request is handled, the reply written to nc beyond written bytes of its send buffer is held
+    // while the work of an earlier request of nc is pending
+    void Sequence(struct mg_connection* nc, size_t written);
+
+    // reply the finished work, called by the broadcast handler
+    void Deliver();
+
+    // the connection is closing, its pending work is abandoned
+    void Detach(struct mg_connection* nc);
+
+    std::vector<WorkerPoolStats_t> Stats() const;
+
+    inline unsigned long long Abandoned() const
+    {
+        return _abandoned;
+    }
+
+private:
+    // what the work returns
+    enum Reply_Kind
+    {
+        Reply_Json,
+        Reply_Response,
+        Reply_Frame
+    };
+
+    bool submit(const std::string& pool, struct mg_connection* nc, const Work& work, Reply_Kind kind);
+    void complete(struct mg_connection* nc, unsigned long long ticket, const std::string& json);
+    void reply(struct mg_connection* nc);
+
+private:
+    struct Result_t
+    {
+        struct mg_connection* nc;
+        std::string json;
+    };
+
+    // a reply of a connection in the order of its requests
+    struct Reply_t
+    {
+        // 0 for a reply held by Sequence
+        unsigned long long ticket;
+        bool done;
+
+        std::string json;
+        Reply_Kind kind;
+
+        // the held reply closes the connection once sent
+        bool close;
+    };
+
+private:
+    struct mg_mgr* _mgr;
+
+    std::unordered_map<std::string, std::unique_ptr<WorkerPool>> _pools;
+
+    std::atomic<bool> _running;
+
+private:
+    // poll thread only
+    std::unordered_map<struct mg_connection*, std::deque<Reply_t>> _pending;
+    unsigned long long _ticket;
+    unsigned long long _abandoned;
+
+private:
+    std::mutex _lock;
+    std::unordered_map<unsigned long long, Result_t> _results;
+
+private:
+    RequestExecutor(const RequestExecutor&);
+    RequestExecutor& operator=(const RequestExecutor&);
+};
+
+#endif
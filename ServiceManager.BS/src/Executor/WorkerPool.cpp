@@ -0,0 +1,146 @@
+#include "Executor/WorkerPool.h"
+
+WorkerPool::WorkerPool(const std::string& name, size_t threads, size_t capacity)
+    : _lock(), _wakeup()
+    , _jobs(), _workers(), _running(false), _cancelled(false)
+    , _stats()
+{
+    _stats.name = name;
+    _stats.threads = threads > 0 ? threads : 1;
+    _stats.capacity = capacity > 0 ? capacity : 1;
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+void WorkerPool::Start()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_running)
+    {
+        return;
+    }
+    _running = true;
+    _cancelled = false;
+
+    for (size_t i = 0; i < _stats.threads; ++i)
+    {
+        _workers.emplace_back(&WorkerPool::work_routine, this);
+    }
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_running)
+        {
+            return;
+        }
+        _running = false;
+
+        _stats.queued = 0;
+        _jobs.clear();
+    }
+    _wakeup.notify_all();
+
+    for (std::thread& worker : _workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    _workers.clear();
+}
+
+void WorkerPool::Cancel()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _cancelled = true;
+
+    _stats.queued = 0;
+    _jobs.clear();
+}
+
+bool WorkerPool::Post(const Task& task)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_running || _cancelled || _jobs.size() >= _stats.capacity)
+        {
+            ++_stats.rejected;
+            return false;
+        }
+
+        Job_t job;
+        job.task = task;
+        job.posted = std::chrono::steady_clock::now();
+        _jobs.emplace_back(std::move(job));
+
+        ++_stats.submitted;
+        _stats.queued = _jobs.size();
+        if (_stats.queued > _stats.queued_max)
+        {
+            _stats.queued_max = _stats.queued;
+        }
+    }
+    _wakeup.notify_one();
+
+    return true;
+}
+
+bool WorkerPool::Busy() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return !_jobs.empty() || _stats.running > 0;
+}
+
+WorkerPoolStats_t WorkerPool::Stats() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats;
+}
+
+void WorkerPool::work_routine()
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    while (true)
+    {
+        _wakeup.wait(guard, [this]() { return !_running || !_jobs.empty(); });
+        if (!_running)
+        {
+            break;
+        }
+
+        Job_t job = std::move(_jobs.front());
+        _jobs.pop_front();
+
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        unsigned long long waited = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(started - job.posted).count();
+
+        _stats.queued = _jobs.size();
+        ++_stats.running;
+        _stats.wait_total += waited;
+        if (waited > _stats.wait_max)
+        {
+            _stats.wait_max = waited;
+        }
+        guard.unlock();
+
+        job.task();
+
+        unsigned long long elapsed = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+
+        guard.lock();
+        --_stats.running;
+        ++_stats.completed;
+        _stats.exec_total += elapsed;
+        if (elapsed > _stats.exec_max)
+        {
+            _stats.exec_max = elapsed;
+        }
+    }
+}
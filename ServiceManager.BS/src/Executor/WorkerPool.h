@@ -0,0 +1,89 @@
+#ifndef _WORKER_POOL_HEADER_H_
+#define _WORKER_POOL_HEADER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+struct WorkerPoolStats_t
+{
+    std::string name;
+
+    size_t threads = 0;
+    size_t capacity = 0;
+
+    size_t queued = 0;
+    size_t queued_max = 0;
+    size_t running = 0;
+
+    unsigned long long submitted = 0;
+    unsigned long long rejected = 0;
+    unsigned long long completed = 0;
+
+    // microseconds spent in queue and in execution
+    unsigned long long wait_total = 0;
+    unsigned long long wait_max = 0;
+    unsigned long long exec_total = 0;
+    unsigned long long exec_max = 0;
+};
+
+/*
+* fixed number of threads working on a bounded queue, posting fails instead of blocking when the queue is full
+*/
+class WorkerPool
+{
+public:
+    typedef std::function<void()> Task;
+
+public:
+    WorkerPool(const std::string& name, size_t threads, size_t capacity);
+    ~WorkerPool();
+
+    void Start();
+
+    // queued tasks are dropped, running tasks are waited
+    void Stop();
+
+    // queued tasks are dropped and posting is refused, running tasks go on
+    void Cancel();
+
+    bool Post(const Task& task);
+
+    // tasks queued or running
+    bool Busy() const;
+
+    WorkerPoolStats_t Stats() const;
+
+private:
+    void work_routine();
+
+private:
+    struct Job_t
+    {
+        Task task;
+        std::chrono::steady_clock::time_point posted;
+    };
+
+private:
+    mutable std::mutex _lock;
+    std::condition_variable _wakeup;
+
+    std::deque<Job_t> _jobs;
+    std::vector<std::thread> _workers;
+    bool _running;
+    bool _cancelled;
+
+    WorkerPoolStats_t _stats;
+
+private:
+    WorkerPool();
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+};
+
+#endif
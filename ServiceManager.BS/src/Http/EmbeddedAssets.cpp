@@ -0,0 +1,58 @@
+
+#include "Http/EmbeddedAssets.h"
+
+#include <string.h>
+
+// generated by the pre-build event of every configuration into $(IntDir)generated, which is on the include path
+#include "EmbeddedAssets.inc"
+
+const EmbeddedAsset_t* EmbeddedAssets::Find(const std::string& path)
+{
+    if (0 == Embedded_Asset_Count)
+    {
+        return nullptr;
+    }
+
+    unsigned int bucket = Hash(0, path.data(), path.size()) % Embedded_Bucket_Count;
+    unsigned int slot = Hash(Embedded_Displacements[bucket], path.data(), path.size()) % Embedded_Asset_Count;
+
+    // a path not packed lands on the slot of another
+    const EmbeddedAsset_t& asset = Embedded_Assets[slot];
+    return path == asset.path ? &asset : nullptr;
+}
+
+size_t EmbeddedAssets::Count()
+{
+    return Embedded_Asset_Count;
+}
+
+unsigned int EmbeddedAssets::Hash(unsigned int seed, const char* data, size_t size)
+{
+    unsigned int hash = 2166136261u ^ seed;
+    hash *= 16777619u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+
+    // the low bits of FNV-1a depend on the low bits of the bytes only, which the slots are taken from
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+void EmbeddedAssets::View(const EmbeddedAsset_t& asset, StaticContent_t& content)
+{
+    content.content_type = asset.content_type;
+    content.cache_control = asset.cache_control;
+    for (int i = Static_Identity; i < Static_Encodings; ++i)
+    {
+        content.data[i] = (const char*)asset.data[i];
+        content.size[i] = asset.size[i];
+        content.etag[i] = asset.etag[i];
+    }
+}
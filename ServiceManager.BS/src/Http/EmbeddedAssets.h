@@ -0,0 +1,43 @@
+#ifndef _EMBEDDED_ASSETS_HEADER_H_
+#define _EMBEDDED_ASSETS_HEADER_H_
+
+#include "Http/StaticAssetCache.h"
+
+#include <string>
+
+struct EmbeddedAsset_t
+{
+    const char* path;
+    const char* content_type;
+    const char* cache_control;
+    const unsigned char* data[Static_Encodings];
+    size_t size[Static_Encodings];
+    const char* etag[Static_Encodings];
+};
+
+/*
+* the web ui packed into the manager by tools\PackHttp.ps1 before the build, a constant table of the files under
+* ServiceLoader\bin\http with their gzip encodings, found by a perfect hash of the path:
+*   slot = Hash(displacements[Hash(0, path) % buckets], path) % count
+* the table is empty when there was nothing to pack, the files are served from the http directory then
+*/
+class EmbeddedAssets
+{
+public:
+    // nullptr if the path is not packed
+    static const EmbeddedAsset_t* Find(const std::string& path);
+
+    static size_t Count();
+
+    // FNV-1a of 32 bits started with the seed and mixed by the finalizer of murmur3, as the packing hashes
+    static unsigned int Hash(unsigned int seed, const char* data, size_t size);
+
+    static void View(const EmbeddedAsset_t& asset, StaticContent_t& content);
+
+private:
+    EmbeddedAssets();
+    EmbeddedAssets(const EmbeddedAssets&);
+    EmbeddedAssets& operator=(const EmbeddedAssets&);
+};
+
+#endif
@@ -5,25 +5,89 @@
 
 #include "StringUtil.h"
 
+#include "Status/ScmServiceController.h"
+
+#include "Http/RouteTable.h"
+#include "Http/JsonResponse.h"
+#include "Http/JsonReflect.h"
+
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 
 #include <algorithm>
 #include <sstream>
 #include <regex>
+#include <chrono>
 
 static const char* Service_Prototype_File = "prototype.json";
 static const char* Service_Upgrade_File = "upgrade.zip";
 static const char* Service_Tmp_Dir = "tmp\\";
+static const char* Service_Http_Dir = "http\\";
+
+// scm operations run concurrently while package upgrades are serialized
+static const char* Service_Pool_Service = "service";
+static const size_t Service_Pool_Service_Threads = 2;
+static const size_t Service_Pool_Service_Capacity = 16;
+
+static const char* Service_Pool_Package = "package";
+static const size_t Service_Pool_Package_Threads = 1;
+static const size_t Service_Pool_Package_Capacity = 1;
+
+static const char* Service_Busy_Text = "Service manager is busy, try again later";
+
+// how long a running loader is waited to dump its flight recorder
+static const int Service_Flight_Timeout = 3000;
+
+// bytes of a log returned by a /service/log/range or /service/log/grep at most, the rest is asked for by the next range
+static const unsigned long long Service_Log_Range_Max = 4 * 1024 * 1024;
+
+// lines returned by a /service/log/grep by default and at most, bytes of a log mapped a time by it,
+// and indexes of logs kept
+static const int Service_Log_Grep_Lines = 1000;
+static const int Service_Log_Grep_Lines_Max = 100000;
+static const size_t Service_Log_Grep_Chunk = 4 * 1024 * 1024;
+static const size_t Service_Log_Indexes_Max = 64;
+
+// a /service/log/tail reads the log so often, sends so many bytes a time at most, and skips the reads while
+// so many are still queued to a slow reader, it starts with the lines in the last bytes of the backlog
+static const double Service_Log_Tail_Interval = 0.5;
+static const size_t Service_Log_Tail_Read = 256 * 1024;
+static const size_t Service_Log_Tail_Queued = 1024 * 1024;
+static const unsigned long long Service_Log_Tail_Backlog = 4096;
+
+// a /service/events stream is the connection flagged so, one with so many bytes still queued is closed to subscribe
+// again, and a comment is sent so often to keep an idle one open through the proxies
+static const unsigned long Service_Events_Flag = MG_F_USER_1;
+static const size_t Service_Events_Queued = 1024 * 1024;
+static const double Service_Events_Keepalive = 15.0;
+
+// the deleted services told to /service/list?since=, a version older than those kept takes the whole list
+static const size_t Service_List_Deleted_Max = 1024;
+
+// the SCM restarts a crashed loader twice, a supervised loader restarts its worker itself
+static const DWORD Service_Restart_Delay = 5000;
+static const DWORD Service_Failure_Reset_Period = 24 * 60 * 60;
 
 static char Service_Status_Name[][16] = {
     "Unknown",
     "Stopped",
     "Starting",
     "Stopping",
-    "Running"
+    "Running",
+    "Continuing",
+    "Pausing",
+    "Paused"
 };
 
+static const char* Service_Status_Text(int status_code)
+{
+    if (status_code < 0 || status_code >= (int)(sizeof(Service_Status_Name) / sizeof(Service_Status_Name[0])))
+    {
+        status_code = 0;
+    }
+    return Service_Status_Name[status_code];
+}
+
 static const int Service_Option_Lib       = 0;
 static const int Service_Option_Config    = 1;
 static const int Service_Option_Log_Path  = 2;
@@ -32,6 +96,9 @@ static const int Service_Option_Log_Level = 4;
 static const int Service_Option_Log_Type  = 5;
 static const int Service_Option_Log_Size  = 6;
 static const int Service_Option_Log_Keep  = 7;
+static const int Service_Option_Supervise = 8;
+static const int Service_Option_Log_Flush = 9;
+static const int Service_Option_Log_Flight = 10;
 
 typedef std::unordered_map<std::string, int> Service_Options_Type;
 
@@ -42,9 +109,392 @@ static Service_Options_Type Service_Options = {
     { "--log.level", Service_Option_Log_Level },
     { "--log.type", Service_Option_Log_Type },
     { "--log.size", Service_Option_Log_Size },
-    { "--log.keep", Service_Option_Log_Keep }
+    { "--log.keep", Service_Option_Log_Keep },
+    { "--service.supervise", Service_Option_Supervise },
+    { "--log.flush", Service_Option_Log_Flush },
+    { "--log.flight", Service_Option_Log_Flight }
+};
+
+// --log.flush=always|interval=<ms>|level=<lvl>
+static bool IsLogFlushValid(const std::string& flush)
+{
+    if ("always" == flush)
+    {
+        return true;
+    }
+
+    if (0 == flush.compare(0, 9, "interval="))
+    {
+        return atoi(flush.c_str() + 9) > 0;
+    }
+
+    if (0 == flush.compare(0, 6, "level="))
+    {
+        static const char* level_name[] = { "trace", "debug", "info", "warn", "error", "fatal", "off" };
+        return std::find(std::begin(level_name), std::end(level_name), flush.substr(6)) != std::end(level_name);
+    }
+
+    return false;
+}
+
+// --log.flight=<lvl>, off for none
+static bool IsLogFlightValid(const std::string& flight)
+{
+    static const char* level_name[] = { "trace", "debug", "info", "warn", "error", "fatal", "off" };
+    return std::find(std::begin(level_name), std::end(level_name), flight) != std::end(level_name);
+}
+
+// an interned field of a service is read and written as a string, found by JsonReflect through the type
+static const char* JsonAssign(InternedString& target, const JsonScalar_t& value, unsigned int flags, JsonValid valid, const char* invalid, const char* empty)
+{
+    std::string text;
+    const char* error = JsonAssign(text, value, flags, valid, invalid, empty);
+    target = text;
+    return error;
+}
+
+static JsonScalar_t JsonValue(const InternedString& value)
+{
+    return JsonValue(value.str());
+}
+
+// the json of a service, services.json and prototype.json keep the library flat while the web ui takes it as an object
+struct HttpServiceJson
+{
+    typedef HttpService::Service_t Service_t;
+    typedef HttpService::library_t library_t;
+    typedef HttpService::log_t log_t;
+
+    static const JsonField_t Instance_Log[];
+    static const JsonField_t Instance[];
+    static const JsonField_t Definition_Log[];
+    static const JsonField_t Prototype[];
+    static const JsonField_t Web_Library[];
+    static const JsonField_t Web_Log[];
+    static const JsonField_t Web_Instance[];
+    static const JsonField_t Web_Definition[];
+    static const JsonField_t Detail_Library[];
+    static const JsonField_t Detail[];
+};
+
+// services.json
+const JsonField_t HttpServiceJson::Instance_Log[] = {
+    JsonField("name", &log_t::name, Json_Trim),
+    JsonField("type", &log_t::type, Json_Required | Json_Trim),
+    JsonField("level", &log_t::level, Json_Trim),
+    JsonField("keep", &log_t::keep),
+    JsonField("size", &log_t::size),
+    JsonField("flush", &log_t::flush, Json_Trim | Json_Omit_Empty, IsLogFlushValid, "is not always, interval=<ms> or level=<lvl>"),
+    JsonField("flight", &log_t::flight, Json_Trim | Json_Omit_Empty, IsLogFlightValid, "is not a log level")
+};
+
+const JsonField_t HttpServiceJson::Instance[] = {
+    JsonField("id", &Service_t::id, Json_Required | Json_Trim),
+    JsonField("name", &Service_t::name, Json_Required | Json_Not_Empty | Json_Trim),
+    JsonField("description", &Service_t::description, Json_Trim),
+    JsonInnerField("library", &Service_t::library, &library_t::name, Json_Required | Json_Not_Empty | Json_Trim),
+    JsonInnerField("configuration", &Service_t::library, &library_t::config, Json_Trim),
+    JsonInnerField("version", &Service_t::library, &library_t::ver, Json_Trim, nullptr, nullptr, "unknown"),
+    JsonObject("log", &Service_t::log, Instance_Log, Json_Required),
+    JsonField("supervise", &Service_t::supervise)
+};
+
+// prototype.json of a definition, whose id is its directory, and the log of a definition in the web ui
+const JsonField_t HttpServiceJson::Definition_Log[] = {
+    JsonField("name", &log_t::name, Json_Trim),
+    JsonField("type", &log_t::type, Json_Required | Json_Trim),
+    JsonField("level", &log_t::level, Json_Trim),
+    JsonField("keep", &log_t::keep),
+    JsonField("size", &log_t::size)
+};
+
+const JsonField_t HttpServiceJson::Prototype[] = {
+    JsonField("name", &Service_t::name, Json_Required | Json_Not_Empty | Json_Trim),
+    JsonField("description", &Service_t::description, Json_Trim),
+    JsonInnerField("library", &Service_t::library, &library_t::name, Json_Not_Empty | Json_Trim),
+    JsonInnerField("configuration", &Service_t::library, &library_t::config, Json_Trim),
+    JsonInnerField("version", &Service_t::library, &library_t::ver, Json_Trim, nullptr, nullptr, "unknown"),
+    JsonObject("log", &Service_t::log, Definition_Log, Json_Required)
+};
+
+// the web ui
+const JsonField_t HttpServiceJson::Web_Library[] = {
+    JsonField("path", &library_t::name),
+    JsonField("configuration", &library_t::config),
+    JsonField("version", &library_t::ver)
+};
+
+const JsonField_t HttpServiceJson::Web_Log[] = {
+    JsonField("name", &log_t::name),
+    JsonField("type", &log_t::type),
+    JsonField("level", &log_t::level),
+    JsonField("keep", &log_t::keep),
+    JsonField("size", &log_t::size),
+    JsonField("flush", &log_t::flush),
+    JsonField("flight", &log_t::flight)
+};
+
+const JsonField_t HttpServiceJson::Web_Instance[] = {
+    JsonField("id", &Service_t::id),
+    JsonField("name", &Service_t::name),
+    JsonField("description", &Service_t::description),
+    JsonObject("library", &Service_t::library, Web_Library),
+    JsonObject("log", &Service_t::log, Web_Log),
+    JsonField("supervise", &Service_t::supervise)
+};
+
+const JsonField_t HttpServiceJson::Web_Definition[] = {
+    JsonField("id", &Service_t::id),
+    JsonField("name", &Service_t::name),
+    JsonField("description", &Service_t::description),
+    JsonObject("library", &Service_t::library, Web_Library),
+    JsonObject("log", &Service_t::log, Definition_Log)
+};
+
+// the detail names the library path name
+const JsonField_t HttpServiceJson::Detail_Library[] = {
+    JsonField("name", &library_t::name),
+    JsonField("configuration", &library_t::config),
+    JsonField("version", &library_t::ver)
+};
+
+const JsonField_t HttpServiceJson::Detail[] = {
+    JsonField("id", &Service_t::id),
+    JsonField("name", &Service_t::name),
+    JsonField("description", &Service_t::description),
+    JsonObject("library", &Service_t::library, Detail_Library)
 };
 
+// the log name as the loader makes it, split to the stem and .log or .txt
+static void GetLogName(const std::string& service_name, const std::string& log_name, bool supervise, std::string& stem, std::string& ext)
+{
+    stem = log_name.empty() ? service_name : log_name;
+    std::for_each(stem.begin(), stem.end(), [](char& ch) {
+        if (!std::isdigit((unsigned char)ch) && !std::isalpha((unsigned char)ch) && '-' != ch && '_' != ch && '.' != ch)
+        {
+            ch = '-';
+        }
+    });
+
+    ext = ".log";
+    std::string::size_type pos = stem.find_last_of('.');
+    if (std::string::npos != pos)
+    {
+        std::string suffix = stem.substr(pos);
+        if (0 == _stricmp(suffix.c_str(), ".txt") || 0 == _stricmp(suffix.c_str(), ".log"))
+        {
+            ext = suffix;
+        }
+        stem = stem.substr(0, pos);
+    }
+
+    // a supervised loader runs the modules in its worker, which logs to <log name>-worker
+    if (supervise)
+    {
+        stem += "-worker";
+    }
+}
+
+// logs\<log name>.flight.blog which the loader dumps its flight recorder to
+static std::string GetFlightFile(const std::string& root, const std::string& service_name, const std::string& log_name, bool supervise)
+{
+    std::string stem, ext;
+    GetLogName(service_name, log_name, supervise, stem, ext);
+    return root + "logs\\" + stem + ".flight.blog";
+}
+
+// the log being written, logs\<log name>_<yyyy-mm-dd>.log of today for a daily one, logs\<log name>.log for a rotating one
+static std::string GetLogFile(const std::string& root, const std::string& service_name, const std::string& log_name, const std::string& log_type, bool supervise)
+{
+    std::string stem, ext;
+    GetLogName(service_name, log_name, supervise, stem, ext);
+
+    if (log_type.empty() || "daily" == log_type)
+    {
+        SYSTEMTIME now;
+        GetLocalTime(&now);
+
+        char date[16] = { 0 };
+        snprintf(date, sizeof(date), "_%04d-%02d-%02d", now.wYear, now.wMonth, now.wDay);
+        stem += date;
+    }
+    return root + "logs\\" + stem + ext;
+}
+
+// the data of an event, written once for all of its subscribers in the arena of the thread
+typedef rapidjson::GenericStringBuffer<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>> EventBuffer;
+
+// {"step":"<step>"} of the upgrade events
+static std::string GetUpgradeEvent(const char* step)
+{
+    JsonArena arena;
+    EventBuffer buffer(&arena.Allocator());
+    rapidjson::Writer<EventBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("step");
+    writer.String(step);
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+// a log compressed by the LogArchiver, <log>.gz or <log>.zst
+static bool IsArchivedLog(const std::string& file)
+{
+    std::string::size_type pos = file.find_last_of('.');
+    return std::string::npos != pos && (0 == _stricmp(file.c_str() + pos, ".gz") || 0 == _stricmp(file.c_str() + pos, ".zst"));
+}
+
+// a log of the service named by file= instead of the one being written, a plain name of its logs only,
+// and of its compressed logs too if archived
+static bool IsLogFileOf(const std::string& file, const std::string& service_name, const std::string& log_name, bool supervise, bool archived)
+{
+    std::string stem, ext;
+    GetLogName(service_name, log_name, supervise, stem, ext);
+
+    std::string plain = archived && IsArchivedLog(file) ? file.substr(0, file.find_last_of('.')) : file;
+    if (plain.size() <= stem.size() + 4 || 0 != plain.compare(0, stem.size(), stem) ||
+        std::string::npos != plain.find_first_of("\\/:") || std::string::npos != plain.find(".."))
+    {
+        return false;
+    }
+
+    std::string suffix = plain.substr(plain.size() - 4);
+    return 0 == _stricmp(suffix.c_str(), ".log") || 0 == _stricmp(suffix.c_str(), ".txt");
+}
+
+// hh:mm[:ss[.mmm]] to the ms of the day, -1 if it is none
+static int ParseLogTime(const char* text)
+{
+    unsigned int hour = 0, minute = 0, second = 0, ms = 0;
+    int parsed = sscanf(text, "%u:%u:%u.%u", &hour, &minute, &second, &ms);
+    if (parsed < 2 || hour > 23 || minute > 59 || second > 59 || ms > 999)
+    {
+        return -1;
+    }
+    return (int)(((hour * 60 + minute) * 60 + second) * 1000 + ms);
+}
+
+// bytes=<first>-<last>, bytes=<first>- or bytes=-<suffix> of the size to [begin, end), false if it is unsatisfiable,
+// only the first of several ranges is taken
+static bool ParseByteRange(const std::string& range, unsigned long long size, unsigned long long& begin, unsigned long long& end)
+{
+    if (0 != range.compare(0, 6, "bytes="))
+    {
+        return false;
+    }
+
+    std::string spec = range.substr(6, range.find(',') - 6);
+    std::string::size_type dash = spec.find('-');
+    if (std::string::npos == dash)
+    {
+        return false;
+    }
+
+    std::string first = util::string::trim(spec.substr(0, dash)), last = util::string::trim(spec.substr(dash + 1));
+    if (first.empty())
+    {
+        unsigned long long suffix = strtoull(last.c_str(), nullptr, 10);
+        if (last.empty() || 0 == suffix || 0 == size)
+        {
+            return false;
+        }
+        begin = size > suffix ? size - suffix : 0;
+        end = size;
+        return true;
+    }
+
+    begin = strtoull(first.c_str(), nullptr, 10);
+    end = last.empty() ? size : std::min(strtoull(last.c_str(), nullptr, 10) + 1, size);
+    return begin < end;
+}
+
+// whether Accept-Encoding takes the coding, one of q=0 is refused
+static bool AcceptsEncoding(const struct mg_str* accept_encoding, const char* coding)
+{
+    if (nullptr == accept_encoding)
+    {
+        return false;
+    }
+
+    std::string accepted(accept_encoding->p, accept_encoding->len);
+    std::string::size_type pos = 0;
+    while (pos < accepted.size())
+    {
+        std::string::size_type end = accepted.find(',', pos);
+        if (std::string::npos == end)
+        {
+            end = accepted.size();
+        }
+        std::string item = accepted.substr(pos, end - pos);
+        pos = end + 1;
+
+        std::string::size_type params = item.find(';');
+        std::string name = item.substr(0, params);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (_stricmp(name.c_str(), coding) != 0)
+        {
+            continue;
+        }
+
+        std::string::size_type q = std::string::npos == params ? params : item.find("q=", params);
+        return std::string::npos == q || atof(item.c_str() + q + 2) > 0;
+    }
+    return false;
+}
+
+// whether If-None-Match is * or lists the etag, weakly compared as a W/ one matches as well, an empty one matches nothing
+static bool MatchesETag(const struct mg_str* if_none_match, const std::string& etag)
+{
+    if (nullptr == if_none_match)
+    {
+        return false;
+    }
+
+    std::string tags(if_none_match->p, if_none_match->len);
+    tags.erase(0, tags.find_first_not_of(" \t"));
+    tags.erase(tags.find_last_not_of(" \t") + 1);
+    if ("*" == tags)
+    {
+        return true;
+    }
+
+    std::string::size_type pos = 0;
+    while (pos < tags.size())
+    {
+        std::string::size_type end = tags.find(',', pos);
+        if (std::string::npos == end)
+        {
+            end = tags.size();
+        }
+        std::string tag = tags.substr(pos, end - pos);
+        pos = end + 1;
+
+        tag.erase(0, tag.find_first_not_of(" \t"));
+        tag.erase(tag.find_last_not_of(" \t") + 1);
+        if (0 == tag.compare(0, 2, "W/"))
+        {
+            tag.erase(0, 2);
+        }
+
+        if (!tag.empty() && etag == tag)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static unsigned long long GetFileWriteTime(const std::string& file)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesEx(file.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        return 0;
+    }
+    return ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
 class ArchiveCloser
 {
 public:
@@ -91,6 +541,40 @@ private:
     ArchiveCloser& operator=(const ArchiveCloser&);
 };
 
+typedef void (HttpService::*HttpHandler)(struct mg_connection *nc, struct http_message *hm);
+
+// the rest api, the {name} routes are those of the forms with the name in the path
+struct HttpRoutes
+{
+    static constexpr Route_t<HttpHandler> table[] = {
+        { "*", "/service/list", &HttpService::handle_service_list },
+        { "*", "/definition/list", &HttpService::handle_definition_list },
+        { "*", "/service/detail/get", &HttpService::handle_service_detail_get },
+        { "*", "/service/detail/set", &HttpService::handle_service_detail_set },
+        { "*", "/service/create", &HttpService::handle_service_create },
+        { "*", "/service/delete", &HttpService::handle_service_delete },
+        { "*", "/service/control", &HttpService::handle_service_control },
+        { "*", "/service/upgrade", &HttpService::handle_service_upgrade },
+        { "*", "/service/supervisor", &HttpService::handle_service_supervisor },
+        { "*", "/service/flight-recorder", &HttpService::handle_service_flight_recorder },
+        { "*", "/service/log/range", &HttpService::handle_service_log_range },
+        { "*", "/service/log/grep", &HttpService::handle_service_log_grep },
+        { "*", "/service/events", &HttpService::handle_service_events },
+        { "*", "/executor/stats", &HttpService::handle_executor_stats },
+        { "GET", "/route/stats", &HttpService::handle_route_stats },
+        { "*", "/service/{name}/delete", &HttpService::handle_service_delete },
+        { "*", "/service/{name}/control", &HttpService::handle_service_control },
+        { "*", "/service/{name}/supervisor", &HttpService::handle_service_supervisor },
+        { "*", "/service/{name}/flight-recorder", &HttpService::handle_service_flight_recorder },
+        { "GET", "/service/{name}/log/range", &HttpService::handle_service_log_range },
+        { "GET", "/service/{name}/log/grep", &HttpService::handle_service_log_grep },
+    };
+};
+
+constexpr Route_t<HttpHandler> HttpRoutes::table[];
+
+typedef RouteTable<HttpRoutes> HttpRouteTable;
+
 std::shared_ptr<spdlog::logger> HttpService::_logger;
 
 std::shared_ptr<spdlog::logger>& HttpService::logger()
@@ -100,13 +584,24 @@ std::shared_ptr<spdlog::logger>& HttpService::logger()
 
 HttpService::HttpService()
     : _mgr(), _opts()
-    , _definitions_path(), _service_definitions()
-    , _services_path(), _service_instances()
+    , _definitions_path(), _service_definitions(&Service_t::id)
+    , _services_path(), _service_instances(&Service_t::name)
+    , _instances_lock()
+    , _list_version(0), _list_status_version(0)
+    , _deleted_instances(), _deleted_floor(0)
+    , _status_cache()
+    , _log_archiver()
+    , _directory(), _static_cache()
+    , _executor(), _route_stats()
+    , _events_status_version(0), _events_id(0), _events_keepalive(0)
+    , _events_queued(), _events_lock()
     , _root()
-    , _package()
+    , _package(), _upgrading(false)
 {
     _opts.document_root = nullptr;
     _opts.enable_directory_listing = "no";
+
+    _route_stats.resize(HttpRouteTable::Count + 1);
 }
 
 HttpService::~HttpService()
@@ -135,9 +630,8 @@ static std::string GetLastErrorString()
     return err_str;
 }
 
-static void GetLastErrorString(rapidjson::Value& err, rapidjson::Document::AllocatorType& allo)
+static void GetErrorString(DWORD code, rapidjson::Value& err, rapidjson::Document::AllocatorType& allo)
 {
-    DWORD code = GetLastError();
 #ifdef UTF8_SUPPORTED
     LPVOID lpMsgBuf = NULL;
     DWORD bufLen = FormatMessage(
@@ -269,15 +763,53 @@ static void GetLastErrorString(rapidjson::Value& err, rapidjson::Document::Alloc
         err.SetString("Service can not accept control message this time", allo);
         break;
     }
-    default:
-        char buff[256] = { 0 };
-        snprintf(buff, sizeof(buff), "Service failed due to unknown error(%ld)", code);
-        err.SetString(buff, allo);
+    default:
+        char buff[256] = { 0 };
+        snprintf(buff, sizeof(buff), "Service failed due to unknown error(%ld)", code);
+        err.SetString(buff, allo);
         break;
     }
 #endif
 }
 
+static void GetLastErrorString(rapidjson::Value& err, rapidjson::Document::AllocatorType& allo)
+{
+    GetErrorString(GetLastError(), err, allo);
+}
+
+static int GetServiceStatus(const ServiceStatusSnapshot& statuses, const std::string& name, rapidjson::Value& txt, rapidjson::Document::AllocatorType& allo)
+{
+    ServiceStatusMap_t::const_iterator found = statuses->services.find(name);
+    if (found == statuses->services.end())
+    {
+        txt.SetString(Service_Status_Text(0), allo);
+        return 0;
+    }
+
+    if (found->second.error != ERROR_SUCCESS)
+    {
+        GetErrorString(found->second.error, txt, allo);
+    }
+    else
+    {
+        txt.SetString(Service_Status_Text(found->second.status_code), allo);
+    }
+    return found->second.status_code;
+}
+
+template <typename Writer>
+static void WriteString(Writer& writer, const std::string& value)
+{
+    writer.String(value.c_str(), (rapidjson::SizeType)value.size());
+}
+
+template <typename Writer>
+static void WriteStringMember(Writer& writer, const char* key, const std::string& value)
+{
+    writer.Key(key);
+    WriteString(writer, value);
+}
+
 static int archive_copy_data(struct archive *ar, struct archive *aw, rapidjson::Value& code, rapidjson::Value& err, rapidjson::Document::AllocatorType& allo)
 {
     int r;
@@ -365,50 +897,37 @@ static void ev_handler(struct mg_connection *nc, int ev, void *ev_data)
     {
     case MG_EV_HTTP_REQUEST:
     {
-        if (mg_vcmp(&hm->uri, "/service/list") == 0)
-        {
-            http->handle_service_list(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/definition/list") == 0)
-        {
-            http->handle_definition_list(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/detail/get") == 0)
-        {
-            http->handle_service_detail_get(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/detail/set") == 0)
-        {
-            http->handle_service_detail_set(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/create") == 0)
-        {
-            http->handle_service_create(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/delete") == 0)
-        {
-            http->handle_service_delete(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/control") == 0)
-        {
-            http->handle_service_control(nc, hm); /* Handle RESTful call */
-        }
-        else if (mg_vcmp(&hm->uri, "/service/upgrade") == 0)
-        {
-            http->handle_service_upgrade(nc, hm); /* Handle RESTful call */
-        }
-        else
+        // a pipelined request replied at once waits behind the pending work of the connection
+        size_t written = nc->send_mbuf.len;
+        http->handle_request(nc, hm);
+        http->_executor.Sequence(nc, written);
+        break;
+    }
+    case MG_EV_WEBSOCKET_HANDSHAKE_REQUEST:
+    {
+        if (mg_vcmp(&hm->uri, "/service/log/tail") == 0)
         {
-            http->handle_html(nc, hm);
+            http->handle_service_log_tail(nc, hm);
         }
         break;
     }
+    case MG_EV_TIMER:
+    {
+        http->handle_service_log_tail_timer(nc);
+        break;
+    }
+    case MG_EV_CLOSE:
+    {
+        http->_executor.Detach(nc);
+        http->_log_tails.erase(nc);
+        break;
+    }
     default:
         break;
     }
 }
 
-int HttpService::Create(const std::string& address, int port, const std::string& directory, const std::string& service_definition_config, const std::string& service_active_config, const std::string& root, std::shared_ptr<spdlog::logger>& log)
+int HttpService::Create(const std::string& address, int port, const std::string& directory, const std::string& service_definition_config, const std::string& service_active_config, const std::string& root, int status_interval, const std::string& log_compress, int log_compress_rate, int log_compress_keep, std::shared_ptr<spdlog::logger>& log)
 {
     HttpService::_logger = log;
     _root = root;
@@ -425,6 +944,39 @@ int HttpService::Create(const std::string& address, int port, const std::string&
         return Service_Module_Failed;
     }
 
+    // the list versions start at the time in ms, later than those of the manager run before
+    _list_version = (unsigned long long)(mg_time() * 1000);
+    _deleted_floor = _list_version;
+    for (Service_t& serv : _service_instances)
+    {
+        serv.version = _list_version;
+    }
+
+    // service status is refreshed in background, handlers only read the latest snapshot
+    _status_cache.reset(new ServiceStatusCache(std::make_shared<ScmServiceController>(), status_interval));
+    for (const Service_t& serv : _service_instances)
+    {
+        _status_cache->Track(serv.name);
+    }
+    _status_cache->Start();
+
+    // the logs retired by the loaders are compressed in background
+    _log_archiver.reset(new LogArchiver(_root + "logs\\", log_compress, log_compress_rate, log_compress_keep, _logger));
+    _log_archiver->Start();
+
+    // the web ui packed into the manager is served unless a directory is configured, or nothing was packed,
+    // the files of the directory are served from memory once loaded, and loaded again as they change
+    _directory = directory;
+    if (_directory.empty() && 0 == EmbeddedAssets::Count())
+    {
+        _directory = _root + Service_Http_Dir;
+    }
+    if (!_directory.empty())
+    {
+        _static_cache.reset(new StaticAssetCache(_directory, _logger));
+        _static_cache->Start();
+    }
+
     struct mg_bind_opts bind_opts;
     memset(&bind_opts, 0, sizeof(bind_opts));
 
@@ -433,6 +985,11 @@ int HttpService::Create(const std::string& address, int port, const std::string&
 
     mg_mgr_init(&_mgr, nullptr);
 
+    // blocking handlers are completed asynchronously so that the poll thread keeps serving
+    _executor.AddPool(Service_Pool_Service, Service_Pool_Service_Threads, Service_Pool_Service_Capacity);
+    _executor.AddPool(Service_Pool_Package, Service_Pool_Package_Threads, Service_Pool_Package_Capacity);
+    _executor.Start(&_mgr);
+
     char endpoint[256] = { 0 };
     snprintf(endpoint, sizeof(endpoint), "%s:%d", address.c_str(), port);
 
@@ -445,13 +1002,13 @@ int HttpService::Create(const std::string& address, int port, const std::string&
     }
     nc->user_data = this;
 
-    _opts.document_root = directory.c_str();
+    _opts.document_root = _directory.c_str();
     mg_register_http_endpoint(nc, "/service/upload", ev_upload MG_UD_ARG(NULL));
 
     // Set up HTTP server parameters
     mg_set_protocol_http_websocket(nc);
 
-    _logger->info("create http service({}) on {} success", endpoint, directory.c_str());
+    _logger->info("create http service({}) on {} success", endpoint, _directory.empty() ? "the packed web ui" : _directory.c_str());
 
     return Service_Module_Success;
 }
@@ -459,12 +1016,34 @@ int HttpService::Create(const std::string& address, int port, const std::string&
 void HttpService::Serve()
 {
     mg_mgr_poll(&_mgr, 1000);
+
+    publish_events();
 }
 
 void HttpService::Destroy()
 {
+    _executor.Stop();
+
     mg_mgr_free(&_mgr);
 
+    if (_status_cache)
+    {
+        _status_cache->Stop();
+        _status_cache.reset();
+    }
+
+    if (_log_archiver)
+    {
+        _log_archiver->Stop();
+        _log_archiver.reset();
+    }
+
+    if (_static_cache)
+    {
+        _static_cache->Stop();
+        _static_cache.reset();
+    }
+
     _logger->info("destroy http service success");
 }
 
@@ -497,155 +1076,30 @@ int HttpService::load_service_definitions()
             }
 
             // check service definition file
-            std::ifstream ifs(_definitions_path + serv.id + "\\" + Service_Prototype_File);
+            std::ifstream ifs(_definitions_path + serv.id + "\\" + Service_Prototype_File);
             if (ifs.is_open())
             {
                 ifs.seekg(0, std::ios::end);
                 size_t length = (size_t)ifs.tellg();
-                ifs.seekg(0, std::ios::beg);
-
-                std::vector<char> content(length);
+                ifs.seekg(0, std::ios::beg);
+
+                std::vector<char> content(length + 1, 0);
                 ifs.read(content.data(), length);
                 ifs.close();
 
-                rapidjson::Document serv_json;
-                serv_json.Parse(content.data());
-                if (!serv_json.IsObject())
+                serv.library.name = serv.id + ".dll";
+                serv.log.level = "info";
+                serv.log.keep = 7;
+                serv.log.size = 7;
+
+                std::string error;
+                if (!JsonReadObject(content.data(), serv, HttpServiceJson::Prototype, error))
                 {
-                    _logger->warn("service prototype of definition({}) is invalid", ffd.cFileName);
+                    _logger->warn("service prototype of definition({}) is invalid: {}", ffd.cFileName, error.c_str());
                     continue;
                 }
-                
-                if (!serv_json.HasMember("name"))
-                {
-                    _logger->warn("service prototype of definition({}) is invalid: name is not provided", ffd.cFileName);
-                    continue;
-                }
-                if (!serv_json["name"].IsString())
-                {
-                    _logger->warn("service prototype of definition({}) is invalid: name is not string", ffd.cFileName);
-                    continue;
-                }
-                serv.name = util::string::trim(serv_json["name"].GetString());
-
-                if (serv.name.empty())
-                {
-                    _logger->warn("service prototype of definition({}) is invalid: name is empty", ffd.cFileName);
-                    continue;
-                }
-
-                if (serv_json.HasMember("description"))
-                {
-                    if (serv_json["description"].IsString())
-                    {
-                        serv.description = util::string::trim(serv_json["description"].GetString());
-                    }
-                    else
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: description is not string", ffd.cFileName);
-                        continue;
-                    }
-                }
-
-                serv.library.name = std::string(ffd.cFileName) + std::string(".dll");
-                if (serv_json.HasMember("library"))
-                {
-                    if (!serv_json["library"].IsString())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: library is not string", ffd.cFileName);
-                        continue;
-                    }
-                    serv.library.name = util::string::trim(serv_json["library"].GetString());
-
-                    if (serv.library.name.empty())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: library is empty", ffd.cFileName);
-                        continue;
-                    }
-                }
-
-                if (serv_json.HasMember("configuration"))
-                {
-                    if (!serv_json["configuration"].IsString())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: configuration is not string", ffd.cFileName);
-                        continue;
-                    }
-                    serv.library.config = util::string::trim(serv_json["configuration"].GetString());
-                }
-
-                if (serv_json.HasMember("version"))
-                {
-                    if (!serv_json["version"].IsString())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: version is not string", ffd.cFileName);
-                        continue;
-                    }
-                    serv.library.ver = util::string::trim(serv_json["version"].GetString());
-
-                    if (serv.library.ver.empty())
-                    {
-                        serv.library.ver = "unknown";
-                    }
-                }
-
-                rapidjson::Value& log_json = serv_json["log"];
-                if (log_json.HasMember("name"))
-                {
-                    if (!log_json["name"].IsString())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: log.name is not string", ffd.cFileName);
-                        continue;
-                    }
-                    serv.log.name = util::string::trim(log_json["name"].GetString());
-                }
-
-                if (!log_json.HasMember("type"))
-                {
-                    _logger->warn("service prototype of definition({}) is invalid: log.type is not provided", ffd.cFileName);
-                    continue;
-                }
-                if (!log_json["type"].IsString())
-                {
-                    _logger->warn("service prototype of definition({}) is invalid: log.type is not string", ffd.cFileName);
-                    continue;
-                }
-                serv.log.type = util::string::trim(log_json["type"].GetString());
-
-                serv.log.level = "info";
-                if (log_json.HasMember("level"))
-                {
-                    if (!log_json["level"].IsString())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: log.level is not string", ffd.cFileName);
-                        continue;
-                    }
-                    serv.log.level = util::string::trim(log_json["level"].GetString());
-                }
-
-                serv.log.keep = 7;
-                if (log_json.HasMember("keep"))
-                {
-                    if (!log_json["keep"].IsNumber())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: log.keep is not number", ffd.cFileName);
-                        continue;
-                    }
-                    serv.log.keep = log_json["keep"].GetInt();
-                }
-                
-                serv.log.size = 7;
-                if (log_json.HasMember("size"))
-                {
-                    if (!log_json["size"].IsNumber())
-                    {
-                        _logger->warn("service prototype of definition({}) is invalid: log.size is not number", ffd.cFileName);
-                        continue;
-                    }
-                    serv.log.size = log_json["size"].GetInt();
-                }
 
-                _service_definitions.emplace_back(serv);
+                _service_definitions.Add(serv);
             }
             else
             {
@@ -661,413 +1115,147 @@ int HttpService::load_service_definitions()
 
 int HttpService::load_service_instances()
 {
-    do 
+    std::ifstream ifs(_services_path);
+    if (!ifs.is_open())
     {
-        std::ifstream ifs(_services_path);
-        if (!ifs.is_open())
-        {
-            break;
-        }
-        ifs.seekg(0, std::ios::end);
-        size_t length = (size_t)ifs.tellg();
-        ifs.seekg(0, std::ios::beg);
-
-        std::vector<char> content(length);
-        ifs.read(content.data(), length);
-        ifs.close();
-
-        rapidjson::Document instances_json;
-        instances_json.Parse(content.data());
-        rapidjson::Type jt = instances_json.GetType();
-        if (rapidjson::kNullType == jt)
-        {
-            break;
-        }
+        return Service_Module_Success;
+    }
+    ifs.seekg(0, std::ios::end);
+    size_t length = (size_t)ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
 
-        if (rapidjson::kObjectType != jt)
-        {
-            _logger->error("create http service failed: invalid services file({})", _services_path.c_str());
-            return Service_Module_Failed;
-        }
+    std::vector<char> content(length + 1, 0);
+    ifs.read(content.data(), length);
+    ifs.close();
 
-        if (instances_json.Empty())
-        {
-            break;
-        }
+    Service_t initial;
+    initial.log.level = "info";
+    initial.log.keep = 7;
+    initial.log.size = 7;
+    initial.status_code = 0;
+    initial.status_txt = Service_Status_Name[0];
 
-        if (!instances_json.HasMember("services"))
+    // read a service a time, an invalid one is left out
+    Services_t instances(&Service_t::name);
+    std::string error;
+    bool read = JsonReadArray<Service_t>(content.data(), "services", initial, HttpServiceJson::Instance, [&instances](Service_t& serv, const std::string& serv_error) {
+        if (!serv_error.empty())
         {
-            _logger->error("create http service failed: invalid services file({}), services field is not provided", _services_path.c_str());
-            return Service_Module_Failed;
+            _logger->warn("service({}) is invalid: {}", serv.name.empty() ? serv.id.c_str() : serv.name.c_str(), serv_error.c_str());
+            return;
         }
-
-        rapidjson::Value json = instances_json["services"].GetArray();
-        jt = json.GetType();
-        if (rapidjson::kArrayType != jt)
+        if (!instances.Add(serv))
         {
-            _logger->error("create http service failed: invalid services file({}), services field is not array", _services_path.c_str());
-            return Service_Module_Failed;
+            _logger->warn("service({}) is invalid: it is listed already", serv.name.c_str());
         }
+    }, error);
 
-        for (rapidjson::Value& serv_json : json.GetArray())
-        {
-            if (serv_json.IsObject() && serv_json.Empty())
-            {
-                continue;
-            }
-
-            Service_t serv;
-            if (!serv_json.HasMember("id"))
-            {
-                _logger->warn("service is invalid: id is not provided");
-                continue;
-            }
-            if (!serv_json["id"].IsString())
-            {
-                _logger->warn("service is invalid: id is not string");
-                continue;
-            }
-            serv.id = util::string::trim(serv_json["id"].GetString());
-
-            if (!serv_json.HasMember("name"))
-            {
-                _logger->warn("service({}) is invalid: name is not provided", serv.id.c_str());
-                continue;
-            }
-            if (!serv_json["name"].IsString())
-            {
-                _logger->warn("service({}) is invalid: name is not string", serv.id.c_str());
-                continue;
-            }
-            serv.name = util::string::trim(serv_json["name"].GetString());
-
-            if (serv.name.empty())
-            {
-                _logger->warn("service({}) is invalid: name is empty", serv.id.c_str());
-                continue;
-            }
-
-            if (serv_json.HasMember("description"))
-            {
-                if (serv_json["description"].IsString())
-                {
-                    serv.description = util::string::trim(serv_json["description"].GetString());
-                }
-                else
-                {
-                    _logger->warn("service({}) is invalid: description is not string", serv.name.c_str());
-                    continue;
-                }
-            }
-
-            if (!serv_json.HasMember("library"))
-            {
-                _logger->warn("service({}) is invalid: library is not provided", serv.name.c_str());
-                continue;
-            }
-
-            if (!serv_json["library"].IsString())
-            {
-                _logger->warn("service({}) is invalid: library is not string", serv.name.c_str());
-                continue;
-            }
-            serv.library.name = util::string::trim(serv_json["library"].GetString());
-
-            if (serv.library.name.empty())
-            {
-                _logger->warn("service({}) is invalid: library is empty", serv.name.c_str());
-                continue;
-            }
-
-            if (serv_json.HasMember("configuration"))
-            {
-                if (!serv_json["configuration"].IsString())
-                {
-                    _logger->warn("service({}) is invalid: configuration is not string", serv.name.c_str());
-                    continue;
-                }
-                serv.library.config = util::string::trim(serv_json["configuration"].GetString());
-            }
-
-            if (serv_json.HasMember("version"))
-            {
-                if (!serv_json["version"].IsString())
-                {
-                    _logger->warn("service({}) is invalid: version is not string", serv.name.c_str());
-                    continue;
-                }
-                serv.library.ver = util::string::trim(serv_json["version"].GetString());
-
-                if (serv.library.ver.empty())
-                {
-                    serv.library.ver = "unknown";
-                }
-            }
-
-            rapidjson::Value& log_json = serv_json["log"];
-            if (log_json.HasMember("name"))
-            {
-                if (!log_json["name"].IsString())
-                {
-                    _logger->warn("service({}) is invalid: log.name is not string", serv.name.c_str());
-                    continue;
-                }
-                serv.log.name = util::string::trim(log_json["name"].GetString());
-            }
-
-            if (!log_json.HasMember("type"))
-            {
-                _logger->warn("service({}) is invalid: log.type is not provided", serv.name.c_str());
-                continue;
-            }
-            if (!log_json["type"].IsString())
-            {
-                _logger->warn("service({}) is invalid: log.type is not string", serv.name.c_str());
-                continue;
-            }
-            serv.log.type = util::string::trim(log_json["type"].GetString());
-
-            serv.log.level = "info";
-            if (log_json.HasMember("level"))
-            {
-                if (!log_json["level"].IsString())
-                {
-                    _logger->warn("service({}) is invalid: log.level is not string", serv.name.c_str());
-                    continue;
-                }
-                serv.log.level = util::string::trim(log_json["level"].GetString());
-            }
-
-            serv.log.keep = 7;
-            if (log_json.HasMember("keep"))
-            {
-                if (!log_json["keep"].IsNumber())
-                {
-                    _logger->warn("service({}) is invalid: log.keep is not number", serv.name.c_str());
-                    continue;
-                }
-                serv.log.keep = log_json["keep"].GetInt();
-            }
-
-            serv.log.size = 7;
-            if (log_json.HasMember("size"))
-            {
-                if (!log_json["size"].IsNumber())
-                {
-                    _logger->warn("service({}) is invalid: log.size is not number", serv.name.c_str());
-                    continue;
-                }
-                serv.log.size = log_json["size"].GetInt();
-            }
-
-            serv.status_code = 0;
-            serv.status_txt = Service_Status_Name[0];
+    if (!read && error == Json_Not_Json)
+    {
+        _logger->warn("services file({}) is not json, no service is loaded", _services_path.c_str());
+        return Service_Module_Success;
+    }
 
-            _service_instances.emplace_back(serv);
-        }
-    } while (false);
+    if (!read)
+    {
+        _logger->error("create http service failed: invalid services file({}), {}", _services_path.c_str(), error.c_str());
+        return Service_Module_Failed;
+    }
 
+    _service_instances = std::move(instances);
     return Service_Module_Success;
 }
 
 void HttpService::handle_service_list(struct mg_connection *nc, struct http_message *hm)
 {
-    rapidjson::Value code(rapidjson::kNumberType);
-    rapidjson::Value array(rapidjson::kArrayType);
-    rapidjson::Document doc(rapidjson::kObjectType);
-
-    code.SetInt(Service_Module_Success);
+    ServiceStatusSnapshot statuses = _status_cache->Snapshot();
+    observe_status_changes(statuses);
 
-    SC_HANDLE schSCManager = OpenSCManager(
-        NULL,                    // local computer
-        NULL,                    // ServicesActive database 
-        SC_MANAGER_ALL_ACCESS);  // full access rights 
+    char etag[32] = { 0 };
+    snprintf(etag, sizeof(etag), "\"%llu\"", _list_version);
 
-    SERVICE_STATUS_PROCESS ssStatus;
-    DWORD dwBytesNeeded;
-
-    rapidjson::Value str_json(rapidjson::kStringType);
-    rapidjson::Value num_json(rapidjson::kNumberType);
-    for (const Service_t& serv : _service_instances)
+    // nothing changed since the list the client holds
+    struct mg_str* if_none_match = mg_get_http_header(hm, "If-None-Match");
+    if (if_none_match && 0 == mg_vcmp(if_none_match, etag))
     {
-        rapidjson::Value serv_json(rapidjson::kObjectType);
-
-        str_json.SetString(serv.id.c_str(), doc.GetAllocator());
-        serv_json.AddMember("id", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.name.c_str(), doc.GetAllocator());
-        serv_json.AddMember("name", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.description.c_str(), doc.GetAllocator());
-        serv_json.AddMember("description", str_json, doc.GetAllocator());
-
-        rapidjson::Value lib_json(rapidjson::kObjectType);
-
-        str_json.SetString(serv.library.name.c_str(), doc.GetAllocator());
-        lib_json.AddMember("path", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.library.config.c_str(), doc.GetAllocator());
-        lib_json.AddMember("configuration", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.library.ver.c_str(), doc.GetAllocator());
-        lib_json.AddMember("version", str_json, doc.GetAllocator());
-
-        serv_json.AddMember("library", lib_json, doc.GetAllocator());
-
-        rapidjson::Value log_json(rapidjson::kObjectType);
-        str_json.SetString(serv.log.name.c_str(), doc.GetAllocator());
-        log_json.AddMember("name", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.log.type.c_str(), doc.GetAllocator());
-        log_json.AddMember("type", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.log.level.c_str(), doc.GetAllocator());
-        log_json.AddMember("level", str_json, doc.GetAllocator());
-
-        num_json.SetInt(serv.log.keep);
-        log_json.AddMember("keep", num_json, doc.GetAllocator());
-
-        num_json.SetInt(serv.log.size);
-        log_json.AddMember("size", num_json, doc.GetAllocator());
-
-        serv_json.AddMember("log", log_json, doc.GetAllocator());
-
-        if (schSCManager)
-        {
-            rapidjson::Value res(rapidjson::kStringType);
-            do 
-            {
-                ssStatus.dwCurrentState = 0;
+        mg_printf(nc, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nContent-Length: 0\r\n\r\n", etag);
+        return;
+    }
 
-                SC_HANDLE schService = OpenService(
-                    schSCManager,               // SCM database 
-                    serv.name.c_str(),          // name of service 
-                    SERVICE_ALL_ACCESS);        // desired access
+    char since_var[32] = { 0 };
+    if (mg_get_http_var(&hm->query_string, "since", since_var, sizeof(since_var)) <= 0)
+    {
+        mg_get_http_var(&hm->body, "since", since_var, sizeof(since_var));
+    }
+    unsigned long long since = strtoull(since_var, nullptr, 10);
 
-                if (schService == NULL)
-                {
-                    GetLastErrorString(res, doc.GetAllocator());
-                    break;
-                }
+    // the services changed after since and the ones deleted, or all of them once since is not a version of
+    // this manager or older than the deletions kept
+    bool full = since < _deleted_floor || since > _list_version;
 
-                if (!QueryServiceStatusEx(
-                    schService,                     // handle to service 
-                    SC_STATUS_PROCESS_INFO,         // information level
-                    (LPBYTE)&ssStatus,             // address of structure
-                    sizeof(SERVICE_STATUS_PROCESS), // size of structure
-                    &dwBytesNeeded))              // size needed if buffer is too small
-                {
-                    GetLastErrorString(res, doc.GetAllocator());
-                    CloseServiceHandle(schService);
-                    break;
-                }
+    // written as it is made into the send buffer, a list of thousands of services is not copied on the way
+    JsonArena arena;
 
-                res.SetString(Service_Status_Name[ssStatus.dwCurrentState], doc.GetAllocator());
+    char head[64] = { 0 };
+    snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nETag: %s\r\n", etag);
+    JsonResponse response(nc, head);
+    rapidjson::Writer<JsonResponse> writer(response);
 
-                CloseServiceHandle(schService);
-            } while (false);
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(Service_Module_Success);
 
-            num_json.SetInt(ssStatus.dwCurrentState);
-            serv_json.AddMember("status_code", num_json, doc.GetAllocator());
-            serv_json.AddMember("status_txt", res, doc.GetAllocator());
-        }
-        else
+    writer.Key("result");
+    writer.StartArray();
+    for (const Service_t& serv : _service_instances)
+    {
+        if (!full && serv.version <= since)
         {
-            num_json.SetInt(0);
-            serv_json.AddMember("status_code", num_json, doc.GetAllocator());
-            str_json.SetString(Service_Status_Name[0], doc.GetAllocator());
-            serv_json.AddMember("status_txt", str_json, doc.GetAllocator());
+            continue;
         }
-
-        array.PushBack(serv_json, doc.GetAllocator());
+        write_service_json(writer, serv, statuses, arena.Allocator());
     }
+    writer.EndArray();
 
-    if (schSCManager)
+    writer.Key("deleted");
+    writer.StartArray();
+    if (!full)
     {
-        CloseServiceHandle(schSCManager);
+        // a name created again is among the changed ones
+        for (std::deque<std::pair<unsigned long long, std::string>>::const_reverse_iterator it = _deleted_instances.crbegin(); it != _deleted_instances.crend() && it->first > since; ++it)
+        {
+            if (!find_service_instance(it->second))
+            {
+                writer.String(it->second.c_str(), (rapidjson::SizeType)it->second.size());
+            }
+        }
     }
+    writer.EndArray();
 
-    doc.AddMember("code", code, doc.GetAllocator());
-    doc.AddMember("result", array, doc.GetAllocator());
-
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
-
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    writer.Key("version");
+    writer.Uint64(_list_version);
+    writer.Key("full");
+    writer.Bool(full);
+    writer.EndObject();
 }
 
 void HttpService::handle_definition_list(struct mg_connection *nc, struct http_message *hm)
 {
-    rapidjson::Value code(rapidjson::kNumberType);
-    rapidjson::Value array(rapidjson::kArrayType);
-    rapidjson::Document doc(rapidjson::kObjectType);
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
 
-    code.SetInt(Service_Module_Success);
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(Service_Module_Success);
 
-    rapidjson::Value str_json(rapidjson::kStringType);
-    rapidjson::Value num_json(rapidjson::kNumberType);
+    writer.Key("result");
+    writer.StartArray();
     for (const Service_t& serv : _service_definitions)
     {
-        rapidjson::Value serv_json(rapidjson::kObjectType);
-
-        str_json.SetString(serv.id.c_str(), doc.GetAllocator());
-        serv_json.AddMember("id", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.name.c_str(), doc.GetAllocator());
-        serv_json.AddMember("name", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.description.c_str(), doc.GetAllocator());
-        serv_json.AddMember("description", str_json, doc.GetAllocator());
-
-        rapidjson::Value lib_json(rapidjson::kObjectType);
-
-        str_json.SetString(serv.library.name.c_str(), doc.GetAllocator());
-        lib_json.AddMember("path", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.library.config.c_str(), doc.GetAllocator());
-        lib_json.AddMember("configuration", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.library.ver.c_str(), doc.GetAllocator());
-        lib_json.AddMember("version", str_json, doc.GetAllocator());
-
-        serv_json.AddMember("library", lib_json, doc.GetAllocator());
-
-        rapidjson::Value log_json(rapidjson::kObjectType);
-        str_json.SetString(serv.log.name.c_str(), doc.GetAllocator());
-        log_json.AddMember("name", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.log.type.c_str(), doc.GetAllocator());
-        log_json.AddMember("type", str_json, doc.GetAllocator());
-
-        str_json.SetString(serv.log.level.c_str(), doc.GetAllocator());
-        log_json.AddMember("level", str_json, doc.GetAllocator());
-
-        num_json.SetInt(serv.log.keep);
-        log_json.AddMember("keep", num_json, doc.GetAllocator());
-
-        num_json.SetInt(serv.log.size);
-        log_json.AddMember("size", num_json, doc.GetAllocator());
-
-        serv_json.AddMember("log", log_json, doc.GetAllocator());
-
-        array.PushBack(serv_json, doc.GetAllocator());
+        JsonWriteObject(writer, serv, HttpServiceJson::Web_Definition);
     }
-
-    doc.AddMember("code", code, doc.GetAllocator());
-    doc.AddMember("result", array, doc.GetAllocator());
-
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
-
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    writer.EndArray();
+    writer.EndObject();
 }
 
 void HttpService::handle_service_detail_get(struct mg_connection *nc, struct http_message *hm)
@@ -1076,221 +1264,614 @@ void HttpService::handle_service_detail_get(struct mg_connection *nc, struct htt
     /* Get form variables */
     mg_get_http_var(&hm->body, "type", stype, sizeof(stype));
     mg_get_http_var(&hm->body, "index", index, sizeof(index));
-    
-    rapidjson::Value code(rapidjson::kNumberType);
-    rapidjson::Value serv_json(rapidjson::kObjectType);
-    rapidjson::Document doc(rapidjson::kObjectType);
 
-    code.SetInt(Service_Module_Success);
+    // a definition is told by its id, an instance by its name
+    bool definition = strcmp(stype, "definition") == 0;
+    const Service_t* found = definition ? _service_definitions.Find(index) : _service_instances.Find(index);
+
+    JsonArena arena;
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
 
-    rapidjson::Value str_json(rapidjson::kStringType);
-    rapidjson::Value num_json(rapidjson::kNumberType);
-    if (strcmp(stype, "definition") == 0)
+    writer.StartObject();
+    writer.Key("code");
+    writer.Int(Service_Module_Success);
+
+    writer.Key("result");
+    if (nullptr == found)
     {
-        for (const Service_t& serv : _service_definitions)
+        std::stringstream ss;
+        ss << (definition ? "Service definition(" : "Service(") << index << ") does not exist";
+        WriteString(writer, ss.str());
+    }
+    else
+    {
+        writer.StartObject();
+        JsonWriteMembers(writer, *found, HttpServiceJson::Detail);
+        WriteStringMember(writer, "option", make_option(*found, false));
+
+        std::string configuration;
+        std::ifstream ifs(definition ? _definitions_path + found->id + "\\" + found->library.config : _root + "conf\\" + found->library.config);
+        if (ifs.is_open())
         {
-            if (serv.id == index)
-            {
-                str_json.SetString(serv.id.c_str(), doc.GetAllocator());
-                serv_json.AddMember("id", str_json, doc.GetAllocator());
+            ifs.seekg(0, std::ios::end);
+            size_t length = (size_t)ifs.tellg();
+            ifs.seekg(0, std::ios::beg);
+            configuration.resize(length);
 
-                str_json.SetString(serv.name.c_str(), doc.GetAllocator());
-                serv_json.AddMember("name", str_json, doc.GetAllocator());
+            // the text mode reads less than the length of a file of \r\n
+            ifs.read(&configuration[0], length);
+            configuration.resize((size_t)ifs.gcount());
+            ifs.close();
+        }
+        WriteStringMember(writer, "configuration", configuration);
 
-                str_json.SetString(serv.description.c_str(), doc.GetAllocator());
-                serv_json.AddMember("description", str_json, doc.GetAllocator());
+        if (!definition)
+        {
+            rapidjson::Value status_txt(rapidjson::kStringType);
+            int status_code = GetServiceStatus(_status_cache->Snapshot(), found->name, status_txt, arena.Allocator());
+            writer.Key("status_code");
+            writer.Int(status_code);
+            writer.Key("status_txt");
+            writer.String(status_txt.GetString(), status_txt.GetStringLength());
+        }
+        writer.EndObject();
+    }
+    writer.EndObject();
+}
 
-                rapidjson::Value lib_json(rapidjson::kObjectType);
-                str_json.SetString(serv.library.name.c_str(), doc.GetAllocator());
-                lib_json.AddMember("name", str_json, doc.GetAllocator());
+void HttpService::handle_service_detail_set(struct mg_connection *nc, struct http_message *hm)
+{
+    char stype[32] = { 0 }, index[128] = { 0 };
+    char name[128] = { 0 };
+    char option[512] = { 0 };
 
-                str_json.SetString(serv.library.config.c_str(), doc.GetAllocator());
-                lib_json.AddMember("configuration", str_json, doc.GetAllocator());
+    std::vector<char> configuration(20 << 4);
+    /* Get form variables */
+    mg_get_http_var(&hm->body, "type", stype, sizeof(stype));
+    mg_get_http_var(&hm->body, "index", index, sizeof(index));
+    mg_get_http_var(&hm->body, "name", name, sizeof(name));
+    mg_get_http_var(&hm->body, "option", option, sizeof(option));
+    mg_get_http_var(&hm->body, "configuration", configuration.data(), configuration.size());
 
-                str_json.SetString(serv.library.ver.c_str(), doc.GetAllocator());
-                lib_json.AddMember("version", str_json, doc.GetAllocator());
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
 
-                serv_json.AddMember("library", lib_json, doc.GetAllocator());
+    do
+    {
+        std::stringstream ss;
 
-                str_json.SetString(make_option(serv, false).c_str(), doc.GetAllocator());
-                serv_json.AddMember("option", str_json, doc.GetAllocator());
+        if (strcmp(stype, "service") != 0)
+        {
+            ss << "Service operation target(" << stype << ") is not recognized";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
 
-                std::ifstream ifs(_definitions_path + serv.id + "\\" + serv.library.config);
-                if (ifs.is_open())
-                {
-                    std::string str;
-                    ifs.seekg(0, std::ios::end);
-                    size_t length = (size_t)ifs.tellg();
-                    ifs.seekg(0, std::ios::beg);
-                    str.resize(length);
+        // find service definition
+        if (!_service_definitions.Find(index))
+        {
+            ss << "Service definition(" << index << ") does not exist";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
 
-                    ifs.read((char*)str.data(), length);
-                    ifs.close();
+        // find existed service
+        Service_t* serv = _service_instances.Find(name);
+        if (!serv)
+        {
+            ss << "Service(" << name << ") does not exist";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
 
-                    str_json.SetString(str.c_str(), doc.GetAllocator());
-                }
-                else
-                {
-                    str_json.SetString("", doc.GetAllocator());
-                }
-                serv_json.AddMember("configuration", str_json, doc.GetAllocator());
+        Service_t tmp = *serv;
+        if (!parse_option(tmp, option, res, doc.GetAllocator()))
+        {
+            break;
+        }
 
-                break;
-            }
+        if (!create_service_configuration(tmp, configuration, res, doc.GetAllocator()))
+        {
+            break;
         }
 
-        if (serv_json.Empty())
         {
-            std::stringstream ss;
+            std::lock_guard<std::mutex> guard(_instances_lock);
+            tmp.version = ++_list_version;
+            *serv = tmp;
+        }
+        publish_service_event("changed", *serv);
+
+        code.SetInt(Service_Module_Success);
+        res.SetString("success", doc.GetAllocator());
+    } while (false);
+
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+void HttpService::handle_service_create(struct mg_connection *nc, struct http_message *hm)
+{
+    char stype[32] = { 0 }, index[128] = { 0 };
+    char name[128] = { 0 };
+    char option[512] = { 0 };
+    
+    std::vector<char> configuration(20 << 4);
+    /* Get form variables */
+    mg_get_http_var(&hm->body, "type", stype, sizeof(stype));
+    mg_get_http_var(&hm->body, "index", index, sizeof(index));
+    mg_get_http_var(&hm->body, "name", name, sizeof(name));
+    mg_get_http_var(&hm->body, "option", option, sizeof(option));
+    mg_get_http_var(&hm->body, "configuration", configuration.data(), configuration.size());
+    
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
+
+    do 
+    {
+        std::stringstream ss;
+
+        if (strcmp(stype, "definition") != 0)
+        {
+            ss << "Service operation target(" << stype << ") is not recognized";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
+
+        // find service definition
+        const Service_t* definition = _service_definitions.Find(index);
+        if (!definition)
+        {
             ss << "Service definition(" << index << ") does not exist";
-            str_json.SetString(ss.str().c_str(), doc.GetAllocator());
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
         }
-    } 
-    else
+        
+        // find existed service
+        if (_service_instances.Find(name))
+        {
+            ss << "Service(" << name << ") has already exist";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
+
+        Service_t serv = *definition;
+        serv.name = name;
+
+        if (!parse_option(serv, option, res, doc.GetAllocator()))
+        {
+            break;
+        }
+
+        if (!create_service_configuration(serv, configuration, res, doc.GetAllocator()))
+        {
+            break;
+        }
+
+        SC_HANDLE schSCManager = OpenSCManager(
+            NULL,                    // local computer
+            NULL,                    // ServicesActive database 
+            SC_MANAGER_ALL_ACCESS);  // full access rights 
+        if (NULL == schSCManager)
+        {
+            code.SetInt(Service_Module_Failed);
+            GetLastErrorString(res, doc.GetAllocator());
+            break;
+        }
+
+        std::vector<char> binary(1024);
+        snprintf(binary.data(), binary.size(), "%sServiceLoader.exe %s", _root.c_str(), make_option(serv, true).c_str());
+        SC_HANDLE schService = CreateService(
+            schSCManager,              // SCM database 
+            name,                      // name of service 
+            name,                      // service name to display 
+            SERVICE_ALL_ACCESS,        // desired access 
+            SERVICE_WIN32_OWN_PROCESS, // service type 
+            SERVICE_AUTO_START,        // start type 
+            SERVICE_ERROR_NORMAL,      // error control type 
+            binary.data(),             // path to service's binary 
+            NULL,                      // no load ordering group 
+            NULL,                      // no tag identifier 
+            NULL,                      // no dependencies 
+            NULL,                      // LocalSystem account 
+            NULL);                     // no password 
+
+        if (schService == NULL)
+        {
+            GetLastErrorString(res, doc.GetAllocator());
+
+            CloseServiceHandle(schSCManager);
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
+
+        SERVICE_DESCRIPTION desc;
+        desc.lpDescription = (char*)serv.description.c_str();
+        if (!ChangeServiceConfig2(schService, SERVICE_CONFIG_DESCRIPTION, &desc))
+        {
+            GetLastErrorString(res, doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+
+            // delete service
+            DeleteService(schService);
+
+            CloseServiceHandle(schService);
+            CloseServiceHandle(schSCManager);
+            break;
+        }
+
+        // a clean stop with an error code, as a supervisor which gives up, is not taken as failure
+        SC_ACTION actions[3] = {
+            { SC_ACTION_RESTART, Service_Restart_Delay },
+            { SC_ACTION_RESTART, Service_Restart_Delay },
+            { SC_ACTION_NONE, 0 }
+        };
+        SERVICE_FAILURE_ACTIONS failure;
+        ZeroMemory(&failure, sizeof(failure));
+        failure.dwResetPeriod = Service_Failure_Reset_Period;
+        failure.cActions = sizeof(actions) / sizeof(actions[0]);
+        failure.lpsaActions = actions;
+        if (!ChangeServiceConfig2(schService, SERVICE_CONFIG_FAILURE_ACTIONS, &failure))
+        {
+            rapidjson::Value err(rapidjson::kStringType);
+            GetLastErrorString(err, doc.GetAllocator());
+            _logger->warn("service({}) recovery is not configured: {}", name, err.GetString());
+        }
+
+        CloseServiceHandle(schService);
+        CloseServiceHandle(schSCManager);
+
+        code.SetInt(Service_Module_Success);
+        res.SetString("success", doc.GetAllocator());
+
+        {
+            std::lock_guard<std::mutex> guard(_instances_lock);
+            serv.version = ++_list_version;
+            _service_instances.Add(serv);
+        }
+        _status_cache->Track(serv.name);
+
+        fresh_services_json(_service_instances, _services_path);
+
+        publish_service_event("created", serv);
+    } while (false);
+
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+void HttpService::handle_service_delete(struct mg_connection *nc, struct http_message *hm)
+{
+    char name[128] = { 0 };
+    mg_get_http_var(&hm->body, "name", name, sizeof(name));
+
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
+
+    do
     {
-        for (const Service_t& serv : _service_instances)
+        bool found = nullptr != _service_instances.Find(name);
+
+        std::stringstream ss;
+        if (!found)
+        {
+            ss << "Service(" << name << ") does not exist";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
+
+        // a service settled in a state other than stopped is rejected by the cached status, the scm tells the others
+        rapidjson::Value status_txt(rapidjson::kStringType);
+        int status_code = GetServiceStatus(_status_cache->Snapshot(), name, status_txt, doc.GetAllocator());
+        if (0 != status_code && SERVICE_STOPPED != status_code && _status_cache->Settled(name))
+        {
+            ss << "Service state(" << status_txt.GetString() << ") is not stopped";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
+
+        SC_HANDLE schSCManager = OpenSCManager(
+            NULL,                    // local computer
+            NULL,                    // ServicesActive database 
+            SC_MANAGER_ALL_ACCESS);  // full access rights 
+        if (NULL == schSCManager)
+        {
+            code.SetInt(Service_Module_Failed);
+            GetLastErrorString(res, doc.GetAllocator());
+            break;
+        }
+
+        SC_HANDLE schService = OpenService(
+            schSCManager,              // SCM database 
+            name,                      // name of service 
+            SERVICE_ALL_ACCESS);       // desired access
+
+        if (schService == NULL)
+        {
+            GetLastErrorString(res, doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+
+            CloseServiceHandle(schSCManager);
+            break;
+        }
+
+        // the cached status may be a refresh behind, one started meanwhile is not to be deleted
+        SERVICE_STATUS_PROCESS ssStatus;
+        DWORD dwBytesNeeded;
+        if (!QueryServiceStatusEx(
+            schService,                     // handle to service 
+            SC_STATUS_PROCESS_INFO,         // information level
+            (LPBYTE)&ssStatus,             // address of structure
+            sizeof(SERVICE_STATUS_PROCESS), // size of structure
+            &dwBytesNeeded))              // size needed if buffer is too small
+        {
+            GetLastErrorString(res, doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+
+            CloseServiceHandle(schService);
+            CloseServiceHandle(schSCManager);
+            break;
+        }
+
+        if (ssStatus.dwCurrentState != SERVICE_STOPPED)
+        {
+            ss << "Service state(" << Service_Status_Text(ssStatus.dwCurrentState) << ") is not stopped";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            _status_cache->Invalidate(name);
+
+            CloseServiceHandle(schService);
+            CloseServiceHandle(schSCManager);
+            break;
+        }
+
+        if (!DeleteService(schService))
         {
-            if (serv.name == index)
+            code.SetInt(Service_Module_Failed);
+            GetLastErrorString(res, doc.GetAllocator());
+        } 
+        else
+        {
+            code.SetInt(Service_Module_Success);
+            res.SetString("success", doc.GetAllocator());
+
+            std::string lame = name;
+            std::string config;
             {
-                str_json.SetString(serv.id.c_str(), doc.GetAllocator());
-                serv_json.AddMember("id", str_json, doc.GetAllocator());
+                std::lock_guard<std::mutex> guard(_instances_lock);
+                const Service_t* el = _service_instances.Find(lame);
+                if (el)
+                {
+                    config = el->library.config;
+                }
+                _service_instances.Erase(lame);
+
+                _deleted_instances.emplace_back(++_list_version, lame);
+                if (_deleted_instances.size() > Service_List_Deleted_Max)
+                {
+                    _deleted_floor = _deleted_instances.front().first;
+                    _deleted_instances.pop_front();
+                }
+            }
+
+            // the poll thread reads the instances without the lock, the workers wait for neither the files nor the event
+            if (!config.empty())
+            {
+                std::string config_path = _root + "conf\\" + config;
+                if (_access(config_path.c_str(), 00) == 0)
+                {
+                    if (remove(config_path.c_str()) != 0)
+                    {
+                        _logger->warn("delete service({}) configuration file({}) failed: {}", lame.c_str(), config.c_str(), GetLastErrorString().c_str());
+                    }
+                }
+            }
+            fresh_services_json(_service_instances, _services_path);
+
+            _status_cache->Untrack(lame);
+
+            JsonArena arena;
+            EventBuffer event_buffer(&arena.Allocator());
+            rapidjson::Writer<EventBuffer> event_writer(event_buffer);
+            event_writer.StartObject();
+            WriteStringMember(event_writer, "name", lame);
+            event_writer.EndObject();
+            publish_event("deleted", event_buffer.GetString(), event_buffer.GetSize());
+        }
+
+        CloseServiceHandle(schService);
+        CloseServiceHandle(schSCManager);
+    } while (false);
+
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+void HttpService::handle_service_control(struct mg_connection *nc, struct http_message *hm)
+{
+    char action[128] = { 0 }, name[128] = { 0 };
 
-                str_json.SetString(serv.name.c_str(), doc.GetAllocator());
-                serv_json.AddMember("name", str_json, doc.GetAllocator());
+    mg_get_http_var(&hm->body, "action", action, sizeof(action));
+    mg_get_http_var(&hm->body, "name", name, sizeof(name));
 
-                str_json.SetString(serv.description.c_str(), doc.GetAllocator());
-                serv_json.AddMember("description", str_json, doc.GetAllocator());
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
 
-                rapidjson::Value lib_json(rapidjson::kObjectType);
-                str_json.SetString(serv.library.name.c_str(), doc.GetAllocator());
-                lib_json.AddMember("name", str_json, doc.GetAllocator());
+    do
+    {
+        bool found = nullptr != _service_instances.Find(name);
 
-                str_json.SetString(serv.library.config.c_str(), doc.GetAllocator());
-                lib_json.AddMember("configuration", str_json, doc.GetAllocator());
+        std::stringstream ss;
+        if (!found)
+        {
+            ss << "Service(" << name << ") does not exist";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
+            break;
+        }
 
-                str_json.SetString(serv.library.ver.c_str(), doc.GetAllocator());
-                lib_json.AddMember("version", str_json, doc.GetAllocator());
+        // the cached status may be behind the service, a start or stop which cannot be done fails with the error of the scm
+        // starting a service waits for its process to report, do it off the poll thread
+        std::string service_action(action), service_name(name);
+        if (!_executor.Submit(Service_Pool_Service, nc, [this, service_action, service_name]() { return control_service(service_action, service_name); }))
+        {
+            code.SetInt(Service_Module_Failed);
+            res.SetString(Service_Busy_Text, doc.GetAllocator());
+            break;
+        }
+        return;
+    } while (false);
 
-                serv_json.AddMember("library", lib_json, doc.GetAllocator());
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
 
-                str_json.SetString(make_option(serv, false).c_str(), doc.GetAllocator());
-                serv_json.AddMember("option", str_json, doc.GetAllocator());
-                
-                std::ifstream ifs(_root + "conf\\" + serv.library.config);
-                if (ifs.is_open())
-                {
-                    std::string str;
-                    ifs.seekg(0, std::ios::end);
-                    size_t length = (size_t)ifs.tellg();
-                    ifs.seekg(0, std::ios::beg);
-                    str.resize(length);
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
 
-                    ifs.read((char*)str.data(), length);
-                    ifs.close();
+void HttpService::handle_service_upgrade(struct mg_connection *nc, struct http_message *hm)
+{
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
 
-                    str_json.SetString(str.c_str(), doc.GetAllocator());
-                }
-                else
-                {
-                    str_json.SetString("", doc.GetAllocator());
-                }
-                serv_json.AddMember("configuration", str_json, doc.GetAllocator());
+    do
+    {
+        if (_package.is_open())
+        {
+            code.SetInt(Service_Module_Failed);
+            res.SetString("Service package is being uploaded", doc.GetAllocator());
+            break;
+        }
 
-                num_json.SetInt(serv.status_code);
-                serv_json.AddMember("status_code", num_json, doc.GetAllocator());
-                str_json.SetString(serv.status_txt.c_str(), doc.GetAllocator());
-                serv_json.AddMember("status_txt", str_json, doc.GetAllocator());
-                break;
-            }
+        // the package is replaced by the next upload, one upgrade at a time
+        bool upgrading = false;
+        if (!_upgrading.compare_exchange_strong(upgrading, true))
+        {
+            code.SetInt(Service_Module_Failed);
+            res.SetString("Service package is being upgraded", doc.GetAllocator());
+            break;
         }
 
-        if (serv_json.Empty())
+        if (!_executor.Submit(Service_Pool_Package, nc, [this]() { return upgrade_services(); }))
         {
-            std::stringstream ss;
-            ss << "Service(" << index << ") does not exist";
-            str_json.SetString(ss.str().c_str(), doc.GetAllocator());
+            _upgrading = false;
+
+            code.SetInt(Service_Module_Failed);
+            res.SetString(Service_Busy_Text, doc.GetAllocator());
+            break;
         }
-    }
+        return;
+    } while (false);
 
     doc.AddMember("code", code, doc.GetAllocator());
-    if (serv_json.Empty())
-    {
-        doc.AddMember("result", str_json, doc.GetAllocator());
-    } 
-    else
-    {
-        doc.AddMember("result", serv_json, doc.GetAllocator());
-    }
+    doc.AddMember("result", res, doc.GetAllocator());
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
     doc.Accept(writer);
-
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
 }
 
-void HttpService::handle_service_detail_set(struct mg_connection *nc, struct http_message *hm)
+// the metrics which the supervisor of a --service.supervise=on loader writes to logs\<service name>.supervisor.json
+void HttpService::handle_service_supervisor(struct mg_connection *nc, struct http_message *hm)
 {
-    char stype[32] = { 0 }, index[128] = { 0 };
     char name[128] = { 0 };
-    char option[512] = { 0 };
-
-    std::vector<char> configuration(20 << 4);
-    /* Get form variables */
-    mg_get_http_var(&hm->body, "type", stype, sizeof(stype));
-    mg_get_http_var(&hm->body, "index", index, sizeof(index));
     mg_get_http_var(&hm->body, "name", name, sizeof(name));
-    mg_get_http_var(&hm->body, "option", option, sizeof(option));
-    mg_get_http_var(&hm->body, "configuration", configuration.data(), configuration.size());
 
-    rapidjson::Document doc(rapidjson::kObjectType);
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
     rapidjson::Value code(rapidjson::kNumberType);
     rapidjson::Value res(rapidjson::kStringType);
 
     do
     {
-        std::stringstream ss;
+        const Service_t* found = _service_instances.Find(name);
 
-        if (strcmp(stype, "service") != 0)
+        std::stringstream ss;
+        if (!found)
         {
-            ss << "Service operation target(" << stype << ") is not recognized";
+            ss << "Service(" << name << ") does not exist";
             res.SetString(ss.str().c_str(), doc.GetAllocator());
             code.SetInt(Service_Module_Failed);
             break;
         }
 
-        // find service definition
-        Service_t* serv;
-        for (Service_t& servd : _service_definitions)
-        {
-            if (servd.id == index)
-            {
-                serv = &servd;
-                break;
-            }
-        }
-        if (!serv)
+        if (!found->supervise)
         {
-            ss << "Service definition(" << index << ") does not exist";
+            ss << "Service(" << name << ") is not supervised";
             res.SetString(ss.str().c_str(), doc.GetAllocator());
             code.SetInt(Service_Module_Failed);
             break;
         }
 
-        serv = nullptr;
-        // find existed service
-        for (Service_t& servs : _service_instances)
+        // the status file is read off the poll thread
+        std::string service_name(name), status_file(_root + "logs\\" + name + ".supervisor.json");
+        if (!_executor.Submit(Service_Pool_Service, nc, [this, service_name, status_file]() { return read_supervisor_status(service_name, status_file); }))
         {
-            if (servs.name == name)
-            {
-                serv = &servs;
-                break;
-            }
+            code.SetInt(Service_Module_Failed);
+            res.SetString(Service_Busy_Text, doc.GetAllocator());
+            break;
         }
-        if (!serv)
+        return;
+    } while (false);
+
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+// the messages which the flight recorder of a --log.flight loader keeps, a running loader is asked to dump them first,
+// the dump of a stopped one is what it left on its crash
+void HttpService::handle_service_flight_recorder(struct mg_connection *nc, struct http_message *hm)
+{
+    char name[128] = { 0 };
+    mg_get_http_var(&hm->body, "name", name, sizeof(name));
+
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
+
+    do
+    {
+        const Service_t* found = _service_instances.Find(name);
+
+        std::stringstream ss;
+        if (!found)
         {
             ss << "Service(" << name << ") does not exist";
             res.SetString(ss.str().c_str(), doc.GetAllocator());
@@ -1298,113 +1879,453 @@ void HttpService::handle_service_detail_set(struct mg_connection *nc, struct htt
             break;
         }
 
-        Service_t tmp = *serv;
-        if (!parse_option(tmp, option, res, doc.GetAllocator()))
+        if (found->log.flight.empty() || "off" == found->log.flight)
         {
+            ss << "Service(" << name << ") has no flight recorder";
+            res.SetString(ss.str().c_str(), doc.GetAllocator());
+            code.SetInt(Service_Module_Failed);
             break;
         }
 
-        if (!create_service_configuration(tmp, configuration, res, doc.GetAllocator()))
+        rapidjson::Value status_txt(rapidjson::kStringType);
+        bool running = SERVICE_RUNNING == GetServiceStatus(_status_cache->Snapshot(), name, status_txt, doc.GetAllocator());
+
+        // waits for the loader to write the dump, do it off the poll thread
+        std::string service_name(name), flight_file(GetFlightFile(_root, found->name, found->log.name, found->supervise));
+        if (!_executor.Submit(Service_Pool_Service, nc, [this, service_name, flight_file, running]() { return dump_flight_recorder(service_name, flight_file, running); }))
         {
+            code.SetInt(Service_Module_Failed);
+            res.SetString(Service_Busy_Text, doc.GetAllocator());
             break;
         }
-
-        *serv = tmp;
-
-        code.SetInt(Service_Module_Success);
-        res.SetString("success", doc.GetAllocator());
+        return;
     } while (false);
 
     doc.AddMember("code", code, doc.GetAllocator());
     doc.AddMember("result", res, doc.GetAllocator());
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
     doc.Accept(writer);
+}
+
+// GET ?name=<service>[&file=<log>][&from=hh:mm[:ss[.mmm]]][&to=...] with an optional Range: bytes=..., the bytes of the log
+// being written or of file are returned as 206 with Content-Range, from and to pick the lines logged in the time
+// of the day and narrow the bytes further, a range past the end is 416
+void HttpService::handle_service_log_range(struct mg_connection *nc, struct http_message *hm)
+{
+    std::string log_file;
+    int from_ms = -1, to_ms = -1;
+    if (!parse_log_request(nc, hm, false, log_file, from_ms, to_ms))
+    {
+        return;
+    }
+
+    struct mg_str* range_header = mg_get_http_header(hm, "Range");
+    std::string range = range_header ? std::string(range_header->p, range_header->len) : std::string();
 
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    // the time is searched through the file, do it off the poll thread
+    if (!_executor.SubmitResponse(Service_Pool_Service, nc, [this, log_file, range, from_ms, to_ms]() { return read_log_range(log_file, range, from_ms, to_ms); }))
+    {
+        mg_http_send_error(nc, 503, Service_Busy_Text);
+    }
 }
 
-void HttpService::handle_service_create(struct mg_connection *nc, struct http_message *hm)
+// GET ?name=<service>&text=<text>[&file=<log>][&from=...][&to=...][&max=<lines>] with an optional Range: bytes=...,
+// the lines with the text as text/plain, those of the time only, a plain log is searched within the bytes of the time
+// through its index, a compressed one is read through, X-Log-Next is the offset to search on from by a range once
+// the lines returned are max or too many bytes
+void HttpService::handle_service_log_grep(struct mg_connection *nc, struct http_message *hm)
+{
+    std::string log_file;
+    int from_ms = -1, to_ms = -1;
+    if (!parse_log_request(nc, hm, true, log_file, from_ms, to_ms))
+    {
+        return;
+    }
+
+    char text[256] = { 0 }, max[16] = { 0 };
+    if (mg_get_http_var(&hm->query_string, "text", text, sizeof(text)) <= 0)
+    {
+        mg_http_send_error(nc, 400, "Text is not provided");
+        return;
+    }
+    mg_get_http_var(&hm->query_string, "max", max, sizeof(max));
+
+    int max_lines = max[0] ? atoi(max) : Service_Log_Grep_Lines;
+    max_lines = max_lines <= 0 ? Service_Log_Grep_Lines : std::min(max_lines, Service_Log_Grep_Lines_Max);
+
+    struct mg_str* range_header = mg_get_http_header(hm, "Range");
+    std::string range = range_header ? std::string(range_header->p, range_header->len) : std::string();
+
+    // the file is read through, do it off the poll thread
+    std::string grep_text(text);
+    if (!_executor.SubmitResponse(Service_Pool_Service, nc, [this, log_file, range, grep_text, from_ms, to_ms, max_lines]() { return grep_log(log_file, range, grep_text, from_ms, to_ms, max_lines); }))
+    {
+        mg_http_send_error(nc, 503, Service_Busy_Text);
+    }
+}
+
+// the websocket of /service/log/tail?name=<service>, the lines appended to the log being written are sent as text frames
+void HttpService::handle_service_log_tail(struct mg_connection *nc, struct http_message *hm)
 {
-    char stype[32] = { 0 }, index[128] = { 0 };
     char name[128] = { 0 };
-    char option[512] = { 0 };
-    
-    std::vector<char> configuration(20 << 4);
-    /* Get form variables */
-    mg_get_http_var(&hm->body, "type", stype, sizeof(stype));
-    mg_get_http_var(&hm->body, "index", index, sizeof(index));
-    mg_get_http_var(&hm->body, "name", name, sizeof(name));
-    mg_get_http_var(&hm->body, "option", option, sizeof(option));
-    mg_get_http_var(&hm->body, "configuration", configuration.data(), configuration.size());
-    
-    rapidjson::Document doc(rapidjson::kObjectType);
-    rapidjson::Value code(rapidjson::kNumberType);
-    rapidjson::Value res(rapidjson::kStringType);
+    mg_get_http_var(&hm->query_string, "name", name, sizeof(name));
 
-    do 
+    const Service_t* found = find_service_instance(name);
+    if (!found)
     {
-        std::stringstream ss;
+        mg_http_send_error(nc, 404, "Service does not exist");
+        return;
+    }
 
-        if (strcmp(stype, "definition") != 0)
+    std::shared_ptr<LogTail_t> tail = std::make_shared<LogTail_t>();
+    tail->name = found->name;
+    tail->file = GetLogFile(_root, found->name, found->log.name, found->log.type, found->supervise);
+    _log_tails[nc] = tail;
+
+    // the file is read by the service pool from the first tick on
+    mg_set_timer(nc, mg_time() + Service_Log_Tail_Interval);
+}
+
+void HttpService::handle_service_log_tail_timer(struct mg_connection *nc)
+{
+    std::unordered_map<struct mg_connection*, std::shared_ptr<LogTail_t>>::iterator found_tail = _log_tails.find(nc);
+    if (found_tail == _log_tails.end())
+    {
+        return;
+    }
+    std::shared_ptr<LogTail_t> tail = found_tail->second;
+
+    const Service_t* found = find_service_instance(tail->name);
+    if (!found)
+    {
+        mg_send_websocket_frame(nc, WEBSOCKET_OP_CLOSE, nullptr, 0);
+        nc->flags |= MG_F_SEND_AND_CLOSE;
+        return;
+    }
+    mg_set_timer(nc, mg_time() + Service_Log_Tail_Interval);
+
+    // a reader which can not keep up is sent nothing more until it takes what is queued,
+    // and the tail is read once at a time, the pool owns it until the read is sent
+    if (nc->send_mbuf.len > Service_Log_Tail_Queued || _executor.Pending(nc))
+    {
+        return;
+    }
+
+    // a busy pool skips the tick, the lines are read by a later one
+    std::string log_file = GetLogFile(_root, found->name, found->log.name, found->log.type, found->supervise);
+    _executor.SubmitFrame(Service_Pool_Service, nc, [this, tail, log_file]() { return read_log_tail(tail, log_file); });
+}
+
+std::string HttpService::read_log_tail(const std::shared_ptr<LogTail_t>& tail, const std::string& log_file)
+{
+    // a daily log is followed to the file of the next day from its start
+    if (log_file != tail->file)
+    {
+        tail->file = log_file;
+        tail->offset = 0;
+        tail->aligned = true;
+        tail->started = true;
+    }
+
+    LogFile log;
+    if (!log.Open(tail->file))
+    {
+        return std::string();
+    }
+
+    unsigned long long size = log.Size();
+    if (!tail->started)
+    {
+        tail->offset = size > Service_Log_Tail_Backlog ? size - Service_Log_Tail_Backlog : 0;
+        tail->aligned = 0 == tail->offset;
+        tail->started = true;
+    }
+
+    // a rotated log is followed to the new file from its start
+    if (size < tail->offset)
+    {
+        tail->offset = 0;
+        tail->aligned = true;
+    }
+    if (size == tail->offset)
+    {
+        return std::string();
+    }
+
+    size_t span = (size_t)std::min<unsigned long long>(size - tail->offset, Service_Log_Tail_Read);
+    const char* data = log.Map(tail->offset, span);
+    if (nullptr == data)
+    {
+        return std::string();
+    }
+
+    const char* begin = data;
+    if (!tail->aligned)
+    {
+        const char* line_end = (const char*)memchr(data, '\n', span);
+        if (nullptr == line_end)
         {
-            ss << "Service operation target(" << stype << ") is not recognized";
-            res.SetString(ss.str().c_str(), doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-            break;
+            tail->offset += span;
+            return std::string();
         }
+        begin = line_end + 1;
+        tail->aligned = true;
+    }
 
-        // find service definition
-        Service_t serv;
-        for (const Service_t& servd : _service_definitions)
+    // complete lines only, unless a line is longer than a read
+    const char* end = data + span;
+    while (end > begin && '\n' != end[-1])
+    {
+        --end;
+    }
+    if (end == begin && span == Service_Log_Tail_Read)
+    {
+        end = data + span;
+    }
+
+    tail->offset += (unsigned long long)(std::max(end, begin) - data);
+    return end > begin ? std::string(begin, end) : std::string();
+}
+
+// GET, a text/event-stream of the services, a snapshot event of the services as /service/list returns them first, then
+//   status      {"name", "status_code", "status_txt"} once the status of a service changes
+//   created     the service as in the snapshot once it is created, changed once its options are set
+//   deleted     {"name"} once it is deleted
+//   upgrade     {"step"} as an upgrade goes on, extract, stop, upgrade and start, {"step": "done", "code", "result"} at last
+void HttpService::handle_service_events(struct mg_connection *nc, struct http_message *hm)
+{
+    // the connection is kept open, the events to come are sent by publish_event
+    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n");
+    mg_printf(nc, "id: %llu\nevent: snapshot\ndata: ", _events_id);
+    {
+        // a Writer puts no line breaks, so the json is the data of the event as it is
+        JsonArena arena;
+        JsonResponse response(nc);
+        rapidjson::Writer<JsonResponse> writer(response);
+
+        ServiceStatusSnapshot statuses = _status_cache->Snapshot();
+        writer.StartObject();
+        writer.Key("services");
+        writer.StartArray();
+        for (const Service_t& serv : _service_instances)
         {
-            if (servd.id == index)
-            {
-                serv = servd;
-                break;
-            }
+            write_service_json(writer, serv, statuses, arena.Allocator());
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    mg_send(nc, "\n\n", 2);
+
+    nc->flags |= Service_Events_Flag;
+}
+
+void HttpService::handle_executor_stats(struct mg_connection *nc, struct http_message *hm)
+{
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value pools(rapidjson::kArrayType);
+
+    for (const WorkerPoolStats_t& stats : _executor.Stats())
+    {
+        rapidjson::Value pool(rapidjson::kObjectType);
+        pool.AddMember("name", rapidjson::Value(stats.name.c_str(), doc.GetAllocator()), doc.GetAllocator());
+        pool.AddMember("threads", (uint64_t)stats.threads, doc.GetAllocator());
+        pool.AddMember("capacity", (uint64_t)stats.capacity, doc.GetAllocator());
+        pool.AddMember("queued", (uint64_t)stats.queued, doc.GetAllocator());
+        pool.AddMember("queued_max", (uint64_t)stats.queued_max, doc.GetAllocator());
+        pool.AddMember("running", (uint64_t)stats.running, doc.GetAllocator());
+        pool.AddMember("submitted", (uint64_t)stats.submitted, doc.GetAllocator());
+        pool.AddMember("rejected", (uint64_t)stats.rejected, doc.GetAllocator());
+        pool.AddMember("completed", (uint64_t)stats.completed, doc.GetAllocator());
+        pool.AddMember("wait_total_us", (uint64_t)stats.wait_total, doc.GetAllocator());
+        pool.AddMember("wait_max_us", (uint64_t)stats.wait_max, doc.GetAllocator());
+        pool.AddMember("exec_total_us", (uint64_t)stats.exec_total, doc.GetAllocator());
+        pool.AddMember("exec_max_us", (uint64_t)stats.exec_max, doc.GetAllocator());
+
+        pools.PushBack(pool, doc.GetAllocator());
+    }
+
+    doc.AddMember("code", Service_Module_Success, doc.GetAllocator());
+    doc.AddMember("pools", pools, doc.GetAllocator());
+    doc.AddMember("abandoned", (uint64_t)_executor.Abandoned(), doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+void HttpService::handle_route_stats(struct mg_connection *nc, struct http_message *hm)
+{
+    JsonArena arena;
+    rapidjson::Document doc(rapidjson::kObjectType, &arena.Allocator());
+    rapidjson::Value routes(rapidjson::kArrayType);
+
+    for (size_t i = 0; i < _route_stats.size(); ++i)
+    {
+        const RouteStats_t& stats = _route_stats[i];
+        bool routed = i < HttpRouteTable::Count;
+
+        rapidjson::Value route(rapidjson::kObjectType);
+        route.AddMember("method", rapidjson::StringRef(routed ? HttpRoutes::table[i].method : "*"), doc.GetAllocator());
+        route.AddMember("path", rapidjson::StringRef(routed ? HttpRoutes::table[i].path : "*"), doc.GetAllocator());
+        route.AddMember("requests", (uint64_t)stats.requests, doc.GetAllocator());
+        route.AddMember("total_us", (uint64_t)stats.total_us, doc.GetAllocator());
+        route.AddMember("max_us", (uint64_t)stats.max_us, doc.GetAllocator());
+
+        routes.PushBack(route, doc.GetAllocator());
+    }
+
+    doc.AddMember("code", Service_Module_Success, doc.GetAllocator());
+    doc.AddMember("routes", routes, doc.GetAllocator());
+
+    JsonResponse response(nc, "HTTP/1.1 200 OK\r\n");
+    rapidjson::Writer<JsonResponse> writer(response);
+    doc.Accept(writer);
+}
+
+void HttpService::handle_request(struct mg_connection *nc, struct http_message *hm)
+{
+    std::string params;
+    int route = HttpRouteTable::Find(hm->method.p, hm->method.len, hm->uri.p, hm->uri.len, params);
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    if (route < 0)
+    {
+        handle_html(nc, hm);
+    }
+    else if (params.empty())
+    {
+        (this->*HttpRoutes::table[route].handler)(nc, hm); /* Handle RESTful call */
+    }
+    else
+    {
+        // the {name} segments are read as form variables of the query and the body, before those sent
+        std::string query = params;
+        std::string body = params;
+        if (hm->query_string.len > 0)
+        {
+            query.append(hm->query_string.p, hm->query_string.len);
         }
-        if (serv.id.empty())
+        if (hm->body.len > 0)
         {
-            ss << "Service definition(" << index << ") does not exist";
-            res.SetString(ss.str().c_str(), doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-            break;
+            body.append(hm->body.p, hm->body.len);
         }
-        
-        bool existed = false;
-        // find existed service
-        for (const Service_t& servs : _service_instances)
+
+        struct http_message routed = *hm;
+        routed.query_string = mg_mk_str_n(query.data(), query.size());
+        routed.body = mg_mk_str_n(body.data(), body.size());
+        (this->*HttpRoutes::table[route].handler)(nc, &routed); /* Handle RESTful call */
+    }
+    unsigned long long elapsed = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+
+    RouteStats_t& stats = _route_stats[route < 0 ? HttpRouteTable::Count : (size_t)route];
+    ++stats.requests;
+    stats.total_us += elapsed;
+    stats.max_us = std::max(stats.max_us, elapsed);
+}
+
+void HttpService::handle_html(struct mg_connection *nc, struct http_message *hm)
+{
+    if (mg_vcmp(&hm->uri, "/") == 0)
+    {
+        mg_http_send_redirect(nc, 302, mg_mk_str("/index.html"), mg_mk_str(NULL));
+    }
+    else if (!serve_static(nc, hm))
+    {
+        if (_directory.empty())
         {
-            if (servs.name == name)
-            {
-                ss << "Service(" << name << ") has already exist";
-                res.SetString(ss.str().c_str(), doc.GetAllocator());
-                code.SetInt(Service_Module_Failed);
-                existed = true;
-                break;
-            }
+            mg_http_send_error(nc, 404, nullptr); /* Nothing but the packed web ui */
         }
-        if (existed)
+        else
         {
-            break;
+            mg_serve_http(nc, hm, _opts); /* Serve static content */
         }
-        serv.name = name;
+    }
+}
 
-        if (!parse_option(serv, option, res, doc.GetAllocator()))
+bool HttpService::serve_static(struct mg_connection *nc, struct http_message *hm)
+{
+    bool head = mg_vcmp(&hm->method, "HEAD") == 0;
+    if (!head && mg_vcmp(&hm->method, "GET") != 0)
+    {
+        return false;
+    }
+
+    char uri[1024] = { 0 };
+    int uri_size = mg_url_decode(hm->uri.p, (int)hm->uri.len, uri, sizeof(uri), 0);
+    if (uri_size <= 0)
+    {
+        return false;
+    }
+
+    std::string path(uri, uri_size);
+    if ('/' == path.back())
+    {
+        path += "index.html";
+    }
+
+    // the snapshot keeps the asset of the cache while it is sent, the packed ones are constant
+    StaticAssetsSnapshot assets;
+    StaticContent_t content;
+    if (_static_cache)
+    {
+        assets = _static_cache->Snapshot();
+        StaticAssetMap_t::const_iterator found = assets->assets.find(path);
+        if (assets->assets.end() == found)
         {
-            break;
+            return false;
         }
-
-        if (!create_service_configuration(serv, configuration, res, doc.GetAllocator()))
+        StaticAssetCache::View(found->second, content);
+    }
+    else
+    {
+        const EmbeddedAsset_t* embedded = EmbeddedAssets::Find(path);
+        if (nullptr == embedded)
         {
-            break;
+            return false;
         }
+        EmbeddedAssets::View(*embedded, content);
+    }
+
+    // zstd is smaller than gzip at the levels encoded with
+    static const char* encodings[Static_Encodings] = { "", "Content-Encoding: gzip\r\n", "Content-Encoding: zstd\r\n" };
+    struct mg_str* accept_encoding = mg_get_http_header(hm, "Accept-Encoding");
+    int encoding = Static_Identity;
+    if (content.data[Static_Zstd] && AcceptsEncoding(accept_encoding, "zstd"))
+    {
+        encoding = Static_Zstd;
+    }
+    else if (content.data[Static_Gzip] && AcceptsEncoding(accept_encoding, "gzip"))
+    {
+        encoding = Static_Gzip;
+    }
+
+    const char* etag = content.etag[encoding];
+    if (MatchesETag(mg_get_http_header(hm, "If-None-Match"), etag))
+    {
+        mg_printf(nc, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: %s\r\nVary: Accept-Encoding\r\nContent-Length: 0\r\n\r\n", etag, content.cache_control);
+        return true;
+    }
 
+    mg_printf(nc, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %llu\r\nETag: %s\r\nCache-Control: %s\r\nVary: Accept-Encoding\r\n%s\r\n",
+        content.content_type, (unsigned long long)content.size[encoding], etag, content.cache_control, encodings[encoding]);
+    if (!head)
+    {
+        mg_send(nc, content.data[encoding], (int)content.size[encoding]);
+    }
+    return true;
+}
+
+std::string HttpService::control_service(const std::string& action, const std::string& name)
+{
+    rapidjson::Document doc(rapidjson::kObjectType);
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
+
+    do
+    {
         SC_HANDLE schSCManager = OpenSCManager(
             NULL,                    // local computer
             NULL,                    // ServicesActive database 
@@ -1416,56 +2337,59 @@ void HttpService::handle_service_create(struct mg_connection *nc, struct http_me
             break;
         }
 
-        std::vector<char> binary(1024);
-        snprintf(binary.data(), binary.size(), "%sServiceLoader.exe %s", _root.c_str(), make_option(serv, true).c_str());
-        SC_HANDLE schService = CreateService(
+        SC_HANDLE schService = OpenService(
             schSCManager,              // SCM database 
-            name,                      // name of service 
-            name,                      // service name to display 
-            SERVICE_ALL_ACCESS,        // desired access 
-            SERVICE_WIN32_OWN_PROCESS, // service type 
-            SERVICE_AUTO_START,        // start type 
-            SERVICE_ERROR_NORMAL,      // error control type 
-            binary.data(),             // path to service's binary 
-            NULL,                      // no load ordering group 
-            NULL,                      // no tag identifier 
-            NULL,                      // no dependencies 
-            NULL,                      // LocalSystem account 
-            NULL);                     // no password 
+            name.c_str(),           // name of service 
+            SERVICE_ALL_ACCESS);        // desired access
 
         if (schService == NULL)
         {
+            code.SetInt(Service_Module_Failed);
             GetLastErrorString(res, doc.GetAllocator());
 
             CloseServiceHandle(schSCManager);
-            code.SetInt(Service_Module_Failed);
             break;
         }
 
-        SERVICE_DESCRIPTION desc;
-        desc.lpDescription = (char*)serv.description.c_str();
-        if (!ChangeServiceConfig2(schService, SERVICE_CONFIG_DESCRIPTION, &desc))
+        if (action == "Start")
         {
-            GetLastErrorString(res, doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-
-            // delete service
-            DeleteService(schService);
-
-            CloseServiceHandle(schService);
-            CloseServiceHandle(schSCManager);
-            break;
+            if (!StartService(
+                schService,
+                0,
+                NULL))
+            {
+                code.SetInt(Service_Module_Failed);
+                GetLastErrorString(res, doc.GetAllocator());
+            }
+            else
+            {
+                code.SetInt(Service_Module_Success);
+                res.SetString("success", doc.GetAllocator());
+            }
+        } 
+        else
+        {
+            // the loader reloads the replaced service libraries in place on Service_Control_Reload
+            SERVICE_STATUS_PROCESS ssp;
+            if (!ControlService(
+                schService,
+                action == "Reload" ? Service_Control_Reload : SERVICE_CONTROL_STOP,
+                (LPSERVICE_STATUS)&ssp))
+            {
+                code.SetInt(Service_Module_Failed);
+                GetLastErrorString(res, doc.GetAllocator());
+            }
+            else
+            {
+                code.SetInt(Service_Module_Success);
+                res.SetString("success", doc.GetAllocator());
+            }
         }
 
         CloseServiceHandle(schService);
         CloseServiceHandle(schSCManager);
 
-        code.SetInt(Service_Module_Success);
-        res.SetString("success", doc.GetAllocator());
-
-        _service_instances.push_back(serv);
-
-        fresh_services_json(_service_instances, _services_path);
+        _status_cache->Invalidate(name);
     } while (false);
 
     doc.AddMember("code", code, doc.GetAllocator());
@@ -1475,130 +2399,139 @@ void HttpService::handle_service_create(struct mg_connection *nc, struct http_me
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
     doc.Accept(writer);
 
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    return buffer.GetString();
 }
 
-void HttpService::handle_service_delete(struct mg_connection *nc, struct http_message *hm)
+std::string HttpService::dump_flight_recorder(const std::string& name, const std::string& flight_file, bool running)
 {
-    char name[128] = { 0 };
-    mg_get_http_var(&hm->body, "name", name, sizeof(name));
-
     rapidjson::Document doc(rapidjson::kObjectType);
     rapidjson::Value code(rapidjson::kNumberType);
     rapidjson::Value res(rapidjson::kStringType);
 
     do
     {
-        bool found = false;
-        for (const Service_t& servs : _service_instances)
+        if (running)
         {
-            if (servs.name == name)
+            unsigned long long last_write = GetFileWriteTime(flight_file);
+
+            SC_HANDLE schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_CONNECT);
+            if (NULL == schSCManager)
+            {
+                code.SetInt(Service_Module_Failed);
+                GetLastErrorString(res, doc.GetAllocator());
+                break;
+            }
+
+            SC_HANDLE schService = OpenService(schSCManager, name.c_str(), SERVICE_USER_DEFINED_CONTROL);
+            if (NULL == schService)
+            {
+                code.SetInt(Service_Module_Failed);
+                GetLastErrorString(res, doc.GetAllocator());
+
+                CloseServiceHandle(schSCManager);
+                break;
+            }
+
+            // the loader dumps on Service_Control_Flight, the file is replaced once written
+            SERVICE_STATUS status;
+            BOOL controlled = ControlService(schService, Service_Control_Flight, &status);
+            if (!controlled)
+            {
+                code.SetInt(Service_Module_Failed);
+                GetLastErrorString(res, doc.GetAllocator());
+            }
+
+            CloseServiceHandle(schService);
+            CloseServiceHandle(schSCManager);
+
+            if (!controlled)
             {
-                found = true;
                 break;
             }
+
+            for (int waited = 0; waited < Service_Flight_Timeout && GetFileWriteTime(flight_file) == last_write; waited += 100)
+            {
+                Sleep(100);
+            }
         }
 
-        std::stringstream ss;
-        if (!found)
+        FILE* in = fopen(flight_file.c_str(), "rb");
+        if (NULL == in)
         {
-            ss << "Service(" << name << ") does not exist";
-            res.SetString(ss.str().c_str(), doc.GetAllocator());
             code.SetInt(Service_Module_Failed);
+            res.SetString(("Service(" + name + ") has no flight recorder dump").c_str(), doc.GetAllocator());
             break;
         }
 
-        SC_HANDLE schSCManager = OpenSCManager(
-            NULL,                    // local computer
-            NULL,                    // ServicesActive database 
-            SC_MANAGER_ALL_ACCESS);  // full access rights 
-        if (NULL == schSCManager)
+        FILE* out = tmpfile();
+        if (NULL == out)
         {
+            fclose(in);
             code.SetInt(Service_Module_Failed);
-            GetLastErrorString(res, doc.GetAllocator());
+            GetErrorString(ERROR_CANNOT_MAKE, res, doc.GetAllocator());
             break;
         }
 
-        SC_HANDLE schService = OpenService(
-            schSCManager,              // SCM database 
-            name,                      // name of service 
-            SERVICE_ALL_ACCESS);       // desired access
-
-        if (schService == NULL)
+        // a dump cut short by the crash is rendered as far as it goes
+        if (!spdlog::decode_binary_log(in, out))
         {
-            GetLastErrorString(res, doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-
-            CloseServiceHandle(schSCManager);
-            break;
+            _logger->warn("flight recorder dump({}) of service({}) is broken", flight_file.c_str(), name.c_str());
         }
+        fclose(in);
 
-        SERVICE_STATUS_PROCESS ssStatus;
-        DWORD dwBytesNeeded;
-        if (!QueryServiceStatusEx(
-            schService,                     // handle to service 
-            SC_STATUS_PROCESS_INFO,         // information level
-            (LPBYTE)&ssStatus,             // address of structure
-            sizeof(SERVICE_STATUS_PROCESS), // size of structure
-            &dwBytesNeeded))              // size needed if buffer is too small
+        std::string text;
+        char chunk[4096];
+        size_t read = 0;
+        rewind(out);
+        while ((read = fread(chunk, 1, sizeof(chunk), out)) > 0)
         {
-            GetLastErrorString(res, doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-
-            CloseServiceHandle(schService);
-            CloseServiceHandle(schSCManager);
-            break;
+            text.append(chunk, read);
         }
+        fclose(out);
 
-        if (ssStatus.dwCurrentState != SERVICE_STOPPED)
+        code.SetInt(Service_Module_Success);
+        res.SetString(text.c_str(), (rapidjson::SizeType)text.size(), doc.GetAllocator());
+    } while (false);
+
+    doc.AddMember("code", code, doc.GetAllocator());
+    doc.AddMember("result", res, doc.GetAllocator());
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    return buffer.GetString();
+}
+
+std::string HttpService::read_supervisor_status(const std::string& name, const std::string& status_file)
+{
+    rapidjson::Document doc(rapidjson::kObjectType);
+    rapidjson::Value code(rapidjson::kNumberType);
+    rapidjson::Value res(rapidjson::kStringType);
+
+    do
+    {
+        std::ifstream ifs(status_file);
+        if (!ifs.is_open())
         {
-            ss << "Service state(" << Service_Status_Name[ssStatus.dwCurrentState] << ") is not stopped";
-            res.SetString(ss.str().c_str(), doc.GetAllocator());
             code.SetInt(Service_Module_Failed);
-
-            CloseServiceHandle(schService);
-            CloseServiceHandle(schSCManager);
+            res.SetString(("Service(" + name + ") is not supervised").c_str(), doc.GetAllocator());
             break;
         }
 
-        if (!DeleteService(schService))
+        std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+        rapidjson::Document status_doc(&doc.GetAllocator());
+        status_doc.Parse(content.c_str());
+        if (!status_doc.IsObject())
         {
             code.SetInt(Service_Module_Failed);
-            GetLastErrorString(res, doc.GetAllocator());
-        } 
-        else
-        {
-            code.SetInt(Service_Module_Success);
-            res.SetString("success", doc.GetAllocator());
-
-            std::string lame = name;
-            _service_instances.erase(std::remove_if(_service_instances.begin(), _service_instances.end(), [&lame, this](const Service_t& el) 
-            { 
-                if (el.name == lame)
-                {
-                    if (!el.library.config.empty())
-                    {
-                        std::string config_path = _root + "conf\\" + el.library.config;
-                        if (_access(config_path.c_str(), 00) == 0)
-                        {
-                            if (remove(config_path.c_str()) != 0)
-                            {
-                                _logger->warn("delete service({}) configuration file({}) failed: {}", el.name.c_str(), el.library.config.c_str(), GetLastErrorString().c_str());
-                            }
-                        }
-                    }
-                    return true;
-                }
-                return false;
-            }));
-            fresh_services_json(_service_instances, _services_path);
+            res.SetString(("Service(" + name + ") supervisor status is invalid").c_str(), doc.GetAllocator());
+            break;
         }
 
-        CloseServiceHandle(schService);
-        CloseServiceHandle(schSCManager);
+        code.SetInt(Service_Module_Success);
+        res.Swap(status_doc);
     } while (false);
 
     doc.AddMember("code", code, doc.GetAllocator());
@@ -1608,121 +2541,241 @@ void HttpService::handle_service_delete(struct mg_connection *nc, struct http_me
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
     doc.Accept(writer);
 
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    return buffer.GetString();
+}
+
+std::string HttpService::read_log_range(const std::string& log_file, const std::string& range, int from_ms, int to_ms)
+{
+    LogFile log;
+    if (!log.Open(log_file))
+    {
+        return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    unsigned long long size = log.Size();
+    unsigned long long begin = 0, end = size;
+    bool partial = !range.empty() || from_ms >= 0 || to_ms >= 0;
+
+    if (!range.empty() && !ParseByteRange(range, size, begin, end))
+    {
+        std::stringstream ss;
+        ss << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" << size << "\r\nContent-Length: 0\r\n\r\n";
+        return ss.str();
+    }
+
+    // the lines of the time within the bytes, the time of the lines goes up through a file
+    if (from_ms >= 0)
+    {
+        begin = std::max(begin, find_log_time(log, log_file, (unsigned int)from_ms, size));
+    }
+    if (to_ms >= 0)
+    {
+        end = std::min(end, find_log_time(log, log_file, (unsigned int)to_ms, size));
+    }
+    end = std::max(begin, std::min(end, begin + Service_Log_Range_Max));
+    partial = partial || end < size;
+
+    const char* data = log.Map(begin, (size_t)(end - begin));
+    if (end > begin && nullptr == data)
+    {
+        return "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+    }
+
+    std::stringstream ss;
+    ss << (partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n");
+    ss << "Content-Type: text/plain\r\nAccept-Ranges: bytes\r\n";
+    if (partial && end > begin)
+    {
+        ss << "Content-Range: bytes " << begin << "-" << (end - 1) << "/" << size << "\r\n";
+    }
+    ss << "Content-Length: " << (end - begin) << "\r\n\r\n";
+
+    std::string response = ss.str();
+    response.append(data ? data : "", (size_t)(end - begin));
+    return response;
 }
 
-void HttpService::handle_service_control(struct mg_connection *nc, struct http_message *hm)
+std::string HttpService::grep_log(const std::string& log_file, const std::string& range, const std::string& text, int from_ms, int to_ms, int max_lines)
 {
-    char action[128] = { 0 }, name[128] = { 0 };
+    std::string lines;
+    int matched = 0;
+    unsigned long long next = 0;
 
-    mg_get_http_var(&hm->body, "action", action, sizeof(action));
-    mg_get_http_var(&hm->body, "name", name, sizeof(name));
+    if (IsArchivedLog(log_file))
+    {
+        // a compressed log has no index and is read through, the lines without a time take the one of the line before
+        std::string rest;
+        int line_ms = -1;
+        bool read = LogArchiver::ReadLog(log_file, [&](const char* data, size_t size) {
+            rest.append(data, size);
 
-    rapidjson::Document doc(rapidjson::kObjectType);
-    rapidjson::Value code(rapidjson::kNumberType);
-    rapidjson::Value res(rapidjson::kStringType);
+            size_t pos = 0;
+            for (size_t line_end = rest.find('\n'); std::string::npos != line_end; line_end = rest.find('\n', pos))
+            {
+                const char* line = rest.data() + pos;
+                size_t line_size = line_end + 1 - pos;
+                pos = line_end + 1;
 
-    do
+                unsigned int time_ms = 0;
+                if (LogFile::ParseTime(line, line_size, time_ms))
+                {
+                    line_ms = (int)time_ms;
+                }
+                if (to_ms >= 0 && line_ms >= to_ms)
+                {
+                    return false;
+                }
+                if ((from_ms >= 0 && line_ms < from_ms) || nullptr == LogFile::Find(line, line_size, text))
+                {
+                    continue;
+                }
+
+                lines.append(line, line_size);
+                if (++matched >= max_lines || lines.size() >= Service_Log_Range_Max)
+                {
+                    return false;
+                }
+            }
+            rest.erase(0, pos);
+            return true;
+        });
+
+        if (!read && 0 == matched)
+        {
+            return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        }
+    }
+    else
     {
-        bool found = false;
-        for (const Service_t& servs : _service_instances)
+        LogFile log;
+        if (!log.Open(log_file))
         {
-            if (servs.name == name)
-            {
-                found = true;
-                break;
-            }
+            return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
         }
 
-        std::stringstream ss;
-        if (!found)
+        unsigned long long size = log.Size();
+        unsigned long long begin = 0, end = size;
+        if (!range.empty() && !ParseByteRange(range, size, begin, end))
         {
-            ss << "Service(" << name << ") does not exist";
-            res.SetString(ss.str().c_str(), doc.GetAllocator());
-            code.SetInt(Service_Module_Failed);
-            break;
+            std::stringstream ss;
+            ss << "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" << size << "\r\nContent-Length: 0\r\n\r\n";
+            return ss.str();
         }
 
-        SC_HANDLE schSCManager = OpenSCManager(
-            NULL,                    // local computer
-            NULL,                    // ServicesActive database 
-            SC_MANAGER_ALL_ACCESS);  // full access rights 
-        if (NULL == schSCManager)
+        if (from_ms >= 0)
         {
-            code.SetInt(Service_Module_Failed);
-            GetLastErrorString(res, doc.GetAllocator());
-            break;
+            begin = std::max(begin, find_log_time(log, log_file, (unsigned int)from_ms, size));
         }
-
-        SC_HANDLE schService = OpenService(
-            schSCManager,              // SCM database 
-            name,                   // name of service 
-            SERVICE_ALL_ACCESS);        // desired access
-
-        if (schService == NULL)
+        if (to_ms >= 0)
         {
-            code.SetInt(Service_Module_Failed);
-            GetLastErrorString(res, doc.GetAllocator());
+            end = std::min(end, find_log_time(log, log_file, (unsigned int)to_ms, size));
+        }
 
-            CloseServiceHandle(schSCManager);
-            break;
+        // a range may start within a line, which is skipped to the next one
+        if (begin > 0 && begin < end)
+        {
+            const char* before = log.Map(begin - 1, 1);
+            if (before && '\n' != *before)
+            {
+                size_t span = (size_t)std::min<unsigned long long>(Service_Log_Grep_Chunk, end - begin);
+                const char* data = log.Map(begin, span);
+                const char* line_end = data ? (const char*)memchr(data, '\n', span) : nullptr;
+                begin = line_end ? begin + (unsigned long long)(line_end - data) + 1 : end;
+            }
         }
 
-        if (strcmp(action, "Start") == 0)
+        // the chunks end with a line, the text is searched through a chunk at once and a hit is widened to its line
+        while (begin < end)
         {
-            if (!StartService(
-                schService,
-                0,
-                NULL))
+            size_t span = (size_t)std::min<unsigned long long>(Service_Log_Grep_Chunk, end - begin);
+            const char* data = log.Map(begin, span);
+            if (nullptr == data)
             {
-                code.SetInt(Service_Module_Failed);
-                GetLastErrorString(res, doc.GetAllocator());
+                break;
             }
-            else
+
+            const char* chunk_end = data + span;
+            if (begin + span < end)
             {
-                code.SetInt(Service_Module_Success);
-                res.SetString("success", doc.GetAllocator());
+                while (chunk_end > data && '\n' != chunk_end[-1])
+                {
+                    --chunk_end;
+                }
+                chunk_end = chunk_end == data ? data + span : chunk_end;
             }
-        } 
-        else
-        {
-            SERVICE_STATUS_PROCESS ssp;
-            if (!ControlService(
-                schService,
-                SERVICE_CONTROL_STOP,
-                (LPSERVICE_STATUS)&ssp))
+
+            const char* pos = data;
+            const char* hit = nullptr;
+            while (pos < chunk_end && nullptr != (hit = LogFile::Find(pos, (size_t)(chunk_end - pos), text)))
             {
-                code.SetInt(Service_Module_Failed);
-                GetLastErrorString(res, doc.GetAllocator());
+                const char* line = hit;
+                while (line > pos && '\n' != line[-1])
+                {
+                    --line;
+                }
+                const char* line_end = (const char*)memchr(hit, '\n', (size_t)(chunk_end - hit));
+                line_end = line_end ? line_end + 1 : chunk_end;
+
+                lines.append(line, (size_t)(line_end - line));
+                pos = line_end;
+
+                if (++matched >= max_lines || lines.size() >= Service_Log_Range_Max)
+                {
+                    break;
+                }
             }
-            else
+
+            begin += (unsigned long long)(pos - data);
+            if (matched >= max_lines || lines.size() >= Service_Log_Range_Max)
             {
-                code.SetInt(Service_Module_Success);
-                res.SetString("success", doc.GetAllocator());
+                next = begin < end ? begin : 0;
+                break;
             }
+            begin += (unsigned long long)(chunk_end - pos);
         }
+    }
 
-        CloseServiceHandle(schService);
-        CloseServiceHandle(schSCManager);
-    } while (false);
+    std::stringstream ss;
+    ss << "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n";
+    if (next > 0)
+    {
+        ss << "X-Log-Next: " << next << "\r\n";
+    }
+    ss << "Content-Length: " << lines.size() << "\r\n\r\n";
+    return ss.str() + lines;
+}
 
-    doc.AddMember("code", code, doc.GetAllocator());
-    doc.AddMember("result", res, doc.GetAllocator());
+unsigned long long HttpService::find_log_time(LogFile& log, const std::string& log_file, unsigned int time_ms, unsigned long long size)
+{
+    std::shared_ptr<LogIndex> index;
+    {
+        std::lock_guard<std::mutex> guard(_log_indexes_lock);
+        std::unordered_map<std::string, std::shared_ptr<LogIndex>>::iterator found = _log_indexes.find(log_file);
+        if (found == _log_indexes.end())
+        {
+            // the logs of the days passed are searched seldom, their indexes are taken up from the files again
+            if (_log_indexes.size() >= Service_Log_Indexes_Max)
+            {
+                _log_indexes.clear();
+            }
+            found = _log_indexes.emplace(log_file, std::make_shared<LogIndex>(log_file)).first;
+        }
+        index = found->second;
+    }
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
+    // the index reaches as far as the log is written, a time is searched within the bytes of two entries then,
+    // an index which is not saved is used all the same
+    if (!index->Update(log))
+    {
+        _logger->warn("save log index of {} failed", log_file.c_str());
+    }
 
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    unsigned long long low = 0, high = size;
+    index->Window(time_ms, size, low, high);
+    return log.FindTime(time_ms, low, high);
 }
 
-void HttpService::handle_service_upgrade(struct mg_connection *nc, struct http_message *hm)
+std::string HttpService::upgrade_services()
 {
     rapidjson::Document doc(rapidjson::kObjectType);
     rapidjson::Value code(rapidjson::kNumberType);
@@ -1737,14 +2790,26 @@ void HttpService::handle_service_upgrade(struct mg_connection *nc, struct http_m
             break;
         }
 
+        queue_event("upgrade", GetUpgradeEvent("extract"));
         if (!extract_package(code, res, doc.GetAllocator()))
         {
             break;
         }
 
-        if (!stop_dependent_services(related_definitions, code, res, doc.GetAllocator()) ||
-            !upgrade_service_with_package(package_path_name, code, res, doc.GetAllocator()) ||
-            !start_dependent_services(related_definitions, code, res, doc.GetAllocator()))
+        queue_event("upgrade", GetUpgradeEvent("stop"));
+        if (!stop_dependent_services(related_definitions, code, res, doc.GetAllocator()))
+        {
+            break;
+        }
+
+        queue_event("upgrade", GetUpgradeEvent("upgrade"));
+        if (!upgrade_service_with_package(package_path_name, code, res, doc.GetAllocator()))
+        {
+            break;
+        }
+
+        queue_event("upgrade", GetUpgradeEvent("start"));
+        if (!start_dependent_services(related_definitions, code, res, doc.GetAllocator()))
         {
             break;
         }
@@ -1754,8 +2819,28 @@ void HttpService::handle_service_upgrade(struct mg_connection *nc, struct http_m
 
     } while (false);
 
+    // dependent services have been operated
+    _status_cache->Invalidate();
+
     delete_package(package_path_name);
 
+    _upgrading = false;
+
+    {
+        JsonArena arena;
+        EventBuffer event_buffer(&arena.Allocator());
+        rapidjson::Writer<EventBuffer> event_writer(event_buffer);
+        event_writer.StartObject();
+        event_writer.Key("step");
+        event_writer.String("done");
+        event_writer.Key("code");
+        code.Accept(event_writer);
+        event_writer.Key("result");
+        res.Accept(event_writer);
+        event_writer.EndObject();
+        queue_event("upgrade", std::string(event_buffer.GetString(), event_buffer.GetSize()));
+    }
+
     doc.AddMember("code", code, doc.GetAllocator());
     doc.AddMember("result", res, doc.GetAllocator());
 
@@ -1763,90 +2848,225 @@ void HttpService::handle_service_upgrade(struct mg_connection *nc, struct http_m
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
     doc.Accept(writer);
 
-    const char* json = buffer.GetString();
-    mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_send_http_chunk(nc, json, strlen(json));
-    mg_send_http_chunk(nc, "", 0); /* Send empty chunk, the end of response */
+    return buffer.GetString();
 }
 
-void HttpService::handle_html(struct mg_connection *nc, struct http_message *hm)
+const HttpService::Service_t* HttpService::find_service_instance(const std::string& name) const
 {
-    if (mg_vcmp(&hm->uri, "/") == 0)
-    {
-        mg_http_send_redirect(nc, 302, mg_mk_str("/index.html"), mg_mk_str(NULL));
-    }
-    else
-    {
-        mg_serve_http(nc, hm, _opts); /* Serve static content */
-    }
+    return _service_instances.Find(name);
 }
 
-bool HttpService::fresh_services_json(const Services_t& services, const std::string& json_file)
+template <typename Writer>
+void HttpService::write_service_json(Writer& writer, const Service_t& serv, const ServiceStatusSnapshot& statuses, rapidjson::Document::AllocatorType& allo)
 {
-    rapidjson::Document doc(rapidjson::kObjectType);
+    writer.StartObject();
+    JsonWriteMembers(writer, serv, HttpServiceJson::Web_Instance);
+
+    // the text of an error is made by the system, it is taken into the arena of the caller
+    rapidjson::Value status_txt(rapidjson::kStringType);
+    int status_code = GetServiceStatus(statuses, serv.name, status_txt, allo);
+    writer.Key("status_code");
+    writer.Int(status_code);
+    writer.Key("status_txt");
+    writer.String(status_txt.GetString(), status_txt.GetStringLength());
+    writer.EndObject();
+}
+
+void HttpService::publish_service_event(const char* event, const Service_t& serv)
+{
+    JsonArena arena;
+    EventBuffer buffer(&arena.Allocator());
+    rapidjson::Writer<EventBuffer> writer(buffer);
+    write_service_json(writer, serv, _status_cache->Snapshot(), arena.Allocator());
+
+    publish_event(event, buffer.GetString(), buffer.GetSize());
+}
 
-    rapidjson::Value arr_json(rapidjson::kArrayType);
+void HttpService::publish_event(const char* event, const char* data, size_t size)
+{
+    char head[128] = { 0 };
+    int head_size = snprintf(head, sizeof(head), "id: %llu\nevent: %s\ndata: ", ++_events_id, event);
 
-    rapidjson::Value str_json(rapidjson::kStringType);
-    rapidjson::Value num_json(rapidjson::kNumberType);    
-    for (const Service_t& serv : services)
+    for (struct mg_connection* c = mg_next(&_mgr, nullptr); c != nullptr; c = mg_next(&_mgr, c))
     {
-        rapidjson::Value serv_json(rapidjson::kObjectType);
+        if (!(c->flags & Service_Events_Flag))
+        {
+            continue;
+        }
 
-        str_json.SetString(serv.id.c_str(), doc.GetAllocator());
-        serv_json.AddMember("id", str_json, doc.GetAllocator());
+        // a subscriber which can not keep up takes a snapshot again once it subscribes again
+        if (c->send_mbuf.len > Service_Events_Queued)
+        {
+            c->flags |= MG_F_CLOSE_IMMEDIATELY;
+            continue;
+        }
 
-        str_json.SetString(serv.name.c_str(), doc.GetAllocator());
-        serv_json.AddMember("name", str_json, doc.GetAllocator());
+        mg_send(c, head, head_size);
+        mg_send(c, data, (int)size);
+        mg_send(c, "\n\n", 2);
+    }
+}
 
-        str_json.SetString(serv.description.c_str(), doc.GetAllocator());
-        serv_json.AddMember("description", str_json, doc.GetAllocator());
+void HttpService::queue_event(const char* event, const std::string& data)
+{
+    std::lock_guard<std::mutex> guard(_events_lock);
+    _events_queued.emplace_back(event, data);
+}
 
-        str_json.SetString(serv.library.name.c_str(), doc.GetAllocator());
-        serv_json.AddMember("library", str_json, doc.GetAllocator());
+void HttpService::publish_events()
+{
+    std::vector<std::pair<std::string, std::string>> queued;
+    {
+        std::lock_guard<std::mutex> guard(_events_lock);
+        queued.swap(_events_queued);
+    }
 
-        str_json.SetString(serv.library.config.c_str(), doc.GetAllocator());
-        serv_json.AddMember("configuration", str_json, doc.GetAllocator());
+    for (const std::pair<std::string, std::string>& event : queued)
+    {
+        publish_event(event.first.c_str(), event.second.data(), event.second.size());
+    }
 
-        str_json.SetString(serv.library.ver.c_str(), doc.GetAllocator());
-        serv_json.AddMember("version", str_json, doc.GetAllocator());
+    // the services whose status changed in a snapshot after the one published last
+    ServiceStatusSnapshot statuses = _status_cache->Snapshot();
+    if (statuses->version != _events_status_version)
+    {
+        for (const ServiceStatusMap_t::value_type& status : statuses->services)
+        {
+            if (status.second.version <= _events_status_version)
+            {
+                continue;
+            }
 
-        rapidjson::Value log_json(rapidjson::kObjectType);
-        str_json.SetString(serv.log.name.c_str(), doc.GetAllocator());
-        log_json.AddMember("name", str_json, doc.GetAllocator());
+            // the text of an error is made by the system, it is taken into the arena as the event is
+            JsonArena arena;
+            rapidjson::Value txt(rapidjson::kStringType);
+            int status_code = GetServiceStatus(statuses, status.first, txt, arena.Allocator());
 
-        str_json.SetString(serv.log.type.c_str(), doc.GetAllocator());
-        log_json.AddMember("type", str_json, doc.GetAllocator());
+            EventBuffer buffer(&arena.Allocator());
+            rapidjson::Writer<EventBuffer> writer(buffer);
+            writer.StartObject();
+            WriteStringMember(writer, "name", status.first);
+            writer.Key("status_code");
+            writer.Int(status_code);
+            writer.Key("status_txt");
+            writer.String(txt.GetString(), txt.GetStringLength());
+            writer.EndObject();
+            publish_event("status", buffer.GetString(), buffer.GetSize());
+        }
+        _events_status_version = statuses->version;
+    }
 
-        str_json.SetString(serv.log.level.c_str(), doc.GetAllocator());
-        log_json.AddMember("level", str_json, doc.GetAllocator());
+    double now = mg_time();
+    if (now - _events_keepalive >= Service_Events_Keepalive)
+    {
+        _events_keepalive = now;
+        for (struct mg_connection* c = mg_next(&_mgr, nullptr); c != nullptr; c = mg_next(&_mgr, c))
+        {
+            if (c->flags & Service_Events_Flag)
+            {
+                mg_send(c, ": keep-alive\n\n", 14);
+            }
+        }
+    }
+}
 
-        num_json.SetInt(serv.log.keep);
-        log_json.AddMember("keep", num_json, doc.GetAllocator());
+bool HttpService::parse_log_request(struct mg_connection *nc, struct http_message *hm, bool archived, std::string& log_file, int& from_ms, int& to_ms)
+{
+    char name[128] = { 0 }, file[256] = { 0 }, from[32] = { 0 }, to[32] = { 0 };
+    mg_get_http_var(&hm->query_string, "name", name, sizeof(name));
+    mg_get_http_var(&hm->query_string, "file", file, sizeof(file));
+    mg_get_http_var(&hm->query_string, "from", from, sizeof(from));
+    mg_get_http_var(&hm->query_string, "to", to, sizeof(to));
 
-        num_json.SetInt(serv.log.size);
-        log_json.AddMember("size", num_json, doc.GetAllocator());
+    const Service_t* found = find_service_instance(name);
+    if (!found)
+    {
+        mg_http_send_error(nc, 404, "Service does not exist");
+        return false;
+    }
 
-        serv_json.AddMember("log", log_json, doc.GetAllocator());
+    if (file[0])
+    {
+        if (!IsLogFileOf(file, found->name, found->log.name, found->supervise, archived))
+        {
+            mg_http_send_error(nc, 400, "Log file is not of the service");
+            return false;
+        }
+        log_file = _root + "logs\\" + file;
+    }
+    else
+    {
+        log_file = GetLogFile(_root, found->name, found->log.name, found->log.type, found->supervise);
+    }
 
-        arr_json.PushBack(serv_json, doc.GetAllocator());
+    from_ms = from[0] ? ParseLogTime(from) : -1;
+    to_ms = to[0] ? ParseLogTime(to) : -1;
+    if ((from[0] && from_ms < 0) || (to[0] && to_ms < 0))
+    {
+        mg_http_send_error(nc, 400, "Log time is not hh:mm[:ss[.mmm]]");
+        return false;
     }
-    
-    if (!arr_json.Empty())
+    return true;
+}
+
+void HttpService::copy_service_instances(Services_t& instances)
+{
+    std::lock_guard<std::mutex> guard(_instances_lock);
+    instances = _service_instances;
+}
+
+void HttpService::observe_status_changes(const ServiceStatusSnapshot& statuses)
+{
+    if (statuses->version == _list_status_version)
+    {
+        return;
+    }
+
+    // the changes of a snapshot share one version
+    bool changed = false;
     {
-        doc.AddMember("services", arr_json, doc.GetAllocator());
+        std::lock_guard<std::mutex> guard(_instances_lock);
+        for (Service_t& serv : _service_instances)
+        {
+            ServiceStatusMap_t::const_iterator status = statuses->services.find(serv.name);
+            if (statuses->services.end() == status || status->second.version <= _list_status_version)
+            {
+                continue;
+            }
+
+            if (!changed)
+            {
+                ++_list_version;
+                changed = true;
+            }
+            serv.version = _list_version;
+        }
     }
+    _list_status_version = statuses->version;
+}
 
+bool HttpService::fresh_services_json(const Services_t& services, const std::string& json_file)
+{
     rapidjson::StringBuffer buffer;
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
 
-    const char* json = buffer.GetString();
+    writer.StartObject();
+    if (!services.empty())
+    {
+        writer.Key("services");
+        writer.StartArray();
+        for (const Service_t& serv : services)
+        {
+            JsonWriteObject(writer, serv, HttpServiceJson::Instance);
+        }
+        writer.EndArray();
+    }
+    writer.EndObject();
 
     std::ofstream ofs(json_file);
     if (ofs.is_open())
     {
-        ofs.write(json, strlen(json));
+        ofs.write(buffer.GetString(), buffer.GetSize());
         ofs.close();
         return true;
     }
@@ -1880,7 +3100,8 @@ bool HttpService::parse_option(Service_t& serv, const std::string& options, rapi
         {
             continue;
         }
-        std::string value = *field_itr;
+        // the value may hold '=' itself, as --log.flush=interval=1000
+        std::string value = opt.substr(key.size() + 1);
 
         Service_Options_Type::const_iterator found = Service_Options.find(key);
         if (found != Service_Options.cend())
@@ -1927,6 +3148,31 @@ bool HttpService::parse_option(Service_t& serv, const std::string& options, rapi
                 }
                 break;
             }
+            case Service_Option_Supervise:
+            {
+                serv.supervise = ("on" == value);
+                break;
+            }
+            case Service_Option_Log_Flush:
+            {
+                serv.log.flush = value;
+                if (!IsLogFlushValid(serv.log.flush))
+                {
+                    everything_is_fine = false;
+                    err.SetString("Service log flush is invalid: always, interval=<ms> or level=<lvl>", allo);
+                }
+                break;
+            }
+            case Service_Option_Log_Flight:
+            {
+                serv.log.flight = value;
+                if (!IsLogFlightValid(serv.log.flight))
+                {
+                    everything_is_fine = false;
+                    err.SetString("Service log flight is invalid: trace, debug, info, warn, error, fatal or off", allo);
+                }
+                break;
+            }
             default:
             {
 
@@ -1992,6 +3238,21 @@ std::string HttpService::make_option(const Service_t& serv, bool make_service_op
         ss << " --log.size=80";
     }
 
+    if (!serv.log.flush.empty())
+    {
+        ss << " --log.flush=" << serv.log.flush;
+    }
+
+    if (!serv.log.flight.empty())
+    {
+        ss << " --log.flight=" << serv.log.flight;
+    }
+
+    if (serv.supervise)
+    {
+        ss << " --service.supervise=on";
+    }
+
     return ss.str();
 }
 
@@ -2018,6 +3279,13 @@ bool HttpService::create_service_configuration(const Service_t& serv, const std:
 
 bool HttpService::begin_upload_package()
 {
+    // the running upgrade is reading the package
+    if (_upgrading)
+    {
+        _logger->error("upload package failed: package is being upgraded");
+        return false;
+    }
+
     if (_package.is_open())
     {
         _package.close();
@@ -2306,13 +3574,14 @@ bool HttpService::stop_dependent_services(const std::list<std::string>& related_
 
         SERVICE_STATUS_PROCESS ssStatus;
         DWORD dwBytesNeeded;
-        for (const Service_t& serv : _service_instances)
+        // the instances are modified on the poll thread meanwhile
+        Services_t instances(&Service_t::name);
+        copy_service_instances(instances);
+
+        for (const Service_t* dependent : instances.FindOfDefinitions(related_definitions))
         {
-            std::list<std::string>::const_iterator found = std::find_if(related_definitions.begin(), related_definitions.end(), [&serv](const std::string& id) { return serv.id == id; });
-            if (related_definitions.end() == found)
-            {
-                continue;
-            }
+            const Service_t& serv = *dependent;
+            _status_cache->Invalidate(serv.name);
 
             SC_HANDLE schService = OpenService(
                 schSCManager,              // SCM database
@@ -2530,13 +3799,14 @@ bool HttpService::start_dependent_services(const std::list<std::string>& related
 
         SERVICE_STATUS_PROCESS ssStatus;
         DWORD dwBytesNeeded;
-        for (const Service_t& serv : _service_instances)
+        // the instances are modified on the poll thread meanwhile
+        Services_t instances(&Service_t::name);
+        copy_service_instances(instances);
+
+        for (const Service_t* dependent : instances.FindOfDefinitions(related_definitions))
         {
-            std::list<std::string>::const_iterator found = std::find_if(related_definitions.begin(), related_definitions.end(), [&serv](const std::string& id) { return serv.id == id; });
-            if (related_definitions.end() == found)
-            {
-                continue;
-            }
+            const Service_t& serv = *dependent;
+            _status_cache->Invalidate(serv.name);
 
             SC_HANDLE schService = OpenService(
                 schSCManager,              // SCM database
@@ -14,9 +14,25 @@ extern "C" {
 #include "archive.h"
 #include "archive_entry.h"
 
+#include "Status/ServiceStatusCache.h"
+
+#include "Log/LogArchiver.h"
+#include "Log/LogFile.h"
+#include "Log/LogIndex.h"
+
+#include "Http/StaticAssetCache.h"
+#include "Http/EmbeddedAssets.h"
+#include "Http/ServiceRegistry.h"
+
+#include "Executor/RequestExecutor.h"
+
 #include <unordered_set>
 #include <unordered_map>
 #include <list>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include <fstream>
 
@@ -25,7 +41,8 @@ class HttpService
 private:
     struct library_t 
     {
-        std::string name;
+        // the path of the library is one of its definition, so it is interned
+        InternedString name;
         std::string config;
         std::string ver;
     };
@@ -36,13 +53,19 @@ private:
         std::string type;
         std::string level;
 
+        // always, interval=<ms> or level=<lvl>, the loader flushes every message when empty
+        std::string flush;
+
+        // level recorded in memory by --log.flight, off when empty
+        std::string flight;
+
         int keep = 0;
         int size = 0;
     };
 
     struct Service_t 
     {
-        std::string id;
+        InternedString id;
         std::string name;
         std::string description;
 
@@ -50,17 +73,25 @@ private:
 
         log_t log;
 
+        // --service.supervise=on, the loader restarts its crashed worker
+        bool supervise = false;
+
         int status_code = 0;
         std::string status_txt;
+
+        // the list version in which the service or its status was last changed
+        unsigned long long version = 0;
     };
 
-    typedef std::list<Service_t> Services_t;
+    // instances are registered by name, definitions by id
+    typedef ServiceRegistry<Service_t, std::string> Services_t;
+    typedef ServiceRegistry<Service_t, InternedString> Definitions_t;
 
 public:
     HttpService();
     ~HttpService();
 
-    int Create(const std::string& address, int port, const std::string& directory, const std::string& service_definition_config, const std::string& service_active_config, const std::string& root, std::shared_ptr<spdlog::logger>& log);
+    int Create(const std::string& address, int port, const std::string& directory, const std::string& service_definition_config, const std::string& service_active_config, const std::string& root, int status_interval, const std::string& log_compress, int log_compress_rate, int log_compress_keep, std::shared_ptr<spdlog::logger>& log);
     void Serve();
     void Destroy();
 
@@ -84,9 +115,68 @@ private:
     void handle_service_delete(struct mg_connection *nc, struct http_message *hm);
     void handle_service_control(struct mg_connection *nc, struct http_message *hm);
     void handle_service_upgrade(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_supervisor(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_flight_recorder(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_events(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_log_range(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_log_grep(struct mg_connection *nc, struct http_message *hm);
+
+    // websocket, the lines are pushed on the timer of the connection
+    void handle_service_log_tail(struct mg_connection *nc, struct http_message *hm);
+    void handle_service_log_tail_timer(struct mg_connection *nc);
+
+    void handle_executor_stats(struct mg_connection *nc, struct http_message *hm);
+    void handle_route_stats(struct mg_connection *nc, struct http_message *hm);
+
+    // to the handler of the route, timed into its stats, or to handle_html
+    void handle_request(struct mg_connection *nc, struct http_message *hm);
 
     void handle_html(struct mg_connection *nc, struct http_message *hm);
 
+    // a GET or HEAD of a cached asset, false to serve it from the disk
+    bool serve_static(struct mg_connection *nc, struct http_message *hm);
+
+private:
+    // run on the worker pools
+    std::string control_service(const std::string& action, const std::string& name);
+    std::string upgrade_services();
+    std::string dump_flight_recorder(const std::string& name, const std::string& flight_file, bool running);
+    std::string read_supervisor_status(const std::string& name, const std::string& status_file);
+    std::string read_log_range(const std::string& log_file, const std::string& range, int from_ms, int to_ms);
+    std::string grep_log(const std::string& log_file, const std::string& range, const std::string& text, int from_ms, int to_ms, int max_lines);
+
+    // the lines appended to the log of a tail since its last read
+    struct LogTail_t;
+    std::string read_log_tail(const std::shared_ptr<LogTail_t>& tail, const std::string& log_file);
+
+    // the first line of the time or later through the index of the log
+    unsigned long long find_log_time(LogFile& log, const std::string& log_file, unsigned int time_ms, unsigned long long size);
+
+    void copy_service_instances(Services_t& instances);
+
+    // takes the status changes of a snapshot into the versions of the services, on the poll thread only
+    void observe_status_changes(const ServiceStatusSnapshot& statuses);
+
+    const Service_t* find_service_instance(const std::string& name) const;
+
+    // an instance as the web ui takes it, into a rapidjson Writer, allo takes the text of its status
+    template <typename Writer>
+    void write_service_json(Writer& writer, const Service_t& serv, const ServiceStatusSnapshot& statuses, rapidjson::Document::AllocatorType& allo);
+    void publish_service_event(const char* event, const Service_t& serv);
+
+private:
+    // sends an event to the /service/events streams, on the poll thread only
+    void publish_event(const char* event, const char* data, size_t size);
+
+    // an event of a worker thread, published by the poll thread
+    void queue_event(const char* event, const std::string& data);
+
+    // the queued events, the status changes of the services since the last time and the keep-alives
+    void publish_events();
+
+    // the log of name=, file= and the time of from= and to= of a /service/log request, false once replied with the error
+    bool parse_log_request(struct mg_connection *nc, struct http_message *hm, bool archived, std::string& log_file, int& from_ms, int& to_ms);
+
 private:
     bool fresh_services_json(const Services_t& services, const std::string& json_file);
     bool parse_option(Service_t& serv, const std::string& option, rapidjson::Value& err, rapidjson::Document::AllocatorType& allo);
@@ -117,6 +207,8 @@ private:
 private:
     friend void ev_handler(struct mg_connection *nc, int ev, void *ev_data);
     friend void ev_upload(struct mg_connection *nc, int ev, void *ev_data);
+    friend struct HttpRoutes;
+    friend struct HttpServiceJson;
 
 private:
     struct mg_mgr _mgr;
@@ -124,16 +216,79 @@ private:
 
 private:
     std::string _definitions_path;
-    Services_t _service_definitions;
+    Definitions_t _service_definitions;
 
     std::string _services_path;
     Services_t _service_instances;
 
+    // the instances and the list versions are modified on the poll thread only, under the lock,
+    // the poll thread reads them without it, the worker pools copy them under it, see copy_service_instances
+    std::mutex _instances_lock;
+
+    // /service/list?since=, the version of the last change of the instances and the status snapshot taken into it,
+    // the names deleted with their versions, the ones before the floor are dropped
+    unsigned long long _list_version;
+    unsigned long long _list_status_version;
+    std::deque<std::pair<unsigned long long, std::string>> _deleted_instances;
+    unsigned long long _deleted_floor;
+
+    std::unique_ptr<ServiceStatusCache> _status_cache;
+
+    std::unique_ptr<LogArchiver> _log_archiver;
+
+    // the http directory, which the opts point to, and its files in memory, empty to serve the packed web ui
+    std::string _directory;
+    std::unique_ptr<StaticAssetCache> _static_cache;
+
+    struct LogTail_t
+    {
+        std::string name;
+
+        // the file and where its next line starts, unless aligned is false, then the line cut there is skipped first,
+        // taken by the service pool while a read of the connection is pending, by the poll thread otherwise
+        std::string file;
+        unsigned long long offset = 0;
+        bool aligned = true;
+
+        // the first read starts the backlog before the end
+        bool started = false;
+    };
+
+    // the websockets of /service/log/tail, on the poll thread only
+    std::unordered_map<struct mg_connection*, std::shared_ptr<LogTail_t>> _log_tails;
+
+    // /service/events, the version of the status snapshot whose changes are published and the id of the last event
+    unsigned long long _events_status_version;
+    unsigned long long _events_id;
+    double _events_keepalive;
+
+    std::vector<std::pair<std::string, std::string>> _events_queued;
+    std::mutex _events_lock;
+
+    // the indexes of the logs searched by time, by file
+    std::unordered_map<std::string, std::shared_ptr<LogIndex>> _log_indexes;
+    std::mutex _log_indexes_lock;
+
+    RequestExecutor _executor;
+
+    struct RouteStats_t
+    {
+        unsigned long long requests = 0;
+
+        // on the poll thread, a handler which submits its work returns once it is submitted
+        unsigned long long total_us = 0;
+        unsigned long long max_us = 0;
+    };
+
+    // by the index of the route, the last is of the requests left to handle_html, on the poll thread only
+    std::vector<RouteStats_t> _route_stats;
+
 private:
     std::string _root;
 
 private:
     std::ofstream _package;
+    std::atomic<bool> _upgrading;
 
 private:
     static std::shared_ptr<spdlog::logger> _logger;
@@ -0,0 +1,787 @@
+#ifndef _JSON_REFLECT_HEADER_H_
+#define _JSON_REFLECT_HEADER_H_
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/reader.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <ctype.h>
+#include <string.h>
+
+/*
+* the json of a struct told by a plain array of its fields, the names with the member pointers, from which the
+* members are written by the events of a rapidjson Writer and read by those of a Reader, without a document between
+*
+*   static const JsonField_t Log_Fields[] = {
+*       JsonField("name", &log_t::name, Json_Trim),
+*       JsonField("keep", &log_t::keep) };
+*
+* a field takes std::string, int, bool or unsigned long long, or a type of its own JsonAssign and JsonValue,
+* JsonInnerField a member of a member, as a flat json of a nested struct, and JsonObject a member written as an object
+* of its own fields
+*/
+
+// the flags of a field
+static const unsigned int Json_Required = 1;
+static const unsigned int Json_Not_Empty = 2;
+static const unsigned int Json_Trim = 4;
+static const unsigned int Json_Omit_Empty = 8;
+
+// the fields of an object at most, the ones seen are bits
+static const size_t Json_Fields_Max = 64;
+
+typedef bool (*JsonValid)(const std::string& value);
+
+// a scalar of the reader or of a member to be written, or none for an object or an array where a scalar is taken
+struct JsonScalar_t
+{
+    enum Type_t
+    {
+        None = 0,
+        Null,
+        Bool,
+        Number,
+        String
+    };
+
+    Type_t type;
+    bool boolean;
+    long long number;
+    const char* str;
+    size_t size;
+};
+
+// a member pointer of any owner and type, cast back by the functions of its field made with the types, the owners
+// are plain structs so that the pointers are all alike
+struct JsonErased_t
+{
+};
+
+typedef char JsonErased_t::* JsonMember_t;
+
+struct JsonField_t
+{
+    const char* name;
+    unsigned int flags;
+
+    // the member, and its member for a field of a nested struct
+    JsonMember_t member;
+    JsonMember_t inner;
+
+    // the member of an owner
+    void* (*get)(const JsonField_t& field, const void* owner);
+
+    // what the value is not, nullptr once it is taken into the member
+    const char* (*read)(const JsonField_t& field, void* member, const JsonScalar_t& value);
+
+    // the value of the member to be written
+    JsonScalar_t (*write)(const void* member);
+
+    // a string which is not valid, and what it is told to be not
+    JsonValid valid;
+    const char* invalid;
+
+    // taken for a string present but empty
+    const char* empty;
+
+    // the fields of an object field, nullptr for a scalar one
+    const JsonField_t* fields;
+    size_t count;
+};
+
+// what the value is not, nullptr once it is taken
+inline const char* JsonAssign(std::string& target, const JsonScalar_t& value, unsigned int flags, JsonValid valid, const char* invalid, const char* empty)
+{
+    if (JsonScalar_t::String != value.type)
+    {
+        return "is not string";
+    }
+
+    // trimmed as util::string::trim does, on the text of the reader before it is taken
+    const char* begin = value.str;
+    const char* end = value.str + value.size;
+    if (flags & Json_Trim)
+    {
+        while (begin < end && isspace((unsigned char)*begin))
+        {
+            ++begin;
+        }
+        while (end > begin && isspace((unsigned char)end[-1]))
+        {
+            --end;
+        }
+    }
+    target.assign(begin, end);
+    if (target.empty() && (flags & Json_Not_Empty))
+    {
+        return "is empty";
+    }
+    if (target.empty() && empty)
+    {
+        target = empty;
+    }
+    if (valid && !valid(target))
+    {
+        return invalid;
+    }
+    return nullptr;
+}
+
+inline const char* JsonAssign(int& target, const JsonScalar_t& value, unsigned int, JsonValid, const char*, const char*)
+{
+    if (JsonScalar_t::Number != value.type)
+    {
+        return "is not number";
+    }
+    target = (int)value.number;
+    return nullptr;
+}
+
+inline const char* JsonAssign(bool& target, const JsonScalar_t& value, unsigned int, JsonValid, const char*, const char*)
+{
+    if (JsonScalar_t::Bool != value.type)
+    {
+        return "is not bool";
+    }
+    target = value.boolean;
+    return nullptr;
+}
+
+inline const char* JsonAssign(unsigned long long& target, const JsonScalar_t& value, unsigned int, JsonValid, const char*, const char*)
+{
+    if (JsonScalar_t::Number != value.type || value.number < 0)
+    {
+        return "is not number";
+    }
+    target = (unsigned long long)value.number;
+    return nullptr;
+}
+
+// the value of a member, a string is not copied
+inline JsonScalar_t JsonValue(const std::string& source)
+{
+    JsonScalar_t value = { JsonScalar_t::String, false, 0, source.c_str(), source.size() };
+    return value;
+}
+
+inline JsonScalar_t JsonValue(int source)
+{
+    JsonScalar_t value = { JsonScalar_t::Number, false, source, nullptr, 0 };
+    return value;
+}
+
+inline JsonScalar_t JsonValue(bool source)
+{
+    JsonScalar_t value = { JsonScalar_t::Bool, source, 0, nullptr, 0 };
+    return value;
+}
+
+inline JsonScalar_t JsonValue(unsigned long long source)
+{
+    JsonScalar_t value = { JsonScalar_t::Number, false, (long long)source, nullptr, 0 };
+    return value;
+}
+
+template <typename Owner, typename T>
+void* JsonGetMember(const JsonField_t& field, const void* owner)
+{
+    return &(((Owner*)owner)->*reinterpret_cast<T Owner::*>(field.member));
+}
+
+template <typename Owner, typename Inner, typename T>
+void* JsonGetInner(const JsonField_t& field, const void* owner)
+{
+    return &((((Owner*)owner)->*reinterpret_cast<Inner Owner::*>(field.member)).*reinterpret_cast<T Inner::*>(field.inner));
+}
+
+// JsonAssign and JsonValue are found by the type of the member, those of a type of the caller too
+template <typename T>
+const char* JsonReadMember(const JsonField_t& field, void* member, const JsonScalar_t& value)
+{
+    return JsonAssign(*(T*)member, value, field.flags, field.valid, field.invalid, field.empty);
+}
+
+template <typename T>
+JsonScalar_t JsonWriteMember(const void* member)
+{
+    return JsonValue(*(const T*)member);
+}
+
+template <typename Owner, typename T>
+JsonField_t JsonField(const char* name, T Owner::* member, unsigned int flags = 0, JsonValid valid = nullptr, const char* invalid = nullptr, const char* empty = nullptr)
+{
+    JsonField_t field = { name, flags, reinterpret_cast<JsonMember_t>(member), nullptr, &JsonGetMember<Owner, T>, &JsonReadMember<T>, &JsonWriteMember<T>, valid, invalid, empty, nullptr, 0 };
+    return field;
+}
+
+template <typename Owner, typename Inner, typename T>
+JsonField_t JsonInnerField(const char* name, Inner Owner::* inner, T Inner::* member, unsigned int flags = 0, JsonValid valid = nullptr, const char* invalid = nullptr, const char* empty = nullptr)
+{
+    JsonField_t field = { name, flags, reinterpret_cast<JsonMember_t>(inner), reinterpret_cast<JsonMember_t>(member), &JsonGetInner<Owner, Inner, T>, &JsonReadMember<T>, &JsonWriteMember<T>, valid, invalid, empty, nullptr, 0 };
+    return field;
+}
+
+template <typename Owner, typename T, size_t N>
+JsonField_t JsonObject(const char* name, T Owner::* member, const JsonField_t (&fields)[N], unsigned int flags = 0)
+{
+    static_assert(N <= Json_Fields_Max, "the fields of a struct are 1 to 64");
+
+    JsonField_t field = { name, flags, reinterpret_cast<JsonMember_t>(member), nullptr, &JsonGetMember<Owner, T>, nullptr, nullptr, nullptr, nullptr, nullptr, fields, N };
+    return field;
+}
+
+//
+// writing
+//
+
+template <typename Writer>
+void JsonWriteFields(Writer& writer, const void* owner, const JsonField_t* fields, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const JsonField_t& field = fields[i];
+        const void* member = field.get(field, owner);
+        if (field.fields)
+        {
+            writer.Key(field.name);
+            writer.StartObject();
+            JsonWriteFields(writer, member, field.fields, field.count);
+            writer.EndObject();
+            continue;
+        }
+
+        JsonScalar_t value = field.write(member);
+        if (JsonScalar_t::String == value.type && 0 == value.size && (field.flags & Json_Omit_Empty))
+        {
+            continue;
+        }
+
+        writer.Key(field.name);
+        switch (value.type)
+        {
+        case JsonScalar_t::String:
+            writer.String(value.str, (rapidjson::SizeType)value.size);
+            break;
+        case JsonScalar_t::Number:
+            writer.Int64(value.number);
+            break;
+        case JsonScalar_t::Bool:
+            writer.Bool(value.boolean);
+            break;
+        default:
+            writer.Null();
+            break;
+        }
+    }
+}
+
+// the members only, so that the caller may add its own before the object is ended
+template <typename Writer, typename Owner, size_t N>
+void JsonWriteMembers(Writer& writer, const Owner& owner, const JsonField_t (&fields)[N])
+{
+    JsonWriteFields(writer, &owner, fields, N);
+}
+
+template <typename Writer, typename Owner, size_t N>
+void JsonWriteObject(Writer& writer, const Owner& owner, const JsonField_t (&fields)[N])
+{
+    writer.StartObject();
+    JsonWriteFields(writer, &owner, fields, N);
+    writer.EndObject();
+}
+
+//
+// reading
+//
+
+/*
+* the rapidjson Reader handler, the root is an object read into its owner, or an object whose array under a key
+* is read an element a time into one started as initial, an element not valid is passed on with the error and left
+* for the next, an empty one is passed over, the others of the root are skipped
+*/
+class JsonReflectReader : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JsonReflectReader>
+{
+public:
+    // an element read, error tells the first field not valid, empty if it is, the owner is to be made ready for the next
+    typedef std::function<void(const std::string& error)> ElementRead;
+
+    // the root object
+    JsonReflectReader(void* owner, const JsonField_t* fields, size_t count)
+        : _root_owner(owner), _root_fields(fields), _root_count(count)
+        , _array_key(nullptr), _array_key_pending(false), _element()
+        , _state(Reading_Root), _array_seen(false), _root_members(0), _skip(0), _fatal()
+        , _frames(), _error()
+    {
+    }
+
+    // the array under array_key of the root, element is called once an element is read into owner
+    JsonReflectReader(const char* array_key, void* owner, const JsonField_t* fields, size_t count, const ElementRead& element)
+        : _root_owner(owner), _root_fields(fields), _root_count(count)
+        , _array_key(array_key), _array_key_pending(false), _element(element)
+        , _state(Reading_Root), _array_seen(false), _root_members(0), _skip(0), _fatal()
+        , _frames(), _error()
+    {
+    }
+
+    // the root is not as told, the reader is stopped then
+    const std::string& Fatal() const
+    {
+        return _fatal;
+    }
+
+    // of the root object, or of the last element
+    const std::string& Error() const
+    {
+        return _error;
+    }
+
+    // whether the array was found under its key in the root
+    bool ArraySeen() const
+    {
+        return _array_seen;
+    }
+
+    // the members of the root object
+    size_t RootMembers() const
+    {
+        return _root_members;
+    }
+
+public:
+    bool Null()
+    {
+        JsonScalar_t value = { JsonScalar_t::Null, false, 0, nullptr, 0 };
+        return scalar(value);
+    }
+
+    bool Bool(bool b)
+    {
+        JsonScalar_t value = { JsonScalar_t::Bool, b, 0, nullptr, 0 };
+        return scalar(value);
+    }
+
+    bool Int(int i)
+    {
+        return Int64(i);
+    }
+
+    bool Uint(unsigned u)
+    {
+        return Int64(u);
+    }
+
+    bool Int64(int64_t i)
+    {
+        JsonScalar_t value = { JsonScalar_t::Number, false, (long long)i, nullptr, 0 };
+        return scalar(value);
+    }
+
+    bool Uint64(uint64_t u)
+    {
+        return Int64((int64_t)u);
+    }
+
+    bool Double(double d)
+    {
+        return Int64((int64_t)d);
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool)
+    {
+        JsonScalar_t value = { JsonScalar_t::String, false, 0, str, length };
+        return scalar(value);
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool)
+    {
+        if (_skip > 0)
+        {
+            return true;
+        }
+
+        if (Reading_Root_Object == _state)
+        {
+            ++_root_members;
+            _array_key_pending = strlen(_array_key) == length && 0 == memcmp(_array_key, str, length);
+            return true;
+        }
+
+        Frame_t& frame = _frames.back();
+        ++frame.keys;
+        frame.field = find(str, length);
+        if (frame.field >= 0)
+        {
+            frame.seen |= 1ULL << frame.field;
+        }
+        return true;
+    }
+
+    bool StartObject()
+    {
+        return start(true);
+    }
+
+    bool EndObject(rapidjson::SizeType)
+    {
+        if (_skip > 0)
+        {
+            --_skip;
+            return true;
+        }
+
+        if (Reading_Root_Object == _state)
+        {
+            _state = Reading_Done;
+            return true;
+        }
+
+        Frame_t& frame = _frames.back();
+        bool empty_element = Reading_Element == _state && 1 == _frames.size() && 0 == frame.keys;
+        const char* missing = empty_element ? nullptr : missing_field();
+        if (missing)
+        {
+            fail(missing, "is not provided");
+        }
+        _frames.pop_back();
+
+        if (_frames.empty())
+        {
+            if (Reading_Element == _state)
+            {
+                // an element of nothing is passed over
+                if (!empty_element)
+                {
+                    _element(_error);
+                }
+                _state = Reading_Array;
+            }
+            else
+            {
+                _state = Reading_Done;
+            }
+        }
+        return true;
+    }
+
+    bool StartArray()
+    {
+        return start(false);
+    }
+
+    bool EndArray(rapidjson::SizeType)
+    {
+        if (_skip > 0)
+        {
+            --_skip;
+            return true;
+        }
+
+        if (Reading_Array == _state)
+        {
+            _state = Reading_Root_Object;
+        }
+        return true;
+    }
+
+private:
+    bool start(bool object)
+    {
+        if (_skip > 0)
+        {
+            ++_skip;
+            return true;
+        }
+
+        switch (_state)
+        {
+        case Reading_Root:
+        {
+            if (!object)
+            {
+                _fatal = "it is not object";
+                return false;
+            }
+
+            if (_array_key)
+            {
+                _state = Reading_Root_Object;
+            }
+            else
+            {
+                push(nullptr, _root_owner, _root_fields, _root_count);
+                _state = Reading_Object;
+            }
+            return true;
+        }
+        case Reading_Root_Object:
+        {
+            if (!_array_key_pending)
+            {
+                _skip = 1;
+                return true;
+            }
+
+            if (object)
+            {
+                _fatal = std::string(_array_key) + " field is not array";
+                return false;
+            }
+            _array_seen = true;
+            _state = Reading_Array;
+            return true;
+        }
+        case Reading_Array:
+        {
+            _error.clear();
+            if (!object)
+            {
+                _error = "it is not object";
+                _element(_error);
+                _skip = 1;
+                return true;
+            }
+
+            push(nullptr, _root_owner, _root_fields, _root_count);
+            _state = Reading_Element;
+            return true;
+        }
+        case Reading_Object:
+        case Reading_Element:
+        {
+            Frame_t& frame = _frames.back();
+            if (frame.field < 0)
+            {
+                _skip = 1;
+                return true;
+            }
+
+            const JsonField_t& field = frame.fields[frame.field];
+            if (!object || !field.fields)
+            {
+                JsonScalar_t none = { JsonScalar_t::None, false, 0, nullptr, 0 };
+                fail(field.name, read(none));
+                _skip = 1;
+                return true;
+            }
+
+            push(field.name, field.get(field, frame.owner), field.fields, field.count);
+            return true;
+        }
+        default:
+            _skip = 1;
+            return true;
+        }
+    }
+
+    bool scalar(const JsonScalar_t& value)
+    {
+        if (_skip > 0)
+        {
+            return true;
+        }
+
+        switch (_state)
+        {
+        case Reading_Root:
+            _fatal = "it is not object";
+            return false;
+        case Reading_Root_Object:
+            if (_array_key_pending)
+            {
+                _fatal = std::string(_array_key) + " field is not array";
+                return false;
+            }
+            return true;
+        case Reading_Array:
+            _error = "it is not object";
+            _element(_error);
+            return true;
+        case Reading_Object:
+        case Reading_Element:
+        {
+            Frame_t& frame = _frames.back();
+            if (frame.field >= 0 && _error.empty())
+            {
+                const char* error = read(value);
+                if (error)
+                {
+                    fail(frame.fields[frame.field].name, error);
+                }
+            }
+            return true;
+        }
+        default:
+            return true;
+        }
+    }
+
+    // the index of the field of the name in the object being read, -1 if none
+    int find(const char* name, size_t size) const
+    {
+        const Frame_t& frame = _frames.back();
+        for (size_t i = 0; i < frame.count; ++i)
+        {
+            if (strlen(frame.fields[i].name) == size && 0 == memcmp(frame.fields[i].name, name, size))
+            {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    // what the value of the field being read is not, nullptr once it is taken
+    const char* read(const JsonScalar_t& value) const
+    {
+        const Frame_t& frame = _frames.back();
+        const JsonField_t& field = frame.fields[frame.field];
+        if (field.fields)
+        {
+            return "is not object";
+        }
+        return field.read(field, field.get(field, frame.owner), value);
+    }
+
+    // the first required field of the object being read not seen, nullptr if none
+    const char* missing_field() const
+    {
+        const Frame_t& frame = _frames.back();
+        for (size_t i = 0; i < frame.count; ++i)
+        {
+            if ((frame.fields[i].flags & Json_Required) && !(frame.seen & (1ULL << i)))
+            {
+                return frame.fields[i].name;
+            }
+        }
+        return nullptr;
+    }
+
+    void push(const char* name, void* owner, const JsonField_t* fields, size_t count)
+    {
+        Frame_t frame = { name, owner, fields, count, 0, -1, 0 };
+        _frames.push_back(frame);
+    }
+
+    // the first error of the object is kept, the fields after it are not read
+    void fail(const char* name, const char* error)
+    {
+        if (!_error.empty())
+        {
+            return;
+        }
+
+        for (size_t i = 1; i < _frames.size(); ++i)
+        {
+            _error.append(_frames[i].name).append(1, '.');
+        }
+        _error.append(name).append(1, ' ').append(error);
+    }
+
+private:
+    enum State_t
+    {
+        Reading_Root,
+        Reading_Root_Object,
+        Reading_Array,
+        Reading_Element,
+        Reading_Object,
+        Reading_Done
+    };
+
+    struct Frame_t
+    {
+        const char* name;
+        void* owner;
+        const JsonField_t* fields;
+        size_t count;
+        unsigned long long seen;
+        int field;
+        size_t keys;
+    };
+
+    void* _root_owner;
+    const JsonField_t* _root_fields;
+    size_t _root_count;
+
+    const char* _array_key;
+    bool _array_key_pending;
+    ElementRead _element;
+
+    State_t _state;
+    bool _array_seen;
+    size_t _root_members;
+
+    // the depth of a value skipped
+    int _skip;
+
+    std::string _fatal;
+
+    std::vector<Frame_t> _frames;
+    std::string _error;
+
+private:
+    JsonReflectReader(const JsonReflectReader&);
+    JsonReflectReader& operator=(const JsonReflectReader&);
+};
+
+// the error of a text which does not parse
+static const char* Json_Not_Json = "it is not json";
+
+// the object of text into owner, false with the error once it is not json, not an object or a field is not valid
+template <typename Owner, size_t N>
+bool JsonReadObject(const char* text, Owner& owner, const JsonField_t (&fields)[N], std::string& error)
+{
+    static_assert(N <= Json_Fields_Max, "the fields of a struct are 1 to 64");
+
+    JsonReflectReader handler(&owner, fields, N);
+
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(text);
+    if (!reader.Parse(stream, handler))
+    {
+        error = handler.Fatal().empty() ? Json_Not_Json : handler.Fatal();
+        return false;
+    }
+
+    error = handler.Error();
+    return error.empty();
+}
+
+// the objects of the array under key of the root object of text, each read into one started as initial and taken by
+// element with the error of its first field not valid, empty if it is valid, false with the error once the text is
+// not json or not such an object, a text of nothing or {} has none
+template <typename Owner, size_t N>
+bool JsonReadArray(const char* text, const char* key, const Owner& initial, const JsonField_t (&fields)[N], const std::function<void(Owner& owner, const std::string& error)>& element, std::string& error)
+{
+    static_assert(N <= Json_Fields_Max, "the fields of a struct are 1 to 64");
+
+    Owner owner = initial;
+    JsonReflectReader handler(key, &owner, fields, N, [&](const std::string& element_error) {
+        element(owner, element_error);
+        owner = initial;
+    });
+
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(text);
+    if (!reader.Parse(stream, handler))
+    {
+        if (rapidjson::kParseErrorDocumentEmpty == reader.GetParseErrorCode())
+        {
+            return true;
+        }
+
+        error = handler.Fatal().empty() ? Json_Not_Json : handler.Fatal();
+        return false;
+    }
+
+    if (!handler.ArraySeen() && handler.RootMembers() > 0)
+    {
+        error = std::string(key) + " field is not provided";
+        return false;
+    }
+    return true;
+}
+
+#endif
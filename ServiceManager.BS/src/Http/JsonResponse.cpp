@@ -0,0 +1,137 @@
+
+#include "Http/JsonResponse.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <stdio.h>
+#include <string.h>
+
+// the data of a chunk at most, the longer a chunk the less framing, while its size still fits the room
+static const size_t Json_Chunk_Size = 64 * 1024;
+
+// the room of the size of a chunk, hex with leading zeros
+static const size_t Json_Chunk_Head = 10;
+
+// the buffer of the arena of a thread, a list of some hundred services fits in it
+static const size_t Json_Arena_Size = 256 * 1024;
+
+static const size_t Json_No_Limit = (size_t)-1;
+
+JsonResponse::JsonResponse(struct mg_connection* nc, const char* head)
+    : _nc(nc), _buffer(&nc->send_mbuf)
+    , _chunked(true), _ended(false)
+    , _chunk_head(0), _chunk_begin(0), _chunk_limit(Json_No_Limit)
+{
+    mg_printf(nc, "%sTransfer-Encoding: chunked\r\n\r\n", head);
+    open_chunk();
+}
+
+JsonResponse::JsonResponse(struct mg_connection* nc)
+    : _nc(nc), _buffer(&nc->send_mbuf)
+    , _chunked(false), _ended(false)
+    , _chunk_head(0), _chunk_begin(0), _chunk_limit(Json_No_Limit)
+{
+}
+
+JsonResponse::~JsonResponse()
+{
+    End();
+}
+
+void JsonResponse::End()
+{
+    if (_ended)
+    {
+        return;
+    }
+    _ended = true;
+
+    if (_chunked)
+    {
+        close_chunk();
+        mbuf_append(_buffer, "0\r\n\r\n", 5);
+    }
+    _nc->last_io_time = (time_t)mg_time();
+}
+
+void JsonResponse::reserve(size_t count)
+{
+    if (_chunked && _buffer->len >= _chunk_limit)
+    {
+        close_chunk();
+        open_chunk();
+    }
+
+    // the framing of the chunk is taken into the room too
+    size_t needed = _buffer->len + count + (_chunked ? Json_Chunk_Head + 2 : 0);
+    if (needed > _buffer->size)
+    {
+        mbuf_resize(_buffer, std::max(needed, _buffer->size + _buffer->size / 2));
+    }
+}
+
+void JsonResponse::open_chunk()
+{
+    static const char room[Json_Chunk_Head] = { '0', '0', '0', '0', '0', '0', '0', '0', '\r', '\n' };
+    _chunk_head = _buffer->len;
+    mbuf_append(_buffer, room, sizeof(room));
+
+    _chunk_begin = _buffer->len;
+    _chunk_limit = _chunk_begin + Json_Chunk_Size;
+}
+
+void JsonResponse::close_chunk()
+{
+    size_t size = _buffer->len - _chunk_begin;
+    if (0 == size)
+    {
+        // a chunk of no data would end the response
+        _buffer->len = _chunk_head;
+        return;
+    }
+
+    char head[Json_Chunk_Head + 1] = { 0 };
+    snprintf(head, sizeof(head), "%08x\r\n", (unsigned int)size);
+    memcpy(_buffer->buf + _chunk_head, head, Json_Chunk_Head);
+    mbuf_append(_buffer, "\r\n", 2);
+}
+
+struct JsonArenaThread_t
+{
+    char buffer[Json_Arena_Size];
+    rapidjson::MemoryPoolAllocator<> allocator;
+    int depth;
+
+    JsonArenaThread_t()
+        : allocator(buffer, sizeof(buffer)), depth(0)
+    {
+    }
+};
+
+// taken by the threads which make json only, the others keep no buffer
+static JsonArenaThread_t& GetJsonArenaThread()
+{
+    static thread_local std::unique_ptr<JsonArenaThread_t> arena;
+    if (!arena)
+    {
+        arena.reset(new JsonArenaThread_t());
+    }
+    return *arena;
+}
+
+JsonArena::JsonArena()
+    : _allocator(&GetJsonArenaThread().allocator)
+{
+    ++GetJsonArenaThread().depth;
+}
+
+JsonArena::~JsonArena()
+{
+    // an arena within another, as an event made while a response is, leaves the memory to the outer one
+    JsonArenaThread_t& arena = GetJsonArenaThread();
+    if (0 == --arena.depth)
+    {
+        arena.allocator.Clear();
+    }
+}
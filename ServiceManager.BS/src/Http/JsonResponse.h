@@ -0,0 +1,119 @@
+#ifndef _JSON_RESPONSE_HEADER_H_
+#define _JSON_RESPONSE_HEADER_H_
+
+extern "C" {
+#include "mongoose/mongoose.h"
+}
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/allocators.h"
+
+#include <stddef.h>
+
+/*
+* a rapidjson output stream into the send buffer of a connection, so a Writer puts the json where mongoose sends it
+* from instead of into a StringBuffer copied after, a response is framed in chunks in place, the size of a chunk is
+* written into the room left before it once Json_Chunk_Size bytes or the end are reached
+*
+* on the poll thread only, as is the send buffer
+*/
+class JsonResponse
+{
+public:
+    typedef char Ch;
+
+    // head is the status line and the headers, each ending with \r\n, the body is chunked
+    JsonResponse(struct mg_connection* nc, const char* head);
+
+    // the body only, framed by the caller, as the data of an event
+    explicit JsonResponse(struct mg_connection* nc);
+
+    // ends the response unless ended
+    ~JsonResponse();
+
+    // the last chunk and the empty one
+    void End();
+
+    void Put(Ch ch)
+    {
+        Reserve(1);
+        PutUnsafe(ch);
+    }
+
+    void PutUnsafe(Ch ch)
+    {
+        _buffer->buf[_buffer->len++] = ch;
+    }
+
+    void Reserve(size_t count)
+    {
+        if (_buffer->size - _buffer->len < count || _buffer->len >= _chunk_limit)
+        {
+            reserve(count);
+        }
+    }
+
+    void Flush()
+    {
+    }
+
+private:
+    // closes the chunk once full and opens the next, and grows the buffer
+    void reserve(size_t count);
+
+    void open_chunk();
+    void close_chunk();
+
+private:
+    struct mg_connection* _nc;
+    struct mbuf* _buffer;
+
+    bool _chunked;
+    bool _ended;
+
+    // the offsets of the size of the chunk and of its data, the chunk is closed once the data reaches the limit
+    size_t _chunk_head;
+    size_t _chunk_begin;
+    size_t _chunk_limit;
+
+private:
+    JsonResponse();
+    JsonResponse(const JsonResponse&);
+    JsonResponse& operator=(const JsonResponse&);
+};
+
+// found by the Writer through the stream, instead of the generic ones which put a byte a time
+inline void PutReserve(JsonResponse& stream, size_t count)
+{
+    stream.Reserve(count);
+}
+
+inline void PutUnsafe(JsonResponse& stream, char ch)
+{
+    stream.PutUnsafe(ch);
+}
+
+/*
+* the allocator of the documents of a request, on a buffer of the thread which its requests reuse, the chunks taken
+* beyond the buffer are freed once the outermost arena of the thread is done
+*/
+class JsonArena
+{
+public:
+    JsonArena();
+    ~JsonArena();
+
+    rapidjson::MemoryPoolAllocator<>& Allocator()
+    {
+        return *_allocator;
+    }
+
+private:
+    rapidjson::MemoryPoolAllocator<>* _allocator;
+
+private:
+    JsonArena(const JsonArena&);
+    JsonArena& operator=(const JsonArena&);
+};
+
+#endif
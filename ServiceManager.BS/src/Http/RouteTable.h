@@ -0,0 +1,438 @@
+#ifndef _ROUTE_TABLE_HEADER_H_
+#define _ROUTE_TABLE_HEADER_H_
+
+extern "C" {
+#include "mongoose/mongoose.h"
+}
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <string.h>
+
+template <typename Handler>
+struct Route_t
+{
+    // GET, POST, ... or * for any
+    const char* method;
+
+    // a {name} segment takes any segment but an empty one, which is passed to the handler as the form variable name,
+    // url decoded as a path segment is
+    const char* path;
+
+    Handler handler;
+};
+
+// the segments of a path routed at most, the bits of a mask are those of its {name} segments, the first is bit 1
+static const size_t Route_Segments_Max = 30;
+
+// a table whose routes are not put into distinct slots by so many seeds has two of the same key
+static const unsigned int Route_Seed_Max = 256;
+
+// FNV-1a over the method, a space and the path with {name} segments as {}, so a route and a request filled into it
+// have the same key, the slot is taken by the murmur3 finalizer of the key and the seed
+class RouteHash
+{
+public:
+    static constexpr unsigned int Basis = 2166136261u;
+
+    static constexpr unsigned int Step(unsigned int hash, char ch)
+    {
+        return (hash ^ (unsigned char)ch) * 16777619u;
+    }
+
+    static constexpr unsigned int Text(const char* text, unsigned int hash)
+    {
+        return *text ? Text(text + 1, Step(hash, *text)) : hash;
+    }
+
+    static constexpr unsigned int Path(const char* path, unsigned int hash)
+    {
+        return !*path ? hash
+            : '{' == *path ? Path(SkipParam(path), Step(Step(hash, '{'), '}'))
+            : Path(path + 1, Step(hash, *path));
+    }
+
+    static constexpr unsigned int Key(const char* method, const char* path)
+    {
+        return Path(path, Step(Text(method, Basis), ' '));
+    }
+
+    static constexpr bool SameText(const char* left, const char* right)
+    {
+        return *left != *right ? false : !*left ? true : SameText(left + 1, right + 1);
+    }
+
+    // {name} segments are the same whatever their names, as they are in the key
+    static constexpr bool SamePath(const char* left, const char* right)
+    {
+        return '{' == *left && '{' == *right ? SamePath(SkipParam(left), SkipParam(right))
+            : *left != *right ? false
+            : !*left ? true
+            : SamePath(left + 1, right + 1);
+    }
+
+    static constexpr unsigned int Mask(const char* path, unsigned int segment = 0, unsigned int mask = 0)
+    {
+        return !*path ? mask
+            : '/' == *path ? Mask(path + 1, segment + 1, mask)
+            : '{' == *path ? Mask(path + 1, segment, mask | (1u << segment))
+            : Mask(path + 1, segment, mask);
+    }
+
+    // size is a power of 2
+    static constexpr size_t Slot(unsigned int key, unsigned int seed, size_t size)
+    {
+        return Finalize(key ^ (seed * 0x9e3779b9u)) & (unsigned int)(size - 1);
+    }
+
+    // the slots of count routes, at least the square of it, as a random hash puts them apart then at least by half
+    static constexpr size_t Size(size_t count, size_t size = 16)
+    {
+        return size >= count * count ? size : Size(count, size * 2);
+    }
+
+private:
+    static constexpr const char* SkipParam(const char* path)
+    {
+        return !*path ? path : '}' == *path ? path + 1 : SkipParam(path + 1);
+    }
+
+    static constexpr unsigned int Finalize(unsigned int hash)
+    {
+        return Shift(Multiply(Multiply(hash, 16, 0x85ebca6bu), 13, 0xc2b2ae35u), 16);
+    }
+
+    static constexpr unsigned int Multiply(unsigned int hash, int shift, unsigned int factor)
+    {
+        return Shift(hash, shift) * factor;
+    }
+
+    static constexpr unsigned int Shift(unsigned int hash, int shift)
+    {
+        return hash ^ (hash >> shift);
+    }
+};
+
+template <size_t N>
+struct RouteKeys_t
+{
+    unsigned int keys[N];
+};
+
+template <size_t N>
+struct RouteSlots_t
+{
+    int slots[N];
+};
+
+// the compile time part of RouteTable, apart as its functions are to be defined before the table uses them
+template <typename Routes>
+struct RouteBuild
+{
+    static constexpr size_t Count = sizeof(Routes::table) / sizeof(Routes::table[0]);
+    static constexpr size_t Size = RouteHash::Size(Count);
+
+    template <size_t... I>
+    static constexpr RouteKeys_t<Count> Keys(std::index_sequence<I...>)
+    {
+        return RouteKeys_t<Count>{ { RouteHash::Key(Routes::table[I].method, Routes::table[I].path)... } };
+    }
+
+    static constexpr bool Same(size_t i, size_t j)
+    {
+        return RouteHash::SameText(Routes::table[i].method, Routes::table[j].method) && RouteHash::SamePath(Routes::table[i].path, Routes::table[j].path);
+    }
+
+    // whether the route i has the key of one of the routes from j on, which is of the same method and path or not as same is
+    static constexpr bool SharesKey(const RouteKeys_t<Count>& keys, bool same, size_t i, size_t j)
+    {
+        return j < Count && ((keys.keys[i] == keys.keys[j] && Same(i, j) == same) || SharesKey(keys, same, i, j + 1));
+    }
+
+    static constexpr bool CollidesKey(const RouteKeys_t<Count>& keys, bool same, size_t i = 0)
+    {
+        return i < Count && (SharesKey(keys, same, i, i + 1) || CollidesKey(keys, same, i + 1));
+    }
+
+    // whether the route i is in the slot of one of the routes from j on
+    static constexpr bool Shares(const RouteKeys_t<Count>& keys, unsigned int seed, size_t i, size_t j)
+    {
+        return j < Count && (RouteHash::Slot(keys.keys[i], seed, Size) == RouteHash::Slot(keys.keys[j], seed, Size) || Shares(keys, seed, i, j + 1));
+    }
+
+    static constexpr bool Collides(const RouteKeys_t<Count>& keys, unsigned int seed, size_t i = 0)
+    {
+        return i < Count && (Shares(keys, seed, i, i + 1) || Collides(keys, seed, i + 1));
+    }
+
+    // routes of the same key share a slot whatever the seed, so none is tried for them
+    static constexpr unsigned int Seed(const RouteKeys_t<Count>& keys, unsigned int seed = 0)
+    {
+        return 0 == seed && (CollidesKey(keys, true) || CollidesKey(keys, false)) ? Route_Seed_Max
+            : seed >= Route_Seed_Max || !Collides(keys, seed) ? seed
+            : Seed(keys, seed + 1);
+    }
+
+    // the route in the slot, -1 if none
+    static constexpr int Route(const RouteKeys_t<Count>& keys, unsigned int seed, size_t slot, size_t i = 0)
+    {
+        return i >= Count ? -1 : RouteHash::Slot(keys.keys[i], seed, Size) == slot ? (int)i : Route(keys, seed, slot, i + 1);
+    }
+
+    template <size_t... I>
+    static constexpr RouteSlots_t<Size> Slots(const RouteKeys_t<Count>& keys, unsigned int seed, std::index_sequence<I...>)
+    {
+        return RouteSlots_t<Size>{ { Route(keys, seed, I)... } };
+    }
+};
+
+/*
+* the routes of Routes::table in a perfect hash made at compile time, no two routes share a slot, so a key takes one probe,
+* a request has a key for each distinct mask of the routes of its segment count, with those segments as {name},
+* under its method and under * if routes of the mask have them, so most paths take one probe and the most two,
+* the path is hashed once under each method, a key goes on from the hash of the segments before its first {name}
+*
+* Routes is a struct of static constexpr Route_t<Handler> table[]
+*/
+template <typename Routes>
+class RouteTable
+{
+public:
+    typedef RouteBuild<Routes> Build;
+
+    static constexpr size_t Count = Build::Count;
+    static constexpr size_t Size = Build::Size;
+
+    // the index of the route of the request, -1 if there is none, params takes its {name} segments as name=value&
+    static int Find(const char* method, size_t method_size, const char* uri, size_t uri_size, std::string& params)
+    {
+        if (0 == uri_size || '/' != uri[0])
+        {
+            return -1;
+        }
+
+        // from 1 as in the masks
+        const char* segments[Route_Segments_Max + 1];
+        size_t sizes[Route_Segments_Max + 1];
+        size_t count = 0;
+        for (const char* slash = uri; slash; )
+        {
+            if (count == Route_Segments_Max)
+            {
+                return -1;
+            }
+
+            const char* begin = slash + 1;
+            slash = (const char*)memchr(begin, '/', (size_t)(uri + uri_size - begin));
+
+            ++count;
+            segments[count] = begin;
+            sizes[count] = (size_t)((slash ? slash : uri + uri_size) - begin);
+        }
+
+        // the hash of the path as it is after each segment, under the method and under *, hashed once each is needed
+        unsigned int prefixes[2][Route_Segments_Max + 1];
+        bool hashed[2] = { false, false };
+
+        static const std::vector<Probe_t> probes = Probes();
+        for (const Probe_t& probe : probes)
+        {
+            if (probe.count != count)
+            {
+                continue;
+            }
+
+            for (int any = 0; any < 2; ++any)
+            {
+                if (!(any ? probe.any : probe.method))
+                {
+                    continue;
+                }
+
+                unsigned int* prefix = prefixes[any];
+                if (!hashed[any])
+                {
+                    prefix[0] = RouteHash::Step(any ? RouteHash::Step(RouteHash::Basis, '*') : Hash(RouteHash::Basis, method, method_size), ' ');
+                    for (size_t i = 1; i <= count; ++i)
+                    {
+                        prefix[i] = Hash(RouteHash::Step(prefix[i - 1], '/'), segments[i], sizes[i]);
+                    }
+                    hashed[any] = true;
+                }
+
+                unsigned int key = prefix[probe.first - 1];
+                for (size_t i = probe.first; i <= count; ++i)
+                {
+                    key = RouteHash::Step(key, '/');
+                    key = probe.mask & (1u << i) ? RouteHash::Step(RouteHash::Step(key, '{'), '}') : Hash(key, segments[i], sizes[i]);
+                }
+
+                int route = _slots.slots[RouteHash::Slot(key, _seed, Size)];
+                if (route >= 0 && Matches(Routes::table[route], any ? "*" : method, any ? 1 : method_size, probe.mask, segments, sizes, count, params))
+                {
+                    return route;
+                }
+            }
+        }
+        return -1;
+    }
+
+private:
+    // the routes of a mask and segment count, under a method other than * and under *
+    struct Probe_t
+    {
+        unsigned int mask;
+        size_t count;
+
+        // the first {name} segment, count + 1 for none
+        size_t first;
+
+        bool method;
+        bool any;
+    };
+
+    static unsigned int Hash(unsigned int hash, const char* text, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = RouteHash::Step(hash, text[i]);
+        }
+        return hash;
+    }
+
+    // the distinct masks and segment counts of the routes, the path as it is first
+    static std::vector<Probe_t> Probes()
+    {
+        std::vector<Probe_t> probes;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const char* path = Routes::table[i].path;
+            unsigned int mask = RouteHash::Mask(path);
+            size_t count = (size_t)std::count(path, path + strlen(path), '/');
+            bool any = 0 == strcmp(Routes::table[i].method, "*");
+
+            typename std::vector<Probe_t>::iterator found = probes.begin();
+            while (found != probes.end() && (found->mask != mask || found->count != count))
+            {
+                ++found;
+            }
+            if (found == probes.end())
+            {
+                size_t first = 1;
+                while (first <= count && !(mask & (1u << first)))
+                {
+                    ++first;
+                }
+
+                Probe_t probe = { mask, count, first, false, false };
+                found = probes.insert(probes.end(), probe);
+            }
+            (any ? found->any : found->method) = true;
+        }
+
+        std::sort(probes.begin(), probes.end(), [](const Probe_t& left, const Probe_t& right) { return left.mask < right.mask; });
+        return probes;
+    }
+
+    // the form value of a {name} segment, decoded as a path segment and escaped again where a form variable would not be
+    static bool AppendParam(std::string& filled, const char* segment, size_t size)
+    {
+        std::vector<char> decoded(size + 1);
+        int decoded_size = mg_url_decode(segment, (int)size, decoded.data(), (int)decoded.size(), 0);
+        if (decoded_size <= 0)
+        {
+            return false;
+        }
+
+        static const char hex[] = "0123456789ABCDEF";
+        for (int i = 0; i < decoded_size; ++i)
+        {
+            unsigned char ch = (unsigned char)decoded[i];
+            if (ch < 0x20 || '%' == ch || '+' == ch || '&' == ch || '=' == ch)
+            {
+                filled.append(1, '%').append(1, hex[ch >> 4]).append(1, hex[ch & 0x0F]);
+            }
+            else
+            {
+                filled.append(1, (char)ch);
+            }
+        }
+        return true;
+    }
+
+    // a key is shared by paths of other segments, so they are compared once the slot is found
+    template <typename Route>
+    static bool Matches(const Route& route, const char* method, size_t method_size, unsigned int mask, const char** segments, const size_t* sizes, size_t count, std::string& params)
+    {
+        if (strlen(route.method) != method_size || 0 != memcmp(route.method, method, method_size) || RouteHash::Mask(route.path) != mask)
+        {
+            return false;
+        }
+
+        std::string filled;
+        const char* pattern = route.path;
+        for (size_t i = 1; i <= count; ++i)
+        {
+            if ('/' != *pattern)
+            {
+                return false;
+            }
+            ++pattern;
+
+            const char* end = strchr(pattern, '/');
+            size_t size = end ? (size_t)(end - pattern) : strlen(pattern);
+            if (mask & (1u << i))
+            {
+                if (0 == sizes[i])
+                {
+                    return false;
+                }
+
+                filled.append(pattern + 1, size - 2).append(1, '=');
+                if (!AppendParam(filled, segments[i], sizes[i]))
+                {
+                    return false;
+                }
+                filled.append(1, '&');
+            }
+            else if (size != sizes[i] || 0 != memcmp(pattern, segments[i], size))
+            {
+                return false;
+            }
+            pattern += size;
+        }
+        if (*pattern)
+        {
+            return false;
+        }
+
+        params.swap(filled);
+        return true;
+    }
+
+private:
+    static constexpr RouteKeys_t<Count> _keys = Build::Keys(std::make_index_sequence<Count>());
+    static constexpr unsigned int _seed = Build::Seed(_keys);
+    static_assert(!Build::CollidesKey(_keys, true), "two routes have the same method and path");
+    static_assert(!Build::CollidesKey(_keys, false), "two routes of different methods or paths have the same key, change the path of one");
+    static_assert(_seed < Route_Seed_Max, "no seed puts the routes into distinct slots, two have the same method and path or the same key");
+
+    static constexpr RouteSlots_t<Size> _slots = Build::Slots(_keys, _seed, std::make_index_sequence<Size>());
+
+private:
+    RouteTable();
+};
+
+template <typename Routes>
+constexpr RouteKeys_t<RouteTable<Routes>::Count> RouteTable<Routes>::_keys;
+
+template <typename Routes>
+constexpr unsigned int RouteTable<Routes>::_seed;
+
+template <typename Routes>
+constexpr RouteSlots_t<RouteTable<Routes>::Size> RouteTable<Routes>::_slots;
+
+#endif
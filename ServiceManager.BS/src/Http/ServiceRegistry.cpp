@@ -0,0 +1,48 @@
+
+#include "Http/ServiceRegistry.h"
+
+#include <mutex>
+#include <unordered_set>
+
+// the strings are added by the poll thread and the loaders of the files, and looked up by the workers too
+static std::mutex& GetInternLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+// a node of the set keeps its address while others are added
+static std::unordered_set<std::string>& GetInternPool()
+{
+    static std::unordered_set<std::string> pool;
+    return pool;
+}
+
+const std::string& InternedString::Empty()
+{
+    static const std::string empty;
+    return empty;
+}
+
+const std::string* InternedString::Intern(const std::string& text)
+{
+    if (text.empty())
+    {
+        return &Empty();
+    }
+
+    std::lock_guard<std::mutex> guard(GetInternLock());
+    return &*GetInternPool().insert(text).first;
+}
+
+const std::string* InternedString::Find(const std::string& text)
+{
+    if (text.empty())
+    {
+        return &Empty();
+    }
+
+    std::lock_guard<std::mutex> guard(GetInternLock());
+    std::unordered_set<std::string>::const_iterator found = GetInternPool().find(text);
+    return GetInternPool().end() == found ? nullptr : &*found;
+}
@@ -0,0 +1,336 @@
+#ifndef _SERVICE_REGISTRY_HEADER_H_
+#define _SERVICE_REGISTRY_HEADER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <ostream>
+
+#include <stddef.h>
+
+/*
+* a string kept once in a pool of the process, which the services of a definition share for their id and library path,
+* a copy is a pointer and two are equal if their pointers are
+*
+* the pool is never shrunk, so only the strings of the definitions are interned, which are few,
+* the name, config and log options of an instance are not, as each is of its own and is taken from requests before they are validated
+*/
+class InternedString
+{
+public:
+    InternedString()
+        : _text(&Empty())
+    {
+    }
+
+    InternedString(const std::string& text)
+        : _text(Intern(text))
+    {
+    }
+
+    InternedString(const char* text)
+        : _text(Intern(text))
+    {
+    }
+
+    InternedString& operator=(const std::string& text)
+    {
+        _text = Intern(text);
+        return *this;
+    }
+
+    InternedString& operator=(const char* text)
+    {
+        _text = Intern(text);
+        return *this;
+    }
+
+    const std::string& str() const
+    {
+        return *_text;
+    }
+
+    operator const std::string&() const
+    {
+        return *_text;
+    }
+
+    const char* c_str() const
+    {
+        return _text->c_str();
+    }
+
+    size_t size() const
+    {
+        return _text->size();
+    }
+
+    bool empty() const
+    {
+        return _text->empty();
+    }
+
+    // the key of the string in an index
+    const std::string* Key() const
+    {
+        return _text;
+    }
+
+    // the key of text if it is interned, nullptr if not, so a lookup does not grow the pool
+    static const std::string* Find(const std::string& text);
+
+private:
+    static const std::string& Empty();
+    static const std::string* Intern(const std::string& text);
+
+private:
+    const std::string* _text;
+};
+
+inline bool operator==(const InternedString& left, const InternedString& right)
+{
+    return left.Key() == right.Key();
+}
+
+inline bool operator==(const InternedString& left, const std::string& right)
+{
+    return left.str() == right;
+}
+
+inline bool operator==(const std::string& left, const InternedString& right)
+{
+    return left == right.str();
+}
+
+inline bool operator==(const InternedString& left, const char* right)
+{
+    return left.str() == right;
+}
+
+inline bool operator==(const char* left, const InternedString& right)
+{
+    return left == right.str();
+}
+
+inline bool operator!=(const InternedString& left, const InternedString& right)
+{
+    return !(left == right);
+}
+
+inline bool operator!=(const InternedString& left, const std::string& right)
+{
+    return !(left == right);
+}
+
+inline bool operator!=(const InternedString& left, const char* right)
+{
+    return !(left == right);
+}
+
+inline std::string operator+(const InternedString& left, const std::string& right)
+{
+    return left.str() + right;
+}
+
+inline std::string operator+(const InternedString& left, const char* right)
+{
+    return left.str() + right;
+}
+
+inline std::string operator+(const std::string& left, const InternedString& right)
+{
+    return left + right.str();
+}
+
+inline std::string operator+(const char* left, const InternedString& right)
+{
+    return left + right.str();
+}
+
+inline std::ostream& operator<<(std::ostream& os, const InternedString& text)
+{
+    return os << text.str();
+}
+
+// how a registry indexes its key, an interned one by its pointer, a string by its hash
+template <typename Key>
+struct ServiceRegistryKey;
+
+template <>
+struct ServiceRegistryKey<InternedString>
+{
+    typedef const std::string* Index_t;
+
+    static Index_t Of(const InternedString& key)
+    {
+        return key.Key();
+    }
+
+    // a text which is not interned is the key of no record, the lookup does not grow the pool
+    template <typename Map>
+    static typename Map::const_iterator Find(const Map& map, const std::string& text)
+    {
+        const std::string* interned = InternedString::Find(text);
+        return nullptr == interned ? map.end() : map.find(interned);
+    }
+};
+
+template <>
+struct ServiceRegistryKey<std::string>
+{
+    typedef std::string Index_t;
+
+    static const std::string& Of(const std::string& key)
+    {
+        return key;
+    }
+
+    template <typename Map>
+    static typename Map::const_iterator Find(const Map& map, const std::string& text)
+    {
+        return map.find(text);
+    }
+};
+
+/*
+* the services in the order they are added, contiguous so a walk over them is over the records, indexed by the key the
+* registry is made with, the name of an instance or the id of a definition, and by the id of the definition of each
+*
+* Record has InternedString id and a Key member, the key and the id of a record are not to be changed but by Erase and Add
+*/
+template <typename Record, typename Key>
+class ServiceRegistry
+{
+public:
+    typedef Key Record::* Key_t;
+
+    typedef typename std::vector<Record>::iterator iterator;
+    typedef typename std::vector<Record>::const_iterator const_iterator;
+
+    explicit ServiceRegistry(Key_t key)
+        : _key(key), _records(), _by_key(), _by_id()
+    {
+    }
+
+    iterator begin()
+    {
+        return _records.begin();
+    }
+
+    iterator end()
+    {
+        return _records.end();
+    }
+
+    const_iterator begin() const
+    {
+        return _records.begin();
+    }
+
+    const_iterator end() const
+    {
+        return _records.end();
+    }
+
+    size_t size() const
+    {
+        return _records.size();
+    }
+
+    bool empty() const
+    {
+        return _records.empty();
+    }
+
+    // the record of the key, nullptr if none, valid until the registry is changed
+    Record* Find(const std::string& key)
+    {
+        return const_cast<Record*>(static_cast<const ServiceRegistry*>(this)->Find(key));
+    }
+
+    const Record* Find(const std::string& key) const
+    {
+        typename KeyIndex_t::const_iterator found = ServiceRegistryKey<Key>::Find(_by_key, key);
+        return _by_key.end() == found ? nullptr : &_records[found->second];
+    }
+
+    // the records of the definitions of ids, in the order they are added
+    template <typename Ids>
+    std::vector<const Record*> FindOfDefinitions(const Ids& ids) const
+    {
+        std::vector<size_t> positions;
+        for (const std::string& id : ids)
+        {
+            const std::string* interned = InternedString::Find(id);
+            typename std::unordered_map<const std::string*, std::vector<size_t>>::const_iterator found = interned ? _by_id.find(interned) : _by_id.end();
+            if (_by_id.end() != found)
+            {
+                positions.insert(positions.end(), found->second.begin(), found->second.end());
+            }
+        }
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+        std::vector<const Record*> records;
+        records.reserve(positions.size());
+        for (size_t position : positions)
+        {
+            records.push_back(&_records[position]);
+        }
+        return records;
+    }
+
+    // false if the key is taken
+    bool Add(const Record& record)
+    {
+        if (_by_key.count(ServiceRegistryKey<Key>::Of(record.*_key)))
+        {
+            return false;
+        }
+
+        _records.push_back(record);
+        index(_records.size() - 1);
+        return true;
+    }
+
+    // false if there is no record of the key
+    bool Erase(const std::string& key)
+    {
+        const Record* found = Find(key);
+        if (nullptr == found)
+        {
+            return false;
+        }
+
+        // the records after it move down, the positions are indexed again
+        _records.erase(_records.begin() + (found - _records.data()));
+        _by_key.clear();
+        _by_id.clear();
+        for (size_t i = 0; i < _records.size(); ++i)
+        {
+            index(i);
+        }
+        return true;
+    }
+
+private:
+    void index(size_t position)
+    {
+        const Record& record = _records[position];
+        _by_key[ServiceRegistryKey<Key>::Of(record.*_key)] = position;
+        _by_id[record.id.Key()].push_back(position);
+    }
+
+private:
+    typedef std::unordered_map<typename ServiceRegistryKey<Key>::Index_t, size_t> KeyIndex_t;
+
+    Key_t _key;
+
+    std::vector<Record> _records;
+
+    KeyIndex_t _by_key;
+    std::unordered_map<const std::string*, std::vector<size_t>> _by_id;
+};
+
+#endif
@@ -0,0 +1,382 @@
+
+#include <windows.h>
+
+#include <stdio.h>
+
+#include "Http/StaticAssetCache.h"
+
+#include "archive.h"
+#include "archive_entry.h"
+
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+// larger files are rare in the web ui, they are served from the disk
+static const unsigned long long Static_Asset_Max = 8 * 1024 * 1024;
+
+// smaller files are sent as they are
+static const size_t Static_Encode_Min = 256;
+
+// a copy of the directory signals many changes, the files are loaded once it has been quiet so long
+static const DWORD Static_Settle_Ms = 500;
+
+// the pages are revalidated each time, the rest is taken from the browser cache for a while
+static const char* Static_Cache_Page = "no-cache";
+static const char* Static_Cache_Asset = "max-age=3600";
+
+struct StaticType_t
+{
+    const char* extension;
+    const char* content_type;
+    bool compressible;
+};
+
+static const StaticType_t Static_Types[] = {
+    { ".html", "text/html; charset=utf-8", true },
+    { ".htm", "text/html; charset=utf-8", true },
+    { ".css", "text/css; charset=utf-8", true },
+    { ".js", "application/javascript; charset=utf-8", true },
+    { ".json", "application/json; charset=utf-8", true },
+    { ".map", "application/json; charset=utf-8", true },
+    { ".txt", "text/plain; charset=utf-8", true },
+    { ".xml", "application/xml; charset=utf-8", true },
+    { ".svg", "image/svg+xml", true },
+    { ".ico", "image/x-icon", true },
+    { ".ttf", "font/ttf", true },
+    { ".otf", "font/otf", true },
+    { ".eot", "application/vnd.ms-fontobject", true },
+    { ".woff", "font/woff", false },
+    { ".woff2", "font/woff2", false },
+    { ".png", "image/png", false },
+    { ".jpg", "image/jpeg", false },
+    { ".jpeg", "image/jpeg", false },
+    { ".gif", "image/gif", false },
+};
+
+static const StaticType_t* GetStaticType(const std::string& relative)
+{
+    std::string::size_type dot = relative.rfind('.');
+    if (std::string::npos == dot || relative.find_first_of("\\/", dot) != std::string::npos)
+    {
+        return nullptr;
+    }
+
+    std::string extension = relative.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    for (const StaticType_t& type : Static_Types)
+    {
+        if (extension == type.extension)
+        {
+            return &type;
+        }
+    }
+    return nullptr;
+}
+
+// FNV-1a
+static unsigned long long GetContentHash(const std::string& content)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char ch : content)
+    {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+StaticAssetCache::StaticAssetCache(const std::string& directory, const std::shared_ptr<spdlog::logger>& log)
+    : _directory(directory), _logger(log)
+    , _zstd(false)
+    , _lock(), _snapshot(std::make_shared<StaticAssets_t>())
+    , _running(false), _stop_event(NULL), _watcher()
+{
+    if (!_directory.empty() && '\\' != _directory.back() && '/' != _directory.back())
+    {
+        _directory += '\\';
+    }
+}
+
+StaticAssetCache::~StaticAssetCache()
+{
+    Stop();
+}
+
+void StaticAssetCache::Start()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_running)
+    {
+        return;
+    }
+
+    // zstd is optional in libarchive builds, the browsers take gzip then
+    struct archive* aw = archive_write_new();
+    _zstd = archive_write_add_filter_zstd(aw) == ARCHIVE_OK;
+    archive_write_free(aw);
+
+    _stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (NULL == _stop_event)
+    {
+        _logger->warn("static assets of {} are not cached: {}", _directory.c_str(), GetLastError());
+        return;
+    }
+
+    _running = true;
+    _watcher = std::thread(&StaticAssetCache::watch_routine, this);
+}
+
+void StaticAssetCache::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_running)
+        {
+            return;
+        }
+        _running = false;
+    }
+    SetEvent((HANDLE)_stop_event);
+
+    if (_watcher.joinable())
+    {
+        _watcher.join();
+    }
+
+    CloseHandle((HANDLE)_stop_event);
+    _stop_event = NULL;
+}
+
+StaticAssetsSnapshot StaticAssetCache::Snapshot() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _snapshot;
+}
+
+void StaticAssetCache::View(const StaticAsset_t& asset, StaticContent_t& content)
+{
+    content.content_type = asset.content_type.c_str();
+    content.cache_control = asset.cache_control.c_str();
+    for (int i = Static_Identity; i < Static_Encodings; ++i)
+    {
+        bool present = Static_Identity == i || !asset.encoded[i].empty();
+        content.data[i] = present ? asset.encoded[i].data() : nullptr;
+        content.size[i] = present ? asset.encoded[i].size() : 0;
+        content.etag[i] = present ? asset.etag[i].c_str() : nullptr;
+    }
+}
+
+void StaticAssetCache::watch_routine()
+{
+    // watched before the first load so that a change meanwhile loads the files again
+    HANDLE change = FindFirstChangeNotification(_directory.c_str(), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (INVALID_HANDLE_VALUE == change)
+    {
+        _logger->warn("static assets of {} are not watched, they are loaded once: {}", _directory.c_str(), GetLastError());
+    }
+
+    HANDLE handles[2] = { (HANDLE)_stop_event, change };
+    DWORD waited = WAIT_TIMEOUT;
+    do
+    {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        std::shared_ptr<StaticAssets_t> assets = load_assets();
+        long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            assets->version = _snapshot->version + 1;
+            _snapshot = assets;
+        }
+        _logger->info("static assets of {} loaded, {} files of {} bytes in {} ms", _directory.c_str(), assets->assets.size(), assets->bytes, elapsed);
+
+        if (INVALID_HANDLE_VALUE == change)
+        {
+            break;
+        }
+
+        waited = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+        while (WAIT_OBJECT_0 + 1 == waited)
+        {
+            if (!FindNextChangeNotification(change))
+            {
+                _logger->warn("static assets of {} are not watched any more: {}", _directory.c_str(), GetLastError());
+                waited = WAIT_FAILED;
+                break;
+            }
+            waited = WaitForMultipleObjects(2, handles, FALSE, Static_Settle_Ms);
+        }
+    } while (WAIT_TIMEOUT == waited);
+
+    if (INVALID_HANDLE_VALUE != change)
+    {
+        FindCloseChangeNotification(change);
+    }
+}
+
+std::shared_ptr<StaticAssets_t> StaticAssetCache::load_assets()
+{
+    std::shared_ptr<StaticAssets_t> assets = std::make_shared<StaticAssets_t>();
+    load_directory("", *assets);
+    return assets;
+}
+
+void StaticAssetCache::load_directory(const std::string& relative, StaticAssets_t& assets)
+{
+    WIN32_FIND_DATA ffd;
+
+    std::string pattern_all = _directory + relative + "*";
+    HANDLE hFind = FindFirstFile(pattern_all.c_str(), &ffd);
+    if (INVALID_HANDLE_VALUE == hFind)
+    {
+        return;
+    }
+
+    do
+    {
+        if (strcmp(ffd.cFileName, ".") == 0 || strcmp(ffd.cFileName, "..") == 0)
+        {
+            continue;
+        }
+
+        std::string name = relative + ffd.cFileName;
+        if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            load_directory(name + "\\", assets);
+            continue;
+        }
+
+        unsigned long long size = ((unsigned long long)ffd.nFileSizeHigh << 32) | ffd.nFileSizeLow;
+        if (size > Static_Asset_Max)
+        {
+            continue;
+        }
+
+        StaticAsset_t asset;
+        if (!load_asset(name, size, asset))
+        {
+            continue;
+        }
+
+        std::string path = "/" + name;
+        std::replace(path.begin(), path.end(), '\\', '/');
+
+        for (const std::string& encoded : asset.encoded)
+        {
+            assets.bytes += encoded.size();
+        }
+        assets.assets[path] = std::move(asset);
+    } while (FindNextFile(hFind, &ffd) != 0);
+
+    FindClose(hFind);
+}
+
+bool StaticAssetCache::load_asset(const std::string& relative, unsigned long long size, StaticAsset_t& asset)
+{
+    const StaticType_t* type = GetStaticType(relative);
+    if (nullptr == type)
+    {
+        return false;
+    }
+
+    std::string file = _directory + relative;
+    FILE* in = fopen(file.c_str(), "rb");
+    if (NULL == in)
+    {
+        return false;
+    }
+
+    std::string& identity = asset.encoded[Static_Identity];
+    identity.resize((size_t)size);
+    bool loaded = 0 == size || fread(&identity[0], 1, (size_t)size, in) == (size_t)size;
+    fclose(in);
+    if (!loaded)
+    {
+        _logger->warn("static asset({}) is not loaded", file.c_str());
+        return false;
+    }
+
+    asset.content_type = type->content_type;
+    asset.cache_control = 0 == strncmp(type->content_type, "text/html", 9) ? Static_Cache_Page : Static_Cache_Asset;
+
+    if (type->compressible && identity.size() >= Static_Encode_Min)
+    {
+        // an encoding is kept when it is a tenth smaller at least
+        size_t worth = identity.size() - identity.size() / 10;
+        if (!encode(identity, false, asset.encoded[Static_Gzip]) || asset.encoded[Static_Gzip].size() > worth)
+        {
+            asset.encoded[Static_Gzip].clear();
+        }
+        if (!_zstd || !encode(identity, true, asset.encoded[Static_Zstd]) || asset.encoded[Static_Zstd].size() > worth)
+        {
+            asset.encoded[Static_Zstd].clear();
+        }
+    }
+
+    static const char* suffixes[Static_Encodings] = { "", "-gz", "-zst" };
+    unsigned long long hash = GetContentHash(identity);
+    for (int i = Static_Identity; i < Static_Encodings; ++i)
+    {
+        if (Static_Identity == i || !asset.encoded[i].empty())
+        {
+            char etag[48] = { 0 };
+            snprintf(etag, sizeof(etag), "\"%016llx%s\"", hash, suffixes[i]);
+            asset.etag[i] = etag;
+        }
+    }
+    return true;
+}
+
+bool StaticAssetCache::encode(const std::string& content, bool zstd, std::string& encoded)
+{
+    // the encoding is not kept once it is not smaller, so the buffer takes the content and the framing
+    std::vector<char> buffer(content.size() + 1024);
+    size_t used = 0;
+
+    struct archive* aw = archive_write_new();
+    struct archive_entry* entry = archive_entry_new();
+
+    bool succeed = false;
+    do
+    {
+        int r = zstd ? archive_write_add_filter_zstd(aw) : archive_write_add_filter_gzip(aw);
+        if (r != ARCHIVE_OK || archive_write_set_format_raw(aw) != ARCHIVE_OK)
+        {
+            break;
+        }
+        archive_write_set_bytes_in_last_block(aw, 1);
+
+        // encoded once for every request, so the best level is worth its time
+        archive_write_set_filter_option(aw, NULL, "compression-level", zstd ? "19" : "9");
+
+        if (archive_write_open_memory(aw, buffer.data(), buffer.size(), &used) != ARCHIVE_OK)
+        {
+            break;
+        }
+
+        archive_entry_set_pathname(entry, "asset");
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        if (archive_write_header(aw, entry) != ARCHIVE_OK)
+        {
+            break;
+        }
+
+        if (!content.empty() && archive_write_data(aw, content.data(), content.size()) < 0)
+        {
+            break;
+        }
+
+        succeed = archive_write_close(aw) == ARCHIVE_OK;
+    } while (false);
+
+    archive_entry_free(entry);
+    archive_write_free(aw);
+
+    if (succeed)
+    {
+        encoded.assign(buffer.data(), used);
+    }
+    return succeed;
+}
@@ -0,0 +1,105 @@
+#ifndef _STATIC_ASSET_CACHE_HEADER_H_
+#define _STATIC_ASSET_CACHE_HEADER_H_
+
+#include "spdlog/logging.h"
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+
+enum StaticEncoding_t
+{
+    Static_Identity = 0,
+    Static_Gzip,
+    Static_Zstd,
+    Static_Encodings
+};
+
+struct StaticAsset_t
+{
+    std::string content_type;
+    std::string cache_control;
+
+    // the content and its encodings, an encoding is empty when it does not save enough
+    std::string encoded[Static_Encodings];
+
+    // strong, of the content, those of the encodings have the coding appended
+    std::string etag[Static_Encodings];
+};
+
+// an asset as it is sent, of a snapshot or packed into the manager, the encodings absent are nullptr
+struct StaticContent_t
+{
+    const char* content_type;
+    const char* cache_control;
+    const char* data[Static_Encodings];
+    size_t size[Static_Encodings];
+    const char* etag[Static_Encodings];
+};
+
+// by the path of the url, /css/app.css
+typedef std::unordered_map<std::string, StaticAsset_t> StaticAssetMap_t;
+
+struct StaticAssets_t
+{
+    unsigned long long version = 0;
+    unsigned long long bytes = 0;
+    StaticAssetMap_t assets;
+};
+
+typedef std::shared_ptr<const StaticAssets_t> StaticAssetsSnapshot;
+
+/*
+* the files under the http directory in memory with their gzip and zstd encodings, loaded on a background thread and
+* loaded again once the files under the directory are changed, readers take the latest immutable snapshot, which
+* is empty until the first load is done
+*
+* a file larger than Static_Asset_Max is left to be served from the disk
+*/
+class StaticAssetCache
+{
+public:
+    StaticAssetCache(const std::string& directory, const std::shared_ptr<spdlog::logger>& log);
+    ~StaticAssetCache();
+
+    void Start();
+    void Stop();
+
+    StaticAssetsSnapshot Snapshot() const;
+
+    // the content points into the asset, which is kept by its snapshot
+    static void View(const StaticAsset_t& asset, StaticContent_t& content);
+
+private:
+    void watch_routine();
+
+    std::shared_ptr<StaticAssets_t> load_assets();
+    void load_directory(const std::string& relative, StaticAssets_t& assets);
+    bool load_asset(const std::string& relative, unsigned long long size, StaticAsset_t& asset);
+
+    // the content encoded by the filter of libarchive, false if it fails
+    static bool encode(const std::string& content, bool zstd, std::string& encoded);
+
+private:
+    std::string _directory;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    bool _zstd;
+
+private:
+    mutable std::mutex _lock;
+    StaticAssetsSnapshot _snapshot;
+
+    bool _running;
+    void* _stop_event;
+    std::thread _watcher;
+
+private:
+    StaticAssetCache();
+    StaticAssetCache(const StaticAssetCache&);
+    StaticAssetCache& operator=(const StaticAssetCache&);
+};
+
+#endif
@@ -0,0 +1,416 @@
+
+#include <windows.h>
+
+#include <stdio.h>
+
+#include "Log/LogArchiver.h"
+
+#include "archive.h"
+#include "archive_entry.h"
+
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <regex>
+
+// rotations are rare, a retired log waits for the next scan
+static const std::chrono::seconds Log_Archive_Interval(30);
+static const size_t Log_Archive_Chunk = 64 * 1024;
+
+// <stem>.<N>.log of the rotating sinks, <stem>_<yyyy-mm-dd>.log of the daily sinks and the moved rotated logs
+static const std::regex Log_Rotated_Pattern("^(.+)\\.(\\d+)\\.(log|blog)$");
+static const std::regex Log_Daily_Pattern("^(.+)_(\\d{4}-\\d{2}-\\d{2})\\.(log|blog)$");
+static const std::regex Log_Moved_Pattern("^(.+)\\.(\\d{8}-\\d{6}-\\d{3})\\.(log|blog)$");
+static const std::regex Log_Archived_Pattern("^(.+)(\\.\\d{8}-\\d{6}-\\d{3}|_\\d{4}-\\d{2}-\\d{2})\\.(log|blog)\\.(gz|zst)$");
+
+static std::vector<std::string> ListFiles(const std::string& path)
+{
+    std::vector<std::string> names;
+
+    WIN32_FIND_DATA ffd;
+
+    std::string pattern_all = path + "*.*";
+    HANDLE hFind = FindFirstFile(pattern_all.c_str(), &ffd);
+    if (INVALID_HANDLE_VALUE == hFind)
+    {
+        return names;
+    }
+
+    do
+    {
+        if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            names.push_back(ffd.cFileName);
+        }
+    } while (FindNextFile(hFind, &ffd) != 0);
+
+    FindClose(hFind);
+
+    return names;
+}
+
+// yyyymmdd-hhmmss-mmm of the last write in local time as the daily sinks name their files
+static bool GetLastWriteStamp(const std::string& file, std::string& stamp)
+{
+    WIN32_FIND_DATA ffd;
+    HANDLE hFind = FindFirstFile(file.c_str(), &ffd);
+    if (INVALID_HANDLE_VALUE == hFind)
+    {
+        return false;
+    }
+    FindClose(hFind);
+
+    FILETIME local_time;
+    SYSTEMTIME system_time;
+    if (!FileTimeToLocalFileTime(&ffd.ftLastWriteTime, &local_time) || !FileTimeToSystemTime(&local_time, &system_time))
+    {
+        return false;
+    }
+
+    char buffer[32] = { 0 };
+    snprintf(buffer, sizeof(buffer), "%04d%02d%02d-%02d%02d%02d-%03d", system_time.wYear, system_time.wMonth, system_time.wDay, system_time.wHour, system_time.wMinute, system_time.wSecond, system_time.wMilliseconds);
+    stamp = buffer;
+    return true;
+}
+
+static std::string GetToday()
+{
+    SYSTEMTIME system_time;
+    GetLocalTime(&system_time);
+
+    char buffer[16] = { 0 };
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", system_time.wYear, system_time.wMonth, system_time.wDay);
+    return buffer;
+}
+
+LogArchiver::LogArchiver(const std::string& log_path, const std::string& codec, int rate_kb, int keep, const std::shared_ptr<spdlog::logger>& log)
+    : _log_path(log_path), _codec(codec), _rate_kb(rate_kb), _keep(keep)
+    , _logger(log)
+    , _compressed(0)
+    , _lock(), _wakeup()
+    , _running(false), _archiver()
+{
+}
+
+LogArchiver::~LogArchiver()
+{
+    Stop();
+}
+
+bool LogArchiver::IsCodecValid(const std::string& codec)
+{
+    return "off" == codec || "gzip" == codec || "zstd" == codec;
+}
+
+void LogArchiver::Start()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_running || "off" == _codec)
+    {
+        return;
+    }
+
+    // zstd is optional in libarchive builds, an external zstd program is not run either
+    if ("zstd" == _codec)
+    {
+        struct archive* aw = archive_write_new();
+        if (archive_write_add_filter_zstd(aw) != ARCHIVE_OK)
+        {
+            _logger->warn("zstd is not supported by libarchive, rotated logs are compressed with gzip");
+            _codec = "gzip";
+        }
+        archive_write_free(aw);
+    }
+
+    _running = true;
+    _archiver = std::thread(&LogArchiver::archive_routine, this);
+}
+
+void LogArchiver::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_running)
+        {
+            return;
+        }
+        _running = false;
+    }
+    _wakeup.notify_all();
+
+    if (_archiver.joinable())
+    {
+        _archiver.join();
+    }
+
+    _logger->info("log archiver stopped, {} logs compressed", (unsigned long long)_compressed);
+}
+
+bool LogArchiver::ReadLog(const std::string& file, const std::function<bool(const char*, size_t)>& reader)
+{
+    struct archive* ar = archive_read_new();
+    if (nullptr == ar)
+    {
+        return false;
+    }
+
+    // the raw format reads a plain log through the none filter as well
+    archive_read_support_filter_all(ar);
+    archive_read_support_format_raw(ar);
+    archive_read_support_format_empty(ar);
+
+    bool succeed = false;
+    do
+    {
+        if (archive_read_open_filename(ar, file.c_str(), Log_Archive_Chunk) != ARCHIVE_OK)
+        {
+            break;
+        }
+
+        struct archive_entry* entry = nullptr;
+        int r = archive_read_next_header(ar, &entry);
+        if (ARCHIVE_EOF == r)
+        {
+            succeed = true;
+            break;
+        }
+        if (r != ARCHIVE_OK)
+        {
+            break;
+        }
+
+        std::vector<char> buffer(Log_Archive_Chunk);
+        la_ssize_t size = 0;
+        while ((size = archive_read_data(ar, buffer.data(), buffer.size())) > 0)
+        {
+            if (!reader(buffer.data(), (size_t)size))
+            {
+                break;
+            }
+        }
+        succeed = (size >= 0);
+    } while (false);
+
+    archive_read_free(ar);
+
+    return succeed;
+}
+
+void LogArchiver::archive_routine()
+{
+    // below the services in both cpu and disk
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    std::unique_lock<std::mutex> guard(_lock);
+    while (_running)
+    {
+        guard.unlock();
+
+        archive_logs();
+        remove_expired();
+
+        guard.lock();
+        _wakeup.wait_for(guard, Log_Archive_Interval, [this]() { return !_running; });
+    }
+}
+
+void LogArchiver::archive_logs()
+{
+    std::string today = GetToday();
+    std::string extension = "zstd" == _codec ? ".zst" : ".gz";
+
+    std::vector<std::string> names = ListFiles(_log_path);
+    for (std::string& name : names)
+    {
+        std::smatch matched;
+        if (std::regex_match(name, matched, Log_Rotated_Pattern))
+        {
+            // moved away from the indexes the sink rotates, a log being rotated right now fails and waits
+            std::string stamp;
+            if (!GetLastWriteStamp(_log_path + name, stamp))
+            {
+                continue;
+            }
+
+            std::string moved = matched[1].str() + "." + stamp + "." + matched[3].str();
+            if (!MoveFileEx((_log_path + name).c_str(), (_log_path + moved).c_str(), 0))
+            {
+                continue;
+            }
+            DeleteFile((_log_path + name + ".idx").c_str());
+            name = moved;
+        }
+        else if (std::regex_match(name, matched, Log_Daily_Pattern))
+        {
+            if (matched[2].str() == today)
+            {
+                continue;
+            }
+        }
+        else if (!std::regex_match(name, Log_Moved_Pattern))
+        {
+            continue;
+        }
+
+        if (!compress_log(_log_path + name, _log_path + name + extension))
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (!_running)
+            {
+                return;
+            }
+            continue;
+        }
+
+        // a daily sink removing its oldest log finds it gone, which it takes as removed
+        if (!DeleteFile((_log_path + name).c_str()))
+        {
+            _logger->warn("remove compressed log({}) failed: {}", name.c_str(), GetLastError());
+        }
+
+        // the time index of the manager, a compressed log is read through
+        DeleteFile((_log_path + name + ".idx").c_str());
+        ++_compressed;
+    }
+}
+
+bool LogArchiver::compress_log(const std::string& file, const std::string& archived)
+{
+    FILE* in = fopen(file.c_str(), "rb");
+    if (NULL == in)
+    {
+        return false;
+    }
+
+    std::string tmp = archived + ".tmp";
+
+    struct archive* aw = archive_write_new();
+    struct archive_entry* entry = archive_entry_new();
+
+    bool succeed = false;
+    do
+    {
+        int r = "zstd" == _codec ? archive_write_add_filter_zstd(aw) : archive_write_add_filter_gzip(aw);
+        if (r != ARCHIVE_OK || archive_write_set_format_raw(aw) != ARCHIVE_OK)
+        {
+            _logger->error("compress log({}) failed: {}", file.c_str(), archive_error_string(aw));
+            break;
+        }
+        archive_write_set_bytes_in_last_block(aw, 1);
+
+        if (archive_write_open_filename(aw, tmp.c_str()) != ARCHIVE_OK)
+        {
+            _logger->error("compress log({}) failed: {}", file.c_str(), archive_error_string(aw));
+            break;
+        }
+
+        archive_entry_set_pathname(entry, file.substr(_log_path.size()).c_str());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        if (archive_write_header(aw, entry) != ARCHIVE_OK)
+        {
+            _logger->error("compress log({}) failed: {}", file.c_str(), archive_error_string(aw));
+            break;
+        }
+
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        unsigned long long bytes = 0;
+
+        std::vector<char> buffer(Log_Archive_Chunk);
+        size_t size = 0;
+        bool stopped = false;
+        while ((size = fread(buffer.data(), 1, buffer.size(), in)) > 0)
+        {
+            if (archive_write_data(aw, buffer.data(), size) < 0)
+            {
+                break;
+            }
+
+            bytes += size;
+            if (!throttle(started, bytes))
+            {
+                stopped = true;
+                break;
+            }
+        }
+
+        if (stopped || ferror(in) || !feof(in))
+        {
+            break;
+        }
+
+        succeed = archive_write_close(aw) == ARCHIVE_OK;
+        if (!succeed)
+        {
+            _logger->error("compress log({}) failed: {}", file.c_str(), archive_error_string(aw));
+        }
+    } while (false);
+
+    archive_entry_free(entry);
+    archive_write_free(aw);
+    fclose(in);
+
+    if (succeed && !MoveFileEx(tmp.c_str(), archived.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        _logger->error("replace compressed log({}) failed: {}", archived.c_str(), GetLastError());
+        succeed = false;
+    }
+
+    if (!succeed)
+    {
+        DeleteFile(tmp.c_str());
+    }
+    return succeed;
+}
+
+void LogArchiver::remove_expired()
+{
+    if (_keep <= 0)
+    {
+        return;
+    }
+
+    // the stamps and dates sort the archives of a log by time
+    std::map<std::string, std::vector<std::string>> archives;
+
+    std::vector<std::string> names = ListFiles(_log_path);
+    for (const std::string& name : names)
+    {
+        std::smatch matched;
+        if (std::regex_match(name, matched, Log_Archived_Pattern))
+        {
+            archives[matched[1].str()].push_back(name);
+        }
+    }
+
+    for (std::map<std::string, std::vector<std::string>>::value_type& archive : archives)
+    {
+        std::vector<std::string>& files = archive.second;
+        if (files.size() <= (size_t)_keep)
+        {
+            continue;
+        }
+
+        std::sort(files.begin(), files.end());
+        for (size_t i = 0; i < files.size() - (size_t)_keep; ++i)
+        {
+            if (!DeleteFile((_log_path + files[i]).c_str()))
+            {
+                _logger->warn("remove expired log({}) failed: {}", files[i].c_str(), GetLastError());
+            }
+        }
+    }
+}
+
+bool LogArchiver::throttle(std::chrono::steady_clock::time_point started, unsigned long long bytes)
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    if (_rate_kb <= 0)
+    {
+        return _running;
+    }
+
+    std::chrono::milliseconds due(bytes * 1000 / ((unsigned long long)_rate_kb * 1024));
+    _wakeup.wait_until(guard, started + due, [this]() { return !_running; });
+    return _running;
+}
@@ -0,0 +1,72 @@
+#ifndef _LOG_ARCHIVER_HEADER_H_
+#define _LOG_ARCHIVER_HEADER_H_
+
+#include "spdlog/logging.h"
+
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+/*
+* compresses the log files retired by the rotating and daily sinks of the loaders under <root>logs\ on a background
+* thread of low cpu and io priority, configured in the manager config:
+*   log.compress=gzip           gzip, zstd or off
+*   log.compress.rate=4096      KB read from the logs per second at most, 0 for no limit
+*   log.compress.keep=7         compressed files kept per log, 0 keeps them all
+* a rotated <stem>.<N>.log is moved to <stem>.<yyyymmdd-hhmmss-mmm>.log of its last write first so that the sink keeps
+* rotating, a daily <stem>_<yyyy-mm-dd>.log is compressed once the day has passed, the compressed file is named
+* after the log with .gz or .zst appended and replaces it once written completely
+*/
+class LogArchiver
+{
+public:
+    LogArchiver(const std::string& log_path, const std::string& codec, int rate_kb, int keep, const std::shared_ptr<spdlog::logger>& log);
+    ~LogArchiver();
+
+    void Start();
+    void Stop();
+
+    // reads a plain or compressed log as it was written, the reader returns false to stop
+    static bool ReadLog(const std::string& file, const std::function<bool(const char*, size_t)>& reader);
+
+    // off, gzip or zstd
+    static bool IsCodecValid(const std::string& codec);
+
+private:
+    void archive_routine();
+
+    void archive_logs();
+    bool compress_log(const std::string& file, const std::string& archived);
+    void remove_expired();
+
+    // false once stopping
+    bool throttle(std::chrono::steady_clock::time_point started, unsigned long long bytes);
+
+private:
+    std::string _log_path;
+    std::string _codec;
+    int _rate_kb;
+    int _keep;
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::atomic<unsigned long long> _compressed;
+
+private:
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+
+    bool _running;
+    std::thread _archiver;
+
+private:
+    LogArchiver();
+    LogArchiver(const LogArchiver&);
+    LogArchiver& operator=(const LogArchiver&);
+};
+
+#endif
@@ -0,0 +1,296 @@
+
+#include <windows.h>
+
+#include "Log/LogFile.h"
+
+#include <algorithm>
+
+#include <string.h>
+#include <intrin.h>
+#include <emmintrin.h>
+
+// a line is looked for within so many bytes of a probe, longer ones are skipped by the time search
+static const size_t Log_Line_Probe = 64 * 1024;
+
+static unsigned long long GetAllocationGranularity()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+LogFile::LogFile()
+    : _file(INVALID_HANDLE_VALUE)
+    , _mapping(NULL)
+    , _mapping_size(0)
+    , _view(NULL)
+{
+}
+
+LogFile::~LogFile()
+{
+    Close();
+}
+
+bool LogFile::Open(const std::string& file)
+{
+    Close();
+
+    _file = CreateFile(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return INVALID_HANDLE_VALUE != _file;
+}
+
+void LogFile::Close()
+{
+    if (_view)
+    {
+        UnmapViewOfFile(_view);
+        _view = NULL;
+    }
+
+    if (_mapping)
+    {
+        CloseHandle(_mapping);
+        _mapping = NULL;
+        _mapping_size = 0;
+    }
+
+    if (INVALID_HANDLE_VALUE != _file)
+    {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+}
+
+unsigned long long LogFile::Size() const
+{
+    LARGE_INTEGER size;
+    if (INVALID_HANDLE_VALUE == _file || !GetFileSizeEx(_file, &size))
+    {
+        return 0;
+    }
+    return (unsigned long long)size.QuadPart;
+}
+
+const char* LogFile::Map(unsigned long long offset, size_t size)
+{
+    if (_view)
+    {
+        UnmapViewOfFile(_view);
+        _view = NULL;
+    }
+
+    if (0 == size || INVALID_HANDLE_VALUE == _file)
+    {
+        return nullptr;
+    }
+
+    // a mapping covers the file as large as it was created, the grown bytes take a new one
+    if (offset + size > _mapping_size)
+    {
+        if (_mapping)
+        {
+            CloseHandle(_mapping);
+            _mapping = NULL;
+            _mapping_size = 0;
+        }
+
+        unsigned long long file_size = Size();
+        if (offset + size > file_size)
+        {
+            return nullptr;
+        }
+
+        _mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (NULL == _mapping)
+        {
+            return nullptr;
+        }
+        _mapping_size = file_size;
+    }
+
+    // a view starts at a multiple of the allocation granularity
+    static const unsigned long long granularity = GetAllocationGranularity();
+    unsigned long long aligned = offset - offset % granularity;
+
+    _view = MapViewOfFile(_mapping, FILE_MAP_READ, (DWORD)(aligned >> 32), (DWORD)(aligned & 0xFFFFFFFF), (SIZE_T)(offset - aligned + size));
+    if (NULL == _view)
+    {
+        return nullptr;
+    }
+    return (const char*)_view + (offset - aligned);
+}
+
+bool LogFile::ParseTime(const char* line, size_t size, unsigned int& time_ms)
+{
+    // [hh:mm:ss.mmm
+    static const char pattern[] = "[00:00:00.000";
+    if (size < sizeof(pattern) - 1)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(pattern) - 1; ++i)
+    {
+        if ('0' == pattern[i] ? (line[i] < '0' || line[i] > '9') : line[i] != pattern[i])
+        {
+            return false;
+        }
+    }
+
+    unsigned int hour = (line[1] - '0') * 10 + (line[2] - '0');
+    unsigned int minute = (line[4] - '0') * 10 + (line[5] - '0');
+    unsigned int second = (line[7] - '0') * 10 + (line[8] - '0');
+    unsigned int ms = (line[10] - '0') * 100 + (line[11] - '0') * 10 + (line[12] - '0');
+
+    time_ms = ((hour * 60 + minute) * 60 + second) * 1000 + ms;
+    return true;
+}
+
+unsigned long long LogFile::line_start(unsigned long long offset, unsigned long long end)
+{
+    while (offset > 0 && offset < end)
+    {
+        const char* data = Map(offset - 1, 1);
+        if (nullptr == data)
+        {
+            return end;
+        }
+        if ('\n' == *data)
+        {
+            return offset;
+        }
+
+        size_t span = (size_t)std::min<unsigned long long>(Log_Line_Probe, end - offset);
+        data = Map(offset, span);
+        if (nullptr == data)
+        {
+            return end;
+        }
+
+        const char* line_end = (const char*)memchr(data, '\n', span);
+        if (line_end)
+        {
+            return offset + (unsigned long long)(line_end - data) + 1;
+        }
+        offset += span;
+    }
+    return std::min(offset, end);
+}
+
+bool LogFile::next_time(unsigned long long offset, unsigned long long end, unsigned long long& begin, unsigned int& time_ms)
+{
+    while (offset < end)
+    {
+        size_t span = (size_t)std::min<unsigned long long>(Log_Line_Probe, end - offset);
+        const char* data = Map(offset, span);
+        if (nullptr == data)
+        {
+            return false;
+        }
+
+        size_t pos = 0;
+        const char* line_end = nullptr;
+        while (pos < span)
+        {
+            if (ParseTime(data + pos, span - pos, time_ms))
+            {
+                begin = offset + pos;
+                return true;
+            }
+
+            line_end = (const char*)memchr(data + pos, '\n', span - pos);
+            if (nullptr == line_end)
+            {
+                break;
+            }
+            pos = (size_t)(line_end - data) + 1;
+        }
+
+        // the next probe starts at the line cut by this one, or after it if the line is longer than a probe
+        if (line_end || (pos > 0 && offset + span < end))
+        {
+            offset += pos;
+        }
+        else
+        {
+            offset = line_start(offset + span, end);
+        }
+    }
+    return false;
+}
+
+unsigned long long LogFile::FindTime(unsigned int time_ms, unsigned long long begin, unsigned long long end)
+{
+    // the lines are written in time order, so whether the first line with a time from an offset on is late enough
+    // turns from no to yes once as the offset goes up, and that offset is searched by halves
+    unsigned long long low = begin, high = end;
+    while (low < high)
+    {
+        unsigned long long mid = low + (high - low) / 2;
+
+        unsigned long long line = 0;
+        unsigned int line_ms = 0;
+        if (!next_time(line_start(mid, end), end, line, line_ms) || line_ms >= time_ms)
+        {
+            high = mid;
+        }
+        else
+        {
+            // the offsets up to that line lead to it as well
+            low = line + 1;
+        }
+    }
+
+    unsigned long long line = 0;
+    unsigned int line_ms = 0;
+    return next_time(line_start(low, end), end, line, line_ms) ? line : end;
+}
+
+const char* LogFile::Find(const char* data, size_t size, const std::string& text)
+{
+    size_t text_size = text.size();
+    if (0 == text_size || size < text_size)
+    {
+        return 0 == text_size ? data : nullptr;
+    }
+
+    // 16 positions a time whose first and last bytes are those of the text are compared in full, which
+    // passes over most of a log without a byte compare
+    const char* last = data + size - text_size;
+    const char* pos = data;
+
+    __m128i first_byte = _mm_set1_epi8(text[0]);
+    __m128i last_byte = _mm_set1_epi8(text[text_size - 1]);
+    for (; pos + 16 <= last + 1; pos += 16)
+    {
+        __m128i firsts = _mm_loadu_si128((const __m128i*)pos);
+        __m128i lasts = _mm_loadu_si128((const __m128i*)(pos + text_size - 1));
+
+        unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firsts, first_byte), _mm_cmpeq_epi8(lasts, last_byte)));
+        while (mask)
+        {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            if (0 == memcmp(pos + bit + 1, text.data() + 1, text_size - 1))
+            {
+                return pos + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    for (; pos <= last; ++pos)
+    {
+        pos = (const char*)memchr(pos, text[0], (size_t)(last - pos) + 1);
+        if (nullptr == pos)
+        {
+            return nullptr;
+        }
+        if (0 == memcmp(pos, text.data(), text_size))
+        {
+            return pos;
+        }
+    }
+    return nullptr;
+}
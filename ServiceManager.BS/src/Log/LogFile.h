@@ -0,0 +1,57 @@
+#ifndef _LOG_FILE_HEADER_H_
+#define _LOG_FILE_HEADER_H_
+
+#include <string>
+
+/*
+* a read-only memory map of a plain log which a loader keeps writing, the mapping follows the file as it grows
+* and only the bytes asked for are mapped into view, the lines are those of the text pattern of the loaders:
+*   [hh:mm:ss.mmm <thread> <level>] <message>
+* a line without the time, as the rest of a multi-line message, belongs to the line before
+*/
+class LogFile
+{
+public:
+    LogFile();
+    ~LogFile();
+
+    // shared with the writer, which may rotate or remove the file meanwhile
+    bool Open(const std::string& file);
+    void Close();
+
+    // the size now, 0 if it can not be told
+    unsigned long long Size() const;
+
+    // [offset, offset + size) of the file, valid until the next Map or Close, nullptr beyond the end
+    const char* Map(unsigned long long offset, size_t size);
+
+    // offset of the first line of the time(ms of the day) or later in [begin, end), end if there is none,
+    // begin is a line start
+    unsigned long long FindTime(unsigned int time_ms, unsigned long long begin, unsigned long long end);
+
+    // the first text in [data, data + size), nullptr if there is none
+    static const char* Find(const char* data, size_t size, const std::string& text);
+
+    // the ms of the day of "[hh:mm:ss.mmm", false if the line has no time
+    static bool ParseTime(const char* line, size_t size, unsigned int& time_ms);
+
+private:
+    // the first line starting at offset or later, end if there is none
+    unsigned long long line_start(unsigned long long offset, unsigned long long end);
+
+    // the time of the first line with one starting in [offset, end), offset is a line start
+    bool next_time(unsigned long long offset, unsigned long long end, unsigned long long& begin, unsigned int& time_ms);
+
+private:
+    void* _file;
+    void* _mapping;
+    unsigned long long _mapping_size;
+
+    void* _view;
+
+private:
+    LogFile(const LogFile&);
+    LogFile& operator=(const LogFile&);
+};
+
+#endif
@@ -0,0 +1,217 @@
+
+#include <windows.h>
+
+#include <stdio.h>
+
+#include "Log/LogIndex.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+// an entry every so many bytes, 64 KB of a log is searched at most once its index is updated
+static const unsigned long long Log_Index_Stride = 64 * 1024;
+
+// bytes of the log mapped a time by an update
+static const size_t Log_Index_Chunk = 4 * 1024 * 1024;
+
+// the first bytes kept to tell a replaced log, the time of its first line is among them
+static const size_t Log_Index_Head = 32;
+
+static const char Log_Index_Magic[4] = { 'S', 'L', 'I', 'X' };
+static const unsigned int Log_Index_Version = 1;
+
+struct LogIndexHeader_t
+{
+    char magic[4];
+    unsigned int version;
+    unsigned long long indexed;
+    unsigned int stride;
+    unsigned int count;
+    unsigned int head_size;
+    char head[Log_Index_Head];
+};
+
+LogIndex::LogIndex(const std::string& log_file)
+    : _index_file(log_file + ".idx")
+    , _loaded(false)
+    , _indexed(0), _head(), _entries()
+    , _lock()
+{
+}
+
+LogIndex::~LogIndex()
+{
+}
+
+bool LogIndex::Update(LogFile& log)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_loaded)
+    {
+        load();
+        _loaded = true;
+    }
+
+    unsigned long long size = log.Size();
+    std::string now_head = head(log, size);
+
+    // a log written anew under the name is indexed from its start
+    size_t compared = std::min(_head.size(), now_head.size());
+    if (size < _indexed || 0 != now_head.compare(0, compared, _head, 0, compared))
+    {
+        _indexed = 0;
+        _entries.clear();
+        _head.clear();
+    }
+    if (now_head.size() > _head.size())
+    {
+        _head = now_head;
+    }
+
+    unsigned long long updated = _indexed;
+    while (_indexed < size)
+    {
+        size_t span = (size_t)std::min<unsigned long long>(Log_Index_Chunk, size - _indexed);
+        const char* data = log.Map(_indexed, span);
+        if (nullptr == data)
+        {
+            break;
+        }
+
+        // the complete lines only, the last one is taken by the next update, unless a line is longer than a chunk
+        const char* end = data + span;
+        while (end > data && '\n' != end[-1])
+        {
+            --end;
+        }
+        if (end == data)
+        {
+            if (span < Log_Index_Chunk)
+            {
+                break;
+            }
+            end = data + span;
+        }
+
+        const char* line = data;
+        while (line < end)
+        {
+            unsigned long long offset = _indexed + (unsigned long long)(line - data);
+            if (!_entries.empty() && offset < _entries.back().offset + Log_Index_Stride)
+            {
+                // the lines within the stride are passed over to the one across its end
+                size_t skip = (size_t)std::min<unsigned long long>(_entries.back().offset + Log_Index_Stride - 1 - _indexed, (unsigned long long)(end - data));
+                line = data + skip;
+            }
+            else
+            {
+                unsigned int time_ms = 0;
+                if (LogFile::ParseTime(line, (size_t)(end - line), time_ms))
+                {
+                    Entry_t entry = { offset, time_ms, 0 };
+                    _entries.push_back(entry);
+                    continue;
+                }
+            }
+
+            const char* line_end = line < end ? (const char*)memchr(line, '\n', (size_t)(end - line)) : nullptr;
+            line = line_end ? line_end + 1 : end;
+        }
+
+        _indexed += (unsigned long long)(end - data);
+    }
+
+    return _indexed == updated || save();
+}
+
+void LogIndex::Window(unsigned int time_ms, unsigned long long size, unsigned long long& low, unsigned long long& high)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+
+    // the entries are in the order of the offsets, and so of the times as the lines are written
+    std::vector<Entry_t>::const_iterator found = std::lower_bound(_entries.cbegin(), _entries.cend(), time_ms, [](const Entry_t& entry, unsigned int time_ms) {
+        return entry.time_ms < time_ms;
+    });
+
+    low = found == _entries.cbegin() ? 0 : (found - 1)->offset;
+    high = found == _entries.cend() ? size : std::min(found->offset, size);
+    low = std::min(low, high);
+}
+
+unsigned long long LogIndex::Indexed()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _indexed;
+}
+
+bool LogIndex::load()
+{
+    FILE* in = fopen(_index_file.c_str(), "rb");
+    if (NULL == in)
+    {
+        return false;
+    }
+
+    LogIndexHeader_t header;
+    bool loaded = 1 == fread(&header, sizeof(header), 1, in)
+        && 0 == memcmp(header.magic, Log_Index_Magic, sizeof(header.magic))
+        && Log_Index_Version == header.version
+        && Log_Index_Stride == header.stride
+        && header.head_size <= Log_Index_Head;
+    if (loaded)
+    {
+        _entries.resize(header.count);
+        loaded = 0 == header.count || header.count == fread(_entries.data(), sizeof(Entry_t), header.count, in);
+    }
+    fclose(in);
+
+    if (!loaded)
+    {
+        _entries.clear();
+        return false;
+    }
+
+    _indexed = header.indexed;
+    _head.assign(header.head, header.head_size);
+    return true;
+}
+
+bool LogIndex::save()
+{
+    std::string tmp = _index_file + ".tmp";
+    FILE* out = fopen(tmp.c_str(), "wb");
+    if (NULL == out)
+    {
+        return false;
+    }
+
+    LogIndexHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Log_Index_Magic, sizeof(header.magic));
+    header.version = Log_Index_Version;
+    header.indexed = _indexed;
+    header.stride = (unsigned int)Log_Index_Stride;
+    header.count = (unsigned int)_entries.size();
+    header.head_size = (unsigned int)_head.size();
+    memcpy(header.head, _head.data(), _head.size());
+
+    bool saved = 1 == fwrite(&header, sizeof(header), 1, out)
+        && (_entries.empty() || _entries.size() == fwrite(_entries.data(), sizeof(Entry_t), _entries.size(), out));
+    saved = 0 == fclose(out) && saved;
+
+    // replaced once written completely, a manager stopped meanwhile leaves the last one
+    if (!saved || !MoveFileEx(tmp.c_str(), _index_file.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFile(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string LogIndex::head(LogFile& log, unsigned long long size)
+{
+    size_t head_size = (size_t)std::min<unsigned long long>(Log_Index_Head, size);
+    const char* data = log.Map(0, head_size);
+    return data ? std::string(data, head_size) : std::string();
+}
@@ -0,0 +1,66 @@
+#ifndef _LOG_INDEX_HEADER_H_
+#define _LOG_INDEX_HEADER_H_
+
+#include "Log/LogFile.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+/*
+* a sparse index of the times of a plain log, the offset and time of the first timed line in every Log_Index_Stride
+* bytes, so that a time is searched within the bytes of two entries instead of through the file
+*
+* the index grows with the log, an update scans only the lines written since the last one, and is kept in
+* <log>.idx next to the log to be taken up again by the next manager, it is rebuilt once the log is found
+* replaced, as a rotating sink starts it anew
+*/
+class LogIndex
+{
+public:
+    explicit LogIndex(const std::string& log_file);
+    ~LogIndex();
+
+    // indexes the lines written since the last update, log is the opened log_file
+    bool Update(LogFile& log);
+
+    // [low, high] which the first line of the time(ms of the day) or later is within, from the last update,
+    // high is size if the time is later than the indexed lines
+    void Window(unsigned int time_ms, unsigned long long size, unsigned long long& low, unsigned long long& high);
+
+    // the bytes of the log indexed
+    unsigned long long Indexed();
+
+private:
+    bool load();
+    bool save();
+
+    // the first bytes of the log, which tell a replaced log from a grown one
+    static std::string head(LogFile& log, unsigned long long size);
+
+private:
+    struct Entry_t
+    {
+        unsigned long long offset;
+        unsigned int time_ms;
+        unsigned int reserved;
+    };
+
+    std::string _index_file;
+
+    bool _loaded;
+
+    // the lines before indexed are indexed, it is the start of a line
+    unsigned long long _indexed;
+    std::string _head;
+    std::vector<Entry_t> _entries;
+
+    std::mutex _lock;
+
+private:
+    LogIndex();
+    LogIndex(const LogIndex&);
+    LogIndex& operator=(const LogIndex&);
+};
+
+#endif
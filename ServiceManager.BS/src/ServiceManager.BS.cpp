@@ -14,31 +14,34 @@
 
 HttpService http;
 
-#define SERVICE_HTTP_DIRECTORY "http\\"
 #define SERVICE_DEFINITION_DIRECTORY "services\\"
 #define SERVICES_FILE_VALUE "data\\Services.json"
+#define SERVICE_STATUS_INTERVAL 1000
+#define SERVICE_LOG_COMPRESS "gzip"
+#define SERVICE_LOG_COMPRESS_RATE 4096
+#define SERVICE_LOG_COMPRESS_KEEP 7
 
-SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path)
-{
+SERVICE_MODULE_C_API int SERVICE_CALL Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path)
+{
     do 
     {
         if (config_file_path.empty())
         {
-            return http.Create("", 8180, root + SERVICE_HTTP_DIRECTORY, root + SERVICE_DEFINITION_DIRECTORY, root + SERVICES_FILE_VALUE, root, log);
+            return http.Create("", 8180, "", root + SERVICE_DEFINITION_DIRECTORY, root + SERVICES_FILE_VALUE, root, SERVICE_STATUS_INTERVAL, SERVICE_LOG_COMPRESS, SERVICE_LOG_COMPRESS_RATE, SERVICE_LOG_COMPRESS_KEEP, log);
         }
-
-        std::ifstream ifs(config_file_path);
+
+        std::ifstream ifs(config_file_path);
         ifs.seekg(0, std::ios::end);
         size_t length = (size_t)ifs.tellg();
-        ifs.seekg(0, std::ios::beg);
-
-        std::vector<char> content(length);
-        ifs.read(content.data(), length);
-
+        ifs.seekg(0, std::ios::beg);
+
+        std::vector<char> content(length);
+        ifs.read(content.data(), length);
+
         rapidjson::Document doc;
-        doc.Parse(content.data());
-
-        std::string address;
+        doc.Parse(content.data());
+
+        std::string address;
         if (doc.HasMember("address"))
         {
             if (!doc["address"].IsString())
@@ -47,8 +50,8 @@ SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>&
                 break;
             }
             address = doc["address"].GetString();
-        }
-
+        }
+
         if (!doc.HasMember("port"))
         {
             log->error("create http service failed: http serve port not provided");
@@ -59,9 +62,10 @@ SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>&
             log->error("create http service failed: http serve port should be integer");
             break;
         }
-        int port = doc["port"].GetInt();
-
-        std::string directory = SERVICE_HTTP_DIRECTORY;
+        int port = doc["port"].GetInt();
+
+        // the web ui packed into the manager is served without it, a directory is for working on the web ui
+        std::string directory;
         if (doc.HasMember("directory"))
         {
             if (!doc["directory"].IsString())
@@ -72,21 +76,66 @@ SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>&
             directory = doc["directory"].GetString();
 
             std::for_each(directory.begin(), directory.end(), [](char& ch) { ch = ch == '/' ? '\\' : ch; });
+
+            directory = root + directory;
+            if (_access(directory.c_str(), 00) != 0 && _mkdir(directory.c_str()) != 0)
+            {
+                log->error("create http service failed: http serve directory({}) does not exist", directory.c_str());
+                break;
+            }
         }
-        directory = root + directory;
-        if (_access(directory.c_str(), 00) != 0 && _mkdir(directory.c_str()) != 0)
+
+        int status_interval = SERVICE_STATUS_INTERVAL;
+        if (doc.HasMember("status.interval"))
         {
-            log->error("create http service failed: http serve directory({}) does not exist", directory.c_str());
-            break;
+            if (!doc["status.interval"].IsInt() || doc["status.interval"].GetInt() <= 0)
+            {
+                log->error("create http service failed: service status refresh interval should be positive integer");
+                break;
+            }
+            status_interval = doc["status.interval"].GetInt();
+        }
+
+        std::string log_compress = SERVICE_LOG_COMPRESS;
+        if (doc.HasMember("log.compress"))
+        {
+            if (!doc["log.compress"].IsString() || !LogArchiver::IsCodecValid(doc["log.compress"].GetString()))
+            {
+                log->error("create http service failed: log compression should be gzip, zstd or off");
+                break;
+            }
+            log_compress = doc["log.compress"].GetString();
+        }
+
+        int log_compress_rate = SERVICE_LOG_COMPRESS_RATE;
+        if (doc.HasMember("log.compress.rate"))
+        {
+            if (!doc["log.compress.rate"].IsInt() || doc["log.compress.rate"].GetInt() < 0)
+            {
+                log->error("create http service failed: log compression rate should be non-negative integer");
+                break;
+            }
+            log_compress_rate = doc["log.compress.rate"].GetInt();
+        }
+
+        int log_compress_keep = SERVICE_LOG_COMPRESS_KEEP;
+        if (doc.HasMember("log.compress.keep"))
+        {
+            if (!doc["log.compress.keep"].IsInt() || doc["log.compress.keep"].GetInt() < 0)
+            {
+                log->error("create http service failed: compressed logs kept should be non-negative integer");
+                break;
+            }
+            log_compress_keep = doc["log.compress.keep"].GetInt();
         }
 
-        return http.Create(address, port, directory, root + SERVICE_DEFINITION_DIRECTORY, root + SERVICES_FILE_VALUE, root, log);
+        return http.Create(address, port, directory, root + SERVICE_DEFINITION_DIRECTORY, root + SERVICES_FILE_VALUE, root, status_interval, log_compress, log_compress_rate, log_compress_keep, log);
     } while (false);
 
     return Service_Module_Failed;
 }
 
-SERVICE_MODULE_C_API void __cdecl Service_Run(IsServiceRunning Is_Service_Running)
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Run(IsServiceRunning Is_Service_Running)
 {
     while (Is_Service_Running() != 0)
     {
@@ -94,7 +143,7 @@ SERVICE_MODULE_C_API void __cdecl Service_Run(IsServiceRunning Is_Service_Runnin
     }
 }
 
-SERVICE_MODULE_C_API void __cdecl Service_Destroy()
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Destroy()
 {
     http.Destroy();
 }
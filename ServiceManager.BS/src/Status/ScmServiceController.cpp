@@ -0,0 +1,99 @@
+#include "Status/ScmServiceController.h"
+
+ScmServiceController::ScmServiceController()
+    : _manager(NULL), _services()
+{
+}
+
+ScmServiceController::~ScmServiceController()
+{
+    Close();
+}
+
+bool ScmServiceController::Open()
+{
+    if (NULL == _manager)
+    {
+        _manager = OpenSCManager(
+            NULL,                    // local computer
+            NULL,                    // ServicesActive database
+            SC_MANAGER_CONNECT);     // querying only needs to connect
+    }
+    return NULL != _manager;
+}
+
+void ScmServiceController::Close()
+{
+    for (std::pair<const std::string, SC_HANDLE>& serv : _services)
+    {
+        CloseServiceHandle(serv.second);
+    }
+    _services.clear();
+
+    if (_manager)
+    {
+        CloseServiceHandle(_manager);
+        _manager = NULL;
+    }
+}
+
+bool ScmServiceController::Query(const std::string& name, int& status_code, unsigned long& error)
+{
+    status_code = 0;
+    error = ERROR_SUCCESS;
+
+    if (!Open())
+    {
+        error = GetLastError();
+        return false;
+    }
+
+    SC_HANDLE schService = NULL;
+    std::unordered_map<std::string, SC_HANDLE>::iterator found = _services.find(name);
+    if (found != _services.end())
+    {
+        schService = found->second;
+    }
+    else
+    {
+        schService = OpenService(
+            _manager,                  // SCM database
+            name.c_str(),              // name of service
+            SERVICE_QUERY_STATUS);     // desired access
+        if (NULL == schService)
+        {
+            error = GetLastError();
+            return false;
+        }
+        _services[name] = schService;
+    }
+
+    SERVICE_STATUS_PROCESS ssStatus;
+    DWORD dwBytesNeeded;
+    if (!QueryServiceStatusEx(
+        schService,                     // handle to service
+        SC_STATUS_PROCESS_INFO,         // information level
+        (LPBYTE)&ssStatus,              // address of structure
+        sizeof(SERVICE_STATUS_PROCESS), // size of structure
+        &dwBytesNeeded))                // size needed if buffer is too small
+    {
+        error = GetLastError();
+
+        // the handle may refer to a deleted service, open it again next time
+        Forget(name);
+        return false;
+    }
+
+    status_code = (int)ssStatus.dwCurrentState;
+    return true;
+}
+
+void ScmServiceController::Forget(const std::string& name)
+{
+    std::unordered_map<std::string, SC_HANDLE>::iterator found = _services.find(name);
+    if (found != _services.end())
+    {
+        CloseServiceHandle(found->second);
+        _services.erase(found);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef _SCM_SERVICE_CONTROLLER_HEADER_H_
+#define _SCM_SERVICE_CONTROLLER_HEADER_H_
+
+#include "Status/ServiceController.h"
+
+#include <windows.h>
+
+#include <unordered_map>
+
+/*
+* keeps one SCM connection and one query handle per service open across refreshes,
+* only used from the refresher thread of ServiceStatusCache
+*/
+class ScmServiceController : public ServiceController
+{
+public:
+    ScmServiceController();
+    ~ScmServiceController();
+
+    bool Open() override;
+    void Close() override;
+
+    bool Query(const std::string& name, int& status_code, unsigned long& error) override;
+
+    void Forget(const std::string& name) override;
+
+private:
+    SC_HANDLE _manager;
+    std::unordered_map<std::string, SC_HANDLE> _services;
+
+private:
+    ScmServiceController(const ScmServiceController&);
+    ScmServiceController& operator=(const ScmServiceController&);
+};
+
+#endif
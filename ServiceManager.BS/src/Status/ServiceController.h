@@ -0,0 +1,25 @@
+#ifndef _SERVICE_CONTROLLER_HEADER_H_
+#define _SERVICE_CONTROLLER_HEADER_H_
+
+#include <string>
+
+/*
+* the service status source behind ServiceStatusCache, the windows implementation
+* talks to the SCM while a fake one can be plugged in to benchmark the cache elsewhere
+*/
+class ServiceController
+{
+public:
+    virtual ~ServiceController() {}
+
+    virtual bool Open() = 0;
+    virtual void Close() = 0;
+
+    // status_code is one of SERVICE_STOPPED ... SERVICE_PAUSED, error is the system error code on failure
+    virtual bool Query(const std::string& name, int& status_code, unsigned long& error) = 0;
+
+    // drop whatever is kept for the service, called when the service is not tracked any more
+    virtual void Forget(const std::string& name) = 0;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "Status/ServiceStatusCache.h"
+
+#include <vector>
+#include <iterator>
+
+// the pace of refreshing after a service is operated, pending states settle within seconds
+static const std::chrono::milliseconds Service_Status_Fast_Interval(200);
+static const std::chrono::seconds Service_Status_Fast_Period(10);
+
+ServiceStatusCache::ServiceStatusCache(const std::shared_ptr<ServiceController>& controller, int interval_ms)
+    : _controller(controller), _interval(interval_ms > 0 ? interval_ms : 1000)
+    , _lock(), _wakeup()
+    , _names(), _forgotten(), _operated()
+    , _snapshot(std::make_shared<ServiceStatusSnapshot_t>())
+    , _invalidated(false), _fast_until()
+    , _running(false), _refresher()
+    , _refresh_lock()
+{
+}
+
+ServiceStatusCache::~ServiceStatusCache()
+{
+    Stop();
+}
+
+void ServiceStatusCache::Start()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_running)
+    {
+        return;
+    }
+    _running = true;
+    _refresher = std::thread(&ServiceStatusCache::refresh_routine, this);
+}
+
+void ServiceStatusCache::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_running)
+        {
+            return;
+        }
+        _running = false;
+    }
+    _wakeup.notify_all();
+
+    if (_refresher.joinable())
+    {
+        _refresher.join();
+    }
+
+    std::lock_guard<std::mutex> guard(_refresh_lock);
+    _controller->Close();
+}
+
+void ServiceStatusCache::Track(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _names.insert(name);
+        _forgotten.erase(name);
+    }
+    Invalidate(name);
+}
+
+void ServiceStatusCache::Untrack(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_names.erase(name) > 0)
+        {
+            _forgotten.insert(name);
+        }
+    }
+    Invalidate();
+}
+
+void ServiceStatusCache::Invalidate()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _invalidated = true;
+        _fast_until = std::chrono::steady_clock::now() + Service_Status_Fast_Period;
+    }
+    _wakeup.notify_all();
+}
+
+void ServiceStatusCache::Invalidate(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (std::unordered_map<std::string, std::chrono::steady_clock::time_point>::iterator it = _operated.begin(); it != _operated.end(); )
+        {
+            it = now - it->second > Service_Status_Fast_Period ? _operated.erase(it) : std::next(it);
+        }
+        _operated[name] = now;
+    }
+    Invalidate();
+}
+
+bool ServiceStatusCache::Settled(const std::string& name) const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point>::const_iterator found = _operated.find(name);
+    return _operated.end() == found || std::chrono::steady_clock::now() - found->second > Service_Status_Fast_Period;
+}
+
+void ServiceStatusCache::Refresh()
+{
+    std::lock_guard<std::mutex> refresh_guard(_refresh_lock);
+
+    std::vector<std::string> names, forgotten;
+    ServiceStatusSnapshot previous;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        names.assign(_names.begin(), _names.end());
+        forgotten.assign(_forgotten.begin(), _forgotten.end());
+        _forgotten.clear();
+
+        previous = _snapshot;
+    }
+
+    for (const std::string& name : forgotten)
+    {
+        _controller->Forget(name);
+    }
+
+    std::shared_ptr<ServiceStatusSnapshot_t> current = std::make_shared<ServiceStatusSnapshot_t>();
+    current->version = previous->version + 1;
+    current->services.reserve(names.size());
+
+    // query without holding the lock, readers keep using the previous snapshot meanwhile
+    bool changed = names.size() != previous->services.size();
+    for (const std::string& name : names)
+    {
+        ServiceStatus_t status;
+        if (!_controller->Query(name, status.status_code, status.error))
+        {
+            status.status_code = 0;
+        }
+
+        ServiceStatusMap_t::const_iterator found = previous->services.find(name);
+        if (found != previous->services.end() && found->second.status_code == status.status_code && found->second.error == status.error)
+        {
+            status.version = found->second.version;
+        }
+        else
+        {
+            status.version = current->version;
+            changed = true;
+        }
+
+        current->services.emplace(name, status);
+    }
+
+    if (!changed)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _snapshot = current;
+}
+
+ServiceStatusSnapshot ServiceStatusCache::Snapshot() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _snapshot;
+}
+
+void ServiceStatusCache::refresh_routine()
+{
+    std::unique_lock<std::mutex> guard(_lock);
+    while (_running)
+    {
+        _invalidated = false;
+        guard.unlock();
+
+        Refresh();
+
+        guard.lock();
+        std::chrono::milliseconds interval = std::chrono::steady_clock::now() < _fast_until ? Service_Status_Fast_Interval : _interval;
+        _wakeup.wait_for(guard, interval, [this]() { return !_running || _invalidated; });
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef _SERVICE_STATUS_CACHE_HEADER_H_
+#define _SERVICE_STATUS_CACHE_HEADER_H_
+
+#include "Status/ServiceController.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+
+struct ServiceStatus_t
+{
+    int status_code = 0;
+    unsigned long error = 0;
+
+    // snapshot version in which the status was last changed
+    unsigned long long version = 0;
+};
+
+typedef std::unordered_map<std::string, ServiceStatus_t> ServiceStatusMap_t;
+
+struct ServiceStatusSnapshot_t
+{
+    unsigned long long version = 0;
+    ServiceStatusMap_t services;
+};
+
+typedef std::shared_ptr<const ServiceStatusSnapshot_t> ServiceStatusSnapshot;
+
+/*
+* queries the status of the tracked services on a background thread and publishes
+* immutable, versioned snapshots, readers never touch the service controller
+*/
+class ServiceStatusCache
+{
+public:
+    ServiceStatusCache(const std::shared_ptr<ServiceController>& controller, int interval_ms);
+    ~ServiceStatusCache();
+
+    void Start();
+    void Stop();
+
+    void Track(const std::string& name);
+    void Untrack(const std::string& name);
+
+    // refresh as soon as possible and keep refreshing quickly for a while, used after a service is operated
+    void Invalidate();
+
+    // as Invalidate, after name is operated, its status is not settled until the quick refreshing is over
+    void Invalidate(const std::string& name);
+
+    // whether no operation of late may have left the status of name in the snapshot behind the service
+    bool Settled(const std::string& name) const;
+
+    // run one refresh pass on the calling thread
+    void Refresh();
+
+    ServiceStatusSnapshot Snapshot() const;
+
+private:
+    void refresh_routine();
+
+private:
+    std::shared_ptr<ServiceController> _controller;
+    std::chrono::milliseconds _interval;
+
+private:
+    mutable std::mutex _lock;
+    std::condition_variable _wakeup;
+
+    std::unordered_set<std::string> _names;
+    std::unordered_set<std::string> _forgotten;
+
+    // when the services were last operated, those settled are dropped
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> _operated;
+
+    ServiceStatusSnapshot _snapshot;
+
+    bool _invalidated;
+    std::chrono::steady_clock::time_point _fast_until;
+
+    bool _running;
+    std::thread _refresher;
+
+private:
+    std::mutex _refresh_lock;
+
+private:
+    ServiceStatusCache();
+    ServiceStatusCache(const ServiceStatusCache&);
+    ServiceStatusCache& operator=(const ServiceStatusCache&);
+};
+
+#endif
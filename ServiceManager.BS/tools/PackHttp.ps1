@@ -0,0 +1,329 @@
+<#
+packs the web ui under -Source into -Output, the table included by src\Http\EmbeddedAssets.cpp, run by the pre-build
+event of ServiceManager.BS, the output is left as it is while the listing of the files is the same
+
+the files are typed as StaticAssetCache types them, the others and those larger than 8 MB are not packed, the paths
+are placed by hash and displace so that a path is found by two hashes, see src\Http\EmbeddedAssets.h
+#>
+param(
+    [Parameter(Mandatory = $true)][string]$Source,
+    [Parameter(Mandatory = $true)][string]$Output
+)
+
+$ErrorActionPreference = 'Stop'
+
+Add-Type -TypeDefinition @'
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Compression;
+using System.Security.Cryptography;
+using System.Text;
+
+public static class PackHttp
+{
+    const long Asset_Max = 8 * 1024 * 1024;
+    const int Encode_Min = 256;
+    const int Bucket_Paths = 4;
+    const uint Seed_Max = 10000000;
+
+    class Type_t
+    {
+        public string ContentType;
+        public bool Compressible;
+        public Type_t(string content_type, bool compressible) { ContentType = content_type; Compressible = compressible; }
+    }
+
+    class Asset_t
+    {
+        public string Path;
+        public Type_t Type;
+        public byte[] Identity;
+        public byte[] Gzip;
+        public string Hash;
+    }
+
+    static readonly Dictionary<string, Type_t> Types = new Dictionary<string, Type_t>
+    {
+        { ".html", new Type_t("text/html; charset=utf-8", true) },
+        { ".htm", new Type_t("text/html; charset=utf-8", true) },
+        { ".css", new Type_t("text/css; charset=utf-8", true) },
+        { ".js", new Type_t("application/javascript; charset=utf-8", true) },
+        { ".json", new Type_t("application/json; charset=utf-8", true) },
+        { ".map", new Type_t("application/json; charset=utf-8", true) },
+        { ".txt", new Type_t("text/plain; charset=utf-8", true) },
+        { ".xml", new Type_t("application/xml; charset=utf-8", true) },
+        { ".svg", new Type_t("image/svg+xml", true) },
+        { ".ico", new Type_t("image/x-icon", true) },
+        { ".ttf", new Type_t("font/ttf", true) },
+        { ".otf", new Type_t("font/otf", true) },
+        { ".eot", new Type_t("application/vnd.ms-fontobject", true) },
+        { ".woff", new Type_t("font/woff", false) },
+        { ".woff2", new Type_t("font/woff2", false) },
+        { ".png", new Type_t("image/png", false) },
+        { ".jpg", new Type_t("image/jpeg", false) },
+        { ".jpeg", new Type_t("image/jpeg", false) },
+        { ".gif", new Type_t("image/gif", false) },
+    };
+
+    // EmbeddedAssets::Hash
+    public static uint Hash(uint seed, byte[] data)
+    {
+        uint hash = 2166136261u ^ seed;
+        hash *= 16777619u;
+        foreach (byte b in data)
+        {
+            hash ^= b;
+            hash *= 16777619u;
+        }
+
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    // false if the output is up to date
+    public static bool Pack(string source, string output)
+    {
+        source = Path.GetFullPath(source).TrimEnd('\\', '/');
+
+        // a tree without the web ui packs an empty table
+        List<string> files = new List<string>();
+        string[] found = Directory.Exists(source) ? Directory.GetFiles(source, "*", SearchOption.AllDirectories) : new string[0];
+        foreach (string file in found)
+        {
+            if (Types.ContainsKey(Path.GetExtension(file).ToLowerInvariant()) && new FileInfo(file).Length <= Asset_Max)
+            {
+                files.Add(file);
+            }
+        }
+        files.Sort(StringComparer.Ordinal);
+
+        StringBuilder listing = new StringBuilder();
+        foreach (string file in files)
+        {
+            FileInfo info = new FileInfo(file);
+            listing.AppendFormat("{0}|{1}|{2}\n", file, info.Length, info.LastWriteTimeUtc.Ticks);
+        }
+        string stamp = "// packed " + Hex(Sha256(Encoding.UTF8.GetBytes(listing.ToString())), 32);
+        if (File.Exists(output))
+        {
+            using (StreamReader reader = new StreamReader(output))
+            {
+                if (reader.ReadLine() == stamp)
+                {
+                    return false;
+                }
+            }
+        }
+
+        List<Asset_t> assets = new List<Asset_t>();
+        foreach (string file in files)
+        {
+            assets.Add(Load(source, file));
+        }
+
+        int bucket_count = Math.Max(1, (assets.Count + Bucket_Paths - 1) / Bucket_Paths);
+        int[] slots;
+        uint[] displacements = Place(assets, bucket_count, out slots);
+
+        Asset_t[] placed = new Asset_t[assets.Count];
+        for (int i = 0; i < assets.Count; ++i)
+        {
+            placed[slots[i]] = assets[i];
+        }
+
+        Directory.CreateDirectory(Path.GetDirectoryName(Path.GetFullPath(output)));
+        string tmp = output + ".tmp";
+        using (StreamWriter writer = new StreamWriter(tmp, false, new UTF8Encoding(false)))
+        {
+            writer.NewLine = "\r\n";
+            writer.WriteLine(stamp);
+            writer.WriteLine("// generated by tools\\PackHttp.ps1 from {0}, do not edit", source);
+            writer.WriteLine();
+
+            for (int i = 0; i < placed.Length; ++i)
+            {
+                WriteData(writer, string.Format("Embedded_Data_{0}", i), placed[i].Identity);
+                if (placed[i].Gzip != null)
+                {
+                    WriteData(writer, string.Format("Embedded_Data_{0}_Gzip", i), placed[i].Gzip);
+                }
+            }
+
+            writer.WriteLine("static constexpr EmbeddedAsset_t Embedded_Assets[] = {");
+            for (int i = 0; i < placed.Length; ++i)
+            {
+                Asset_t asset = placed[i];
+                bool gzip = asset.Gzip != null;
+                writer.WriteLine("    {{ \"{0}\", \"{1}\", \"{2}\", {{ Embedded_Data_{3}, {4}, nullptr }}, {{ {5}, {6}, 0 }}, {{ \"\\\"{7}\\\"\", {8}, nullptr }} }},",
+                    asset.Path, asset.Type.ContentType, asset.Type.ContentType.StartsWith("text/html") ? "no-cache" : "max-age=3600",
+                    i, gzip ? string.Format("Embedded_Data_{0}_Gzip", i) : "nullptr",
+                    asset.Identity.Length, gzip ? asset.Gzip.Length : 0,
+                    asset.Hash, gzip ? string.Format("\"\\\"{0}-gz\\\"\"", asset.Hash) : "nullptr");
+            }
+            if (0 == placed.Length)
+            {
+                writer.WriteLine("    {},");
+            }
+            writer.WriteLine("};");
+            writer.WriteLine("static constexpr size_t Embedded_Asset_Count = {0};", placed.Length);
+            writer.WriteLine();
+
+            writer.WriteLine("static constexpr unsigned int Embedded_Displacements[] = {");
+            for (int i = 0; i < displacements.Length; i += 16)
+            {
+                List<string> line = new List<string>();
+                for (int j = i; j < Math.Min(i + 16, displacements.Length); ++j)
+                {
+                    line.Add(displacements[j].ToString() + "u");
+                }
+                writer.WriteLine("    {0},", string.Join(", ", line.ToArray()));
+            }
+            writer.WriteLine("};");
+            writer.WriteLine("static constexpr size_t Embedded_Bucket_Count = {0};", displacements.Length);
+        }
+
+        if (File.Exists(output))
+        {
+            File.Delete(output);
+        }
+        File.Move(tmp, output);
+        return true;
+    }
+
+    static Asset_t Load(string source, string file)
+    {
+        Asset_t asset = new Asset_t();
+        asset.Path = file.Substring(source.Length).Replace('\\', '/');
+        asset.Type = Types[Path.GetExtension(file).ToLowerInvariant()];
+        asset.Identity = File.ReadAllBytes(file);
+        asset.Hash = Hex(Sha256(asset.Identity), 16);
+
+        // kept when it is a tenth smaller at least, as StaticAssetCache keeps its encodings
+        if (asset.Type.Compressible && asset.Identity.Length >= Encode_Min)
+        {
+            using (MemoryStream compressed = new MemoryStream())
+            {
+                using (GZipStream gzip = new GZipStream(compressed, CompressionLevel.Optimal, true))
+                {
+                    gzip.Write(asset.Identity, 0, asset.Identity.Length);
+                }
+                if (compressed.Length <= asset.Identity.Length - asset.Identity.Length / 10)
+                {
+                    asset.Gzip = compressed.ToArray();
+                }
+            }
+        }
+        return asset;
+    }
+
+    // hash and displace, the buckets of the most paths are placed first, each with the first seed which puts
+    // its paths into free slots, the slot of an asset is returned
+    static uint[] Place(List<Asset_t> assets, int bucket_count, out int[] slots)
+    {
+        int count = assets.Count;
+        List<byte[]> keys = new List<byte[]>();
+        List<int>[] buckets = new List<int>[bucket_count];
+        for (int b = 0; b < bucket_count; ++b)
+        {
+            buckets[b] = new List<int>();
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            keys.Add(Encoding.UTF8.GetBytes(assets[i].Path));
+            buckets[Hash(0, keys[i]) % (uint)bucket_count].Add(i);
+        }
+
+        int[] order = new int[bucket_count];
+        for (int b = 0; b < bucket_count; ++b)
+        {
+            order[b] = b;
+        }
+        Array.Sort(order, (x, y) => buckets[y].Count != buckets[x].Count ? buckets[y].Count - buckets[x].Count : x - y);
+
+        slots = new int[count];
+        bool[] taken = new bool[Math.Max(count, 1)];
+        uint[] displacements = new uint[bucket_count];
+        foreach (int b in order)
+        {
+            if (0 == buckets[b].Count)
+            {
+                break;
+            }
+
+            for (uint seed = 1; ; ++seed)
+            {
+                if (seed > Seed_Max)
+                {
+                    throw new InvalidOperationException("the paths can not be placed by a perfect hash");
+                }
+
+                List<int> tried = new List<int>();
+                foreach (int i in buckets[b])
+                {
+                    int slot = (int)(Hash(seed, keys[i]) % (uint)count);
+                    if (taken[slot] || tried.Contains(slot))
+                    {
+                        break;
+                    }
+                    tried.Add(slot);
+                }
+                if (tried.Count != buckets[b].Count)
+                {
+                    continue;
+                }
+
+                for (int k = 0; k < tried.Count; ++k)
+                {
+                    taken[tried[k]] = true;
+                    slots[buckets[b][k]] = tried[k];
+                }
+                displacements[b] = seed;
+                break;
+            }
+        }
+        return displacements;
+    }
+
+    static void WriteData(StreamWriter writer, string name, byte[] data)
+    {
+        writer.WriteLine("static constexpr unsigned char {0}[] = {{", name);
+        if (0 == data.Length)
+        {
+            writer.WriteLine("    0x00,");
+        }
+        for (int offset = 0; offset < data.Length; offset += 32)
+        {
+            writer.WriteLine("    0x{0},", BitConverter.ToString(data, offset, Math.Min(32, data.Length - offset)).Replace("-", ",0x"));
+        }
+        writer.WriteLine("};");
+        writer.WriteLine();
+    }
+
+    static byte[] Sha256(byte[] data)
+    {
+        using (SHA256 sha = SHA256.Create())
+        {
+            return sha.ComputeHash(data);
+        }
+    }
+
+    static string Hex(byte[] data, int digits)
+    {
+        return BitConverter.ToString(data).Replace("-", "").ToLowerInvariant().Substring(0, digits);
+    }
+}
+'@
+
+if ([PackHttp]::Pack($Source, $Output))
+{
+    Write-Host "packed $Source into $Output"
+}
+else
+{
+    Write-Host "$Output is up to date"
+}
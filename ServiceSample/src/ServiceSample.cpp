@@ -1,6 +1,12 @@
 // ServiceSample.cpp :  DLL Ӧóĵ
 //
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
 #include "ServiceInterface.h"
 
 #include <thread>
@@ -8,27 +14,51 @@
 
 static std::shared_ptr<spdlog::logger> _logger(nullptr);
 
-SERVICE_MODULE_C_API int __cdecl Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path)
+SERVICE_MODULE_C_API int SERVICE_CALL Service_Create(std::shared_ptr<spdlog::logger>& log, const std::string& root, const std::string& config_file_path)
 {
     _logger = log;
-    log->info("configuration file({})", config_file_path.c_str());
-    log->info("create service success");
+    LOGGING_INFO(log, "configuration file({})", config_file_path.c_str());
+    LOGGING_INFO(log, "create service success");
 
     return Service_Module_Success;
 }
 
-SERVICE_MODULE_C_API void __cdecl Service_Run(IsServiceRunning Is_Service_Running)
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Run(IsServiceRunning Is_Service_Running)
 {
     while (Is_Service_Running() != 0)
     {
-        _logger->info("service working ...");
+        LOGGING_INFO(_logger, "service working ...");
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 }
 
-SERVICE_MODULE_C_API void __cdecl Service_Destroy()
+static bool Wait_Service_Stop(const ServiceStopToken* token, int timeout_ms)
+{
+#ifdef _WIN32
+    return WaitForSingleObject((HANDLE)token->handle, timeout_ms) != WAIT_TIMEOUT;
+#else
+    struct pollfd pfd;
+    pfd.fd = token->handle;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeout_ms) != 0;
+#endif
+}
+
+SERVICE_MODULE_C_API void SERVICE_CALL Service_RunEx(const ServiceStopToken* token)
+{
+    // wakes up for the work or the stop request, exits as soon as the stop is requested
+    while (!Wait_Service_Stop(token, 1000))
+    {
+        Service_Heartbeat(token);
+
+        LOGGING_INFO(_logger, "service working ...");
+    }
+}
+
+SERVICE_MODULE_C_API void SERVICE_CALL Service_Destroy()
 {
-    _logger->info("destroy service success");
+    LOGGING_INFO(_logger, "destroy service success");
 }
 
 
@@ -0,0 +1,245 @@
+
+// the services of ServiceManager.BS written and read through the field tables of JsonReflect.h and through a document
+
+#include "Http/JsonReflect.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <list>
+#include <chrono>
+
+// as the records of HttpService.h
+struct BenchLibrary_t
+{
+    std::string name;
+    std::string config;
+    std::string version;
+};
+
+struct BenchLog_t
+{
+    std::string name;
+    std::string type;
+    std::string level;
+    std::string flush;
+    std::string flight;
+    int keep = 0;
+    int size = 0;
+};
+
+struct BenchService_t
+{
+    std::string id;
+    std::string name;
+    std::string description;
+    BenchLibrary_t library;
+    BenchLog_t log;
+    bool supervise = false;
+};
+
+static const JsonField_t Bench_Log_Fields[] = {
+    JsonField("name", &BenchLog_t::name, Json_Trim),
+    JsonField("type", &BenchLog_t::type, Json_Required | Json_Trim),
+    JsonField("level", &BenchLog_t::level, Json_Trim),
+    JsonField("keep", &BenchLog_t::keep),
+    JsonField("size", &BenchLog_t::size),
+    JsonField("flush", &BenchLog_t::flush, Json_Trim | Json_Omit_Empty),
+    JsonField("flight", &BenchLog_t::flight, Json_Trim | Json_Omit_Empty)
+};
+
+static const JsonField_t Bench_Service_Fields[] = {
+    JsonField("id", &BenchService_t::id, Json_Required | Json_Trim),
+    JsonField("name", &BenchService_t::name, Json_Required | Json_Not_Empty | Json_Trim),
+    JsonField("description", &BenchService_t::description, Json_Trim),
+    JsonInnerField("library", &BenchService_t::library, &BenchLibrary_t::name, Json_Required | Json_Not_Empty | Json_Trim),
+    JsonInnerField("configuration", &BenchService_t::library, &BenchLibrary_t::config, Json_Trim),
+    JsonInnerField("version", &BenchService_t::library, &BenchLibrary_t::version, Json_Trim, nullptr, nullptr, "unknown"),
+    JsonObject("log", &BenchService_t::log, Bench_Log_Fields, Json_Required),
+    JsonField("supervise", &BenchService_t::supervise)
+};
+
+static const int Bench_Rounds = 20;
+
+static std::string Trim(const std::string& text)
+{
+    std::string::size_type begin = text.find_first_not_of(" \t\r\n");
+    if (std::string::npos == begin)
+    {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+static std::string GetString(const rapidjson::Value& value, const char* name)
+{
+    rapidjson::Value::ConstMemberIterator found = value.FindMember(name);
+    return value.MemberEnd() != found && found->value.IsString() ? Trim(found->value.GetString()) : std::string();
+}
+
+static void AddString(rapidjson::Value& object, const char* name, const std::string& value, rapidjson::Document::AllocatorType& allocator)
+{
+    object.AddMember(rapidjson::StringRef(name), rapidjson::Value(value.c_str(), allocator), allocator);
+}
+
+static std::string WriteReflect(const std::list<BenchService_t>& services)
+{
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("services");
+    writer.StartArray();
+    for (const BenchService_t& service : services)
+    {
+        JsonWriteObject(writer, service, Bench_Service_Fields);
+    }
+    writer.EndArray();
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+static std::string WriteDom(const std::list<BenchService_t>& services)
+{
+    rapidjson::Document doc(rapidjson::kObjectType);
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    rapidjson::Value array(rapidjson::kArrayType);
+    for (const BenchService_t& service : services)
+    {
+        rapidjson::Value object(rapidjson::kObjectType);
+        AddString(object, "id", service.id, allocator);
+        AddString(object, "name", service.name, allocator);
+        AddString(object, "description", service.description, allocator);
+        AddString(object, "library", service.library.name, allocator);
+        AddString(object, "configuration", service.library.config, allocator);
+        AddString(object, "version", service.library.version, allocator);
+
+        rapidjson::Value log(rapidjson::kObjectType);
+        AddString(log, "name", service.log.name, allocator);
+        AddString(log, "type", service.log.type, allocator);
+        AddString(log, "level", service.log.level, allocator);
+        log.AddMember("keep", service.log.keep, allocator);
+        log.AddMember("size", service.log.size, allocator);
+        if (!service.log.flush.empty())
+        {
+            AddString(log, "flush", service.log.flush, allocator);
+        }
+        if (!service.log.flight.empty())
+        {
+            AddString(log, "flight", service.log.flight, allocator);
+        }
+        object.AddMember("log", log, allocator);
+        object.AddMember("supervise", service.supervise, allocator);
+
+        array.PushBack(object, allocator);
+    }
+    doc.AddMember("services", array, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+static size_t ReadReflect(const std::string& text)
+{
+    std::list<BenchService_t> services;
+    BenchService_t initial;
+    initial.log.level = "info";
+
+    std::string err;
+    JsonReadArray<BenchService_t>(text.c_str(), "services", initial, Bench_Service_Fields, [&services](BenchService_t& service, const std::string& service_err) {
+        if (service_err.empty())
+        {
+            services.emplace_back(std::move(service));
+        }
+    }, err);
+    return services.size();
+}
+
+static size_t ReadDom(const std::string& text)
+{
+    std::list<BenchService_t> services;
+
+    rapidjson::Document doc;
+    doc.Parse(text.c_str());
+    for (const rapidjson::Value& value : doc["services"].GetArray())
+    {
+        BenchService_t service;
+        service.id = GetString(value, "id");
+        service.name = GetString(value, "name");
+        service.description = GetString(value, "description");
+        service.library.name = GetString(value, "library");
+        service.library.config = GetString(value, "configuration");
+        service.library.version = GetString(value, "version");
+
+        const rapidjson::Value& log = value["log"];
+        service.log.name = GetString(log, "name");
+        service.log.type = GetString(log, "type");
+        service.log.level = GetString(log, "level");
+        service.log.keep = log["keep"].GetInt();
+        service.log.size = log["size"].GetInt();
+        service.log.flush = GetString(log, "flush");
+        service.log.flight = GetString(log, "flight");
+        service.supervise = value["supervise"].GetBool();
+
+        services.emplace_back(std::move(service));
+    }
+    return services.size();
+}
+
+// microseconds a round
+template <typename Round>
+static long long Measure(const Round& round)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < Bench_Rounds; ++i)
+    {
+        round();
+    }
+    return (long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / Bench_Rounds;
+}
+
+int main()
+{
+    printf("%-10s %16s %16s %16s %16s\n", "services", "write reflect", "write dom", "read reflect", "read dom");
+    for (int count : { 1000, 10000 })
+    {
+        std::list<BenchService_t> services;
+        for (int i = 0; i < count; ++i)
+        {
+            BenchService_t service;
+            service.id = "id" + std::to_string(i);
+            service.name = "service-" + std::to_string(i);
+            service.description = "a sample service";
+            service.library.name = "ServiceSample.dll";
+            service.library.config = "ServiceSample.json";
+            service.library.version = "1.0.0";
+            service.log.name = "ServiceSample";
+            service.log.type = "daily";
+            service.log.level = "info";
+            service.log.flush = "always";
+            service.log.keep = 7;
+            service.log.size = 80;
+            services.push_back(service);
+        }
+
+        std::string text = WriteReflect(services);
+        if (WriteDom(services) != text || ReadReflect(text) != services.size() || ReadDom(text) != services.size())
+        {
+            fprintf(stderr, "the reflected json of %d services differs from the document\n", count);
+            return 1;
+        }
+
+        long long write_reflect = Measure([&services]() { WriteReflect(services); });
+        long long write_dom = Measure([&services]() { WriteDom(services); });
+        long long read_reflect = Measure([&text]() { ReadReflect(text); });
+        long long read_dom = Measure([&text]() { ReadDom(text); });
+        printf("%-10d %13lld us %13lld us %13lld us %13lld us\n", count, write_reflect, write_dom, read_reflect, read_dom);
+    }
+    return 0;
+}
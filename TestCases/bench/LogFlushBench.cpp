@@ -0,0 +1,70 @@
+
+// messages a second of the loader logs under each --log.flush policy, written to the rotating and the daily sink
+
+#include "spdlog/logger-macro.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <chrono>
+
+DECLARE_SPDLOG(bench_logging);
+IMPLEMENT_SPDLOG(bench_logging);
+
+struct FlushMode_t
+{
+    const char* name;
+    spdlog::level::level_enum flush_level;
+    int interval_ms;
+};
+
+// as ServiceHost::InitializeLog takes --log.flush
+static const FlushMode_t Flush_Modes[] = {
+    { "always", spdlog::level::trace, 0 },
+    { "interval=100", spdlog::level::off, 100 },
+    { "interval=1000", spdlog::level::off, 1000 },
+    { "level=warn", spdlog::level::warn, 0 },
+};
+
+static const int Bench_Messages = 200000;
+
+static double Run(const FlushMode_t& mode, bool daily, const std::string& dir)
+{
+    bench_logging::initialize_flush(mode.flush_level, mode.interval_ms);
+
+    std::string name = dir + "/" + (daily ? "daily" : "rotate") + ".log";
+    std::shared_ptr<spdlog::logger> log = daily
+        ? bench_logging::create_daily("bench", name, 0, 0, 2, spdlog::level::info)
+        : bench_logging::create_rotate("bench", name, 80, 2, spdlog::level::info);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < Bench_Messages; ++i)
+    {
+        log->info("service({}) heartbeat {} of {}", "bench", i, Bench_Messages);
+    }
+    log->flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    log.reset();
+    bench_logging::deinitialize();
+    return Bench_Messages / seconds;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string dir = argc > 1 ? argv[1] : "bench-logs";
+    mkdir(dir.c_str(), 0755);
+
+    printf("%-16s %16s %16s\n", "flush", "rotate msg/s", "daily msg/s");
+    for (const FlushMode_t& mode : Flush_Modes)
+    {
+        double rotate = Run(mode, false, dir);
+        double daily = Run(mode, true, dir);
+        printf("%-16s %16.0f %16.0f\n", mode.name, rotate, daily);
+    }
+    return 0;
+}
@@ -1,10 +1,13 @@
 
 #include <windows.h>
 
-#include "spdlog/logging.h"
+#include "ServiceInterface.h"
 
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <mutex>
+#include <chrono>
 
 #include <unordered_map>
 
@@ -21,6 +24,11 @@ static struct
     SERVICE_STATUS        status = { 0 };
     SERVICE_STATUS_HANDLE handle = NULL;
     HANDLE                event = INVALID_HANDLE_VALUE;
+
+    std::mutex                                          stop_lock;
+    std::vector<std::pair<ServiceStopCallback, void*>> stop_callbacks;
+    bool                                                stop_requested = false;
+    std::chrono::steady_clock::time_point               stop_time;
 } service;
 
 #define SERVICE_NAME  ("My Sample Service")  
@@ -48,6 +56,30 @@ static std::string GetLastErrorString()
     return err_str;
 }
 
+static void RequestServiceStop()
+{
+    std::vector<std::pair<ServiceStopCallback, void*>> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(service.stop_lock);
+        if (service.stop_requested)
+        {
+            return;
+        }
+        service.stop_requested = true;
+        service.stop_time = std::chrono::steady_clock::now();
+
+        callbacks.swap(service.stop_callbacks);
+    }
+
+    // This will signal the worker thread to start shutting down
+    SetEvent(service.event);
+
+    for (auto& callback : callbacks)
+    {
+        callback.first(callback.second);
+    }
+}
+
 VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
 {
     switch (CtrlCode)
@@ -73,8 +105,7 @@ VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
             logging::logger()->error("set service status(stopping) failed: {}", GetLastErrorString().c_str());
         }
 
-        // This will signal the worker thread to start shutting down
-        SetEvent(service.event);
+        RequestServiceStop();
 
         break;
 
@@ -83,16 +114,46 @@ VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
     }
 }
 
-typedef int(__cdecl *IsServiceRunning)();
-typedef int(__cdecl *Service_Create)(std::shared_ptr<spdlog::logger>&, const std::string&, const std::string&);
-typedef void(__cdecl *Service_Run)(IsServiceRunning);
-typedef void(__cdecl *Service_Destroy)();
+typedef decltype(&::Service_Create) Service_Create_t;
+typedef decltype(&::Service_Run) Service_Run_t;
+typedef decltype(&::Service_RunEx) Service_RunEx_t;
+typedef decltype(&::Service_Destroy) Service_Destroy_t;
 
-int __cdecl IsServiceRunning_Impl()
+int SERVICE_CALL IsServiceRunning_Impl()
 {
     return 1;
 }
 
+int SERVICE_CALL RegisterStopCallback_Impl(ServiceStopCallback callback, void* context)
+{
+    if (!callback)
+    {
+        return -1;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(service.stop_lock);
+        if (!service.stop_requested)
+        {
+            service.stop_callbacks.emplace_back(callback, context);
+            return 0;
+        }
+    }
+
+    callback(context);
+    return 0;
+}
+
+static long long ElapsedSinceStopRequested()
+{
+    std::lock_guard<std::mutex> guard(service.stop_lock);
+    if (!service.stop_requested)
+    {
+        return -1;
+    }
+    return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - service.stop_time).count();
+}
+
 DWORD WINAPI ServiceWorkerThread(LPVOID)
 {
     do
@@ -133,11 +194,12 @@ DWORD WINAPI ServiceWorkerThread(LPVOID)
 
         do
         {
-            Service_Create Create = (Service_Create)GetProcAddress(module, "Service_Create");
-            Service_Run Run = (Service_Run)GetProcAddress(module, "Service_Run");
-            Service_Destroy Destroy = (Service_Destroy)GetProcAddress(module, "Service_Destroy");
+            Service_Create_t Create = (Service_Create_t)GetProcAddress(module, "Service_Create");
+            Service_Run_t Run = (Service_Run_t)GetProcAddress(module, "Service_Run");
+            Service_RunEx_t RunEx = (Service_RunEx_t)GetProcAddress(module, "Service_RunEx");
+            Service_Destroy_t Destroy = (Service_Destroy_t)GetProcAddress(module, "Service_Destroy");
 
-            if (!Create || !Run || !Destroy)
+            if (!Create || (!Run && !RunEx) || !Destroy)
             {
                 logging::logger()->error("service({}) interface is not compelete", service_lib.c_str());
                 break;
@@ -152,9 +214,29 @@ DWORD WINAPI ServiceWorkerThread(LPVOID)
             /*
             * Perform main service function here
             */
-            Run(IsServiceRunning_Impl);
+            if (RunEx)
+            {
+                ServiceStopToken token;
+                token.size = sizeof(token);
+                token.handle = service.event;
+                token.is_running = IsServiceRunning_Impl;
+                token.register_callback = RegisterStopCallback_Impl;
+                token.heartbeat = nullptr; // no watchdog here
+
+                RunEx(&token);
+            }
+            else
+            {
+                Run(IsServiceRunning_Impl);
+            }
+            long long run_latency = ElapsedSinceStopRequested();
 
             Destroy();
+
+            if (run_latency >= 0)
+            {
+                logging::logger()->info("service({}) returned {}ms and destroyed {}ms after stop requested", RunEx ? "Service_RunEx" : "Service_Run", run_latency, ElapsedSinceStopRequested());
+            }
         } while (false);
 
         FreeLibrary(module);
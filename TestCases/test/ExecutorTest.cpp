@@ -0,0 +1,329 @@
+
+// the poll thread keeps answering while a package pool worker is held by an upgrade, and a full pool refuses work,
+// and the replies of pipelined requests keep their order
+//
+// the requests are routed by a stub of the ev_handler of HttpService rather than by HttpService itself, which is
+// windows only, the stub submits to the pools and sequences the replies the same way
+
+#include "Executor/RequestExecutor.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// as the pools of HttpService
+static const char* Test_Pool_Package = "package";
+static const char* Test_Pool_Service = "service";
+
+// the upgrade stand in holds its worker so long, the list is to be answered well within it
+static const std::chrono::milliseconds Test_Upgrade_Time(2000);
+static const std::chrono::milliseconds Test_List_Bound(500);
+
+// the slow work of a pipelined pair finishes after the fast one
+static const std::chrono::milliseconds Test_Slow_Time(300);
+
+static int failures = 0;
+
+#define TEST_CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (false)
+
+static RequestExecutor executor;
+static std::atomic<bool> upgrading(false);
+
+static bool IsUri(const struct http_message* hm, const char* uri)
+{
+    return hm->uri.len == strlen(uri) && 0 == memcmp(hm->uri.p, uri, hm->uri.len);
+}
+
+static void handle_request(struct mg_connection* nc, struct http_message* hm)
+{
+    if (IsUri(hm, "/service/upgrade"))
+    {
+        bool submitted = executor.Submit(Test_Pool_Package, nc, []() {
+            upgrading = true;
+            std::this_thread::sleep_for(Test_Upgrade_Time);
+            upgrading = false;
+            return std::string("{\"code\":0,\"result\":\"success\"}");
+        });
+        if (!submitted)
+        {
+            mg_printf(nc, "%s", "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+            nc->flags |= MG_F_SEND_AND_CLOSE;
+        }
+        return;
+    }
+
+    if (IsUri(hm, "/service/slow") || IsUri(hm, "/service/fast"))
+    {
+        bool slow = IsUri(hm, "/service/slow");
+        executor.Submit(Test_Pool_Service, nc, [slow]() {
+            std::this_thread::sleep_for(slow ? Test_Slow_Time : std::chrono::milliseconds(0));
+            return std::string(slow ? "{\"code\":0,\"result\":\"slow\"}" : "{\"code\":0,\"result\":\"fast\"}");
+        });
+        return;
+    }
+
+    if (IsUri(hm, "/service/list"))
+    {
+        static const char body[] = "{\"code\":0,\"result\":[]}";
+        mg_printf(nc, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n%s", (int)(sizeof(body) - 1), body);
+        nc->flags |= MG_F_SEND_AND_CLOSE;
+        return;
+    }
+
+    mg_http_send_error(nc, 404, nullptr);
+    nc->flags |= MG_F_SEND_AND_CLOSE;
+}
+
+static void ev_handler(struct mg_connection* nc, int ev, void* ev_data)
+{
+    if (MG_EV_CLOSE == ev)
+    {
+        executor.Detach(nc);
+        return;
+    }
+    if (MG_EV_HTTP_REQUEST != ev)
+    {
+        return;
+    }
+
+    size_t written = nc->send_mbuf.len;
+    handle_request(nc, (struct http_message*)ev_data);
+    executor.Sequence(nc, written);
+}
+
+// the executor keeps the connection open after the last chunk
+static bool IsComplete(const std::string& response)
+{
+    static const char last_chunk[] = "\r\n0\r\n\r\n";
+    return response.size() >= sizeof(last_chunk) - 1
+        && 0 == response.compare(response.size() - (sizeof(last_chunk) - 1), sizeof(last_chunk) - 1, last_chunk);
+}
+
+// sends the requests and reads until the server closes or, unless until_close, the last chunk,
+// a stuck server fails the read by the timeout
+static std::string Exchange(unsigned short port, const std::string& request, bool until_close)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return std::string();
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = 10;
+    timeout.tv_usec = 0;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    send(sock, request.data(), request.size(), 0);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t read = 0;
+    while ((until_close || !IsComplete(response)) && (read = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, (size_t)read);
+    }
+    close(sock);
+    return response;
+}
+
+static std::string Get(const char* uri, const char* connection)
+{
+    return std::string("GET ") + uri + " HTTP/1.1\r\nHost: localhost\r\nConnection: " + connection + "\r\n\r\n";
+}
+
+static std::string Request(unsigned short port, const char* uri)
+{
+    return Exchange(port, Get(uri, "close"), false);
+}
+
+static long long ElapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+static size_t QueuedOf(const char* pool)
+{
+    for (const WorkerPoolStats_t& stats : executor.Stats())
+    {
+        if (pool == stats.name)
+        {
+            return stats.queued;
+        }
+    }
+    return 0;
+}
+
+static void TestListWhileUpgrading()
+{
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr, nullptr);
+
+    struct mg_connection* listener = mg_bind(&mgr, "127.0.0.1:0", ev_handler);
+    TEST_CHECK(nullptr != listener);
+    if (nullptr == listener)
+    {
+        mg_mgr_free(&mgr);
+        return;
+    }
+    mg_set_protocol_http_websocket(listener);
+
+    struct sockaddr_in bound;
+    socklen_t bound_size = sizeof(bound);
+    getsockname(listener->sock, (struct sockaddr*)&bound, &bound_size);
+    unsigned short port = ntohs(bound.sin_port);
+
+    executor.AddPool(Test_Pool_Service, 2, 16);
+    executor.AddPool(Test_Pool_Package, 1, 1);
+    executor.Start(&mgr);
+
+    std::atomic<bool> polling(true);
+    std::thread poller([&mgr, &polling]() {
+        while (polling)
+        {
+            mg_mgr_poll(&mgr, 50);
+        }
+        executor.Stop();
+    });
+
+    std::string upgrade;
+    std::thread upgrader([port, &upgrade]() { upgrade = Request(port, "/service/upgrade"); });
+
+    std::chrono::steady_clock::time_point waited = std::chrono::steady_clock::now();
+    while (!upgrading && ElapsedMs(waited) < 1000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_CHECK(upgrading);
+
+    std::chrono::steady_clock::time_point listed = std::chrono::steady_clock::now();
+    std::string list = Request(port, "/service/list");
+    long long list_ms = ElapsedMs(listed);
+    printf("list answered in %lld ms while upgrading\n", list_ms);
+
+    TEST_CHECK(std::string::npos != list.find("200 OK"));
+    TEST_CHECK(list_ms < Test_List_Bound.count());
+    TEST_CHECK(upgrading);
+
+    // the package pool is held, a second upgrade is queued and a third refused
+    std::string refused;
+    std::thread queued_upgrader([port]() { Request(port, "/service/upgrade"); });
+    waited = std::chrono::steady_clock::now();
+    while (QueuedOf(Test_Pool_Package) < 1 && ElapsedMs(waited) < 1000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_CHECK(1 == QueuedOf(Test_Pool_Package));
+    refused = Request(port, "/service/upgrade");
+    TEST_CHECK(std::string::npos != refused.find("503"));
+
+    upgrader.join();
+    TEST_CHECK(std::string::npos != upgrade.find("success"));
+    queued_upgrader.join();
+
+    // the slow reply goes first though the fast work finishes first, and the list replied at once waits for both
+    std::string pipelined = Exchange(port, Get("/service/slow", "keep-alive") + Get("/service/fast", "keep-alive") + Get("/service/list", "close"), true);
+    size_t slow_at = pipelined.find("slow"), fast_at = pipelined.find("fast"), list_at = pipelined.find("[]");
+    TEST_CHECK(std::string::npos != slow_at && std::string::npos != fast_at && std::string::npos != list_at);
+    TEST_CHECK(slow_at < fast_at && fast_at < list_at);
+
+    for (const WorkerPoolStats_t& stats : executor.Stats())
+    {
+        if (Test_Pool_Package == stats.name)
+        {
+            TEST_CHECK(1 == stats.queued_max);
+            TEST_CHECK(1 == stats.rejected);
+            TEST_CHECK(2 == stats.completed);
+        }
+    }
+
+    polling = false;
+    poller.join();
+    mg_mgr_free(&mgr);
+}
+
+static void TestFullQueueRejected()
+{
+    WorkerPool pool(Test_Pool_Service, 1, 2);
+    pool.Start();
+
+    std::mutex lock;
+    std::condition_variable released;
+    bool release = false;
+    WorkerPool::Task hold = [&]() {
+        std::unique_lock<std::mutex> guard(lock);
+        released.wait(guard, [&release]() { return release; });
+    };
+
+    TEST_CHECK(pool.Post(hold));
+
+    // the worker takes the first, the others fill the queue
+    std::chrono::steady_clock::time_point waited = std::chrono::steady_clock::now();
+    while (0 == pool.Stats().running && ElapsedMs(waited) < 1000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    TEST_CHECK(pool.Post(hold));
+    TEST_CHECK(pool.Post(hold));
+    TEST_CHECK(!pool.Post(hold));
+    TEST_CHECK(!pool.Post(hold));
+
+    WorkerPoolStats_t stats = pool.Stats();
+    TEST_CHECK(1 == stats.running);
+    TEST_CHECK(2 == stats.queued);
+    TEST_CHECK(2 == stats.queued_max);
+    TEST_CHECK(3 == stats.submitted);
+    TEST_CHECK(2 == stats.rejected);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        release = true;
+    }
+    released.notify_all();
+
+    waited = std::chrono::steady_clock::now();
+    while (pool.Busy() && ElapsedMs(waited) < 1000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = pool.Stats();
+    TEST_CHECK(3 == stats.completed);
+    TEST_CHECK(0 == stats.queued);
+    TEST_CHECK(2 == stats.queued_max);
+
+    pool.Stop();
+}
+
+int main()
+{
+    TestListWhileUpgrading();
+    TestFullQueueRejected();
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}